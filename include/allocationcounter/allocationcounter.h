@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+/* Linking this library replaces the global operator new and delete with versions that count every
+ * heap allocation of the executable. Used by the unit tests and the benchmark to check that the
+ * particle system does not allocate in steady state.
+ */
+namespace allocationcounter {
+
+// Returns the number of allocations since the start of the program, from any thread
+size_t getCount();
+
+}  // namespace allocationcounter
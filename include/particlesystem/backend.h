@@ -0,0 +1,100 @@
+#pragma once
+
+#include <particlesystem/effecttable.h>
+#include <particlesystem/particlestore.h>
+#include <particlesystem/scheduler.h>
+#include <particlesystem/simulation.h>
+#include <particlesystem/spatialgrid.h>
+
+#include <glm/vec2.hpp>
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace particlesystem {
+
+/**
+ * Runs the data parallel phases of a simulation step over the particle arrays: evaluating the
+ * packed effects and integrating. Emission and retirement change the number of particles and stay
+ * in the particle system. Every backend has to agree with ReferenceBackend to within floating
+ * point tolerance, which the conformance tests check.
+ */
+class SimulationBackend {
+public:
+    virtual ~SimulationBackend() = default;
+
+    virtual const char* getName() const = 0;
+
+    // Sets forces[i] to the acceleration from every effect in the table at positions[i]
+    virtual void evaluateForces(const EffectTable& effects, std::span<const glm::vec2> positions,
+                                std::span<glm::vec2> forces) = 0;
+
+    // Advances the particles by dt with the integrator, see particlesystem::integrate
+    virtual void integrate(ParticleStore& particles, double dt, Integrator integrator,
+                           const ForceField& forces) = 0;
+};
+
+enum class BackendType {
+    Reference,  // Scalar and single threaded, the baseline the other backends are checked against
+    Cpu,        // SIMD kernels on the threads of the scheduler
+    GLCompute   // Runs on the GPU, available once a factory has been registered for it
+};
+
+// Returns the name of the type, e.g. "cpu"
+const char* toString(BackendType type);
+
+// Creates a backend for a system, which passes its scheduler
+using BackendFactory = std::function<std::unique_ptr<SimulationBackend>(Scheduler& scheduler)>;
+
+/**
+ * Makes a type of backend available, replacing any earlier factory for it. This is how backends
+ * that need more than the particle system library, such as a GL context, are plugged in. An
+ * empty factory removes the type again. Thread safe.
+ */
+void registerBackend(BackendType type, BackendFactory factory);
+
+bool isBackendAvailable(BackendType type);
+
+// \throw std::runtime_error if no factory is registered for the type
+std::unique_ptr<SimulationBackend> makeBackend(BackendType type, Scheduler& scheduler);
+
+// Plain loops over one particle at a time, written for clarity rather than speed
+class ReferenceBackend : public SimulationBackend {
+public:
+    const char* getName() const override { return "reference"; }
+    void evaluateForces(const EffectTable& effects, std::span<const glm::vec2> positions,
+                        std::span<glm::vec2> forces) override;
+    void integrate(ParticleStore& particles, double dt, Integrator integrator,
+                   const ForceField& forces) override;
+
+private:
+    // The state at the start of a Runge-Kutta step and the weighted sum of its stages
+    std::vector<glm::vec2> startPosition;
+    std::vector<glm::vec2> startVelocity;
+    std::vector<glm::vec2> positionChange;
+    std::vector<glm::vec2> velocityChange;
+};
+
+/**
+ * Splits the particles into chunks that are processed in parallel by the scheduler, using the
+ * SIMD kernels selected by setSimdLevel. Effects with a finite range query a spatial grid.
+ */
+class CpuBackend : public SimulationBackend {
+public:
+    explicit CpuBackend(Scheduler& scheduler) : scheduler{scheduler} {}
+
+    const char* getName() const override { return "cpu"; }
+    void evaluateForces(const EffectTable& effects, std::span<const glm::vec2> positions,
+                        std::span<glm::vec2> forces) override;
+    void integrate(ParticleStore& particles, double dt, Integrator integrator,
+                   const ForceField& forces) override;
+
+private:
+    Scheduler& scheduler;
+    SpatialGrid grid;
+    IntegratorBuffers buffers;
+};
+
+}  // namespace particlesystem
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <particlesystem/kernels.h>
+#include <particlesystem/spatialgrid.h>
+
+#include <glm/vec2.hpp>
+
+#include <limits>
+#include <span>
+#include <vector>
+
+class Effect;
+
+namespace particlesystem {
+
+/**
+ * A compact, type sorted copy of the parameters of a set of effects. Applying the table reads and
+ * writes every particle once regardless of the number of effects, instead of streaming the whole
+ * particle array through memory once per effect.
+ *
+ * Effects that cannot describe themselves as table entries (see Effect::pack) are kept as
+ * pointers and applied one by one after the packed effects.
+ *
+ * Effects with a finite range are kept separately, they only visit the particles within their
+ * range by querying a SpatialGrid.
+ */
+class EffectTable {
+public:
+    /**
+     * Replaces the contents of the table with the given effects. This is proportional to the
+     * number of effects and reuses the table's memory, so it is cheap enough to do every frame.
+     */
+    void build(std::span<Effect* const> effects);
+
+    void clear();
+    // Whether the tables hold the same packed effects, unpacked effects are compared by address
+    bool operator==(const EffectTable&) const = default;
+    bool empty() const { return radial.empty() && localRadial.empty() && unpacked.empty(); }
+    bool hasLocal() const { return !localRadial.empty(); }
+
+    // Adds a radial force field that affects the particles within 'range' of its center, see
+    // accumulateRadialForce
+    void addRadial(glm::vec2 center, float k, float range = std::numeric_limits<float>::infinity());
+
+    struct LocalRadialSource {
+        RadialSource source;
+        float range;
+        bool operator==(const LocalRadialSource&) const = default;
+    };
+
+    // The packed effects, for backends that apply the table with their own kernels
+    std::span<const RadialSource> getRadial() const { return radial; }
+    std::span<const LocalRadialSource> getLocalRadial() const { return localRadial; }
+    std::span<Effect* const> getUnpacked() const { return unpacked; }
+
+    /**
+     * Adds the acceleration from the effects with unlimited range to the particles. This may be
+     * called on disjoint parts of the particle arrays in parallel.
+     */
+    void apply(std::span<const glm::vec2> positions, std::span<glm::vec2> accelerations) const;
+
+    /**
+     * Adds the acceleration from the effects with a finite range to the particles. Without a
+     * grid this may be called on disjoint parts of the particle arrays in parallel.
+     * @param grid A grid built from 'positions' used to find the particles within range, or
+     * nullptr to test every particle
+     */
+    void applyLocal(std::span<const glm::vec2> positions, std::span<glm::vec2> accelerations,
+                    const SpatialGrid* grid) const;
+
+    /**
+     * Like applyLocal with a grid, but only updates the particles in the grid buckets
+     * [beginBucket, endBucket). This may be called on disjoint bucket ranges in parallel.
+     */
+    void applyLocal(std::span<const glm::vec2> positions, std::span<glm::vec2> accelerations,
+                    const SpatialGrid& grid, uint32_t beginBucket, uint32_t endBucket) const;
+
+private:
+    std::vector<RadialSource> radial;
+    std::vector<LocalRadialSource> localRadial;
+    std::vector<Effect*> unpacked;
+};
+
+}  // namespace particlesystem
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <span>
+
+// Data parallel kernels that operate directly on the particle attribute arrays. Each kernel has a
+// scalar implementation and, on x86, SSE2 and AVX2 implementations that are picked at runtime.
+namespace particlesystem {
+
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+// Returns the name of the level, e.g. "AVX2"
+const char* toString(SimdLevel level);
+
+// Returns the highest level supported by the CPU and operating system
+SimdLevel detectSimdLevel();
+
+// Returns the level currently used by the kernels, defaults to detectSimdLevel()
+SimdLevel getSimdLevel();
+
+// Selects the implementation used by the kernels, e.g. to compare them against each other.
+// Requesting a level that the CPU does not support selects the highest supported level instead.
+void setSimdLevel(SimdLevel level);
+
+// Parameters of a radial force field, see accumulateRadialForce
+struct RadialSource {
+    glm::vec2 center;
+    float k;
+    bool operator==(const RadialSource&) const = default;
+};
+
+/**
+ * Adds the acceleration of a radial force field centered at 'center' to every particle:
+ *     acceleration += k * d / |d|^2, where d = center - position
+ * This is a force of strength k / |d| along the normalized direction towards the center, i.e.
+ * an attractor for positive k and a repeller for negative k.
+ *
+ * The SIMD versions use an approximate reciprocal refined with one Newton-Raphson step, they
+ * agree with the scalar version to within a few ulp.
+ */
+void accumulateRadialForce(std::span<const glm::vec2> positions,
+                           std::span<glm::vec2> accelerations, glm::vec2 center, float k);
+
+// Same as above but only for the particles within 'range' of the center. An infinite range uses
+// the SIMD kernels, otherwise the particles are tested one by one.
+void accumulateRadialForce(std::span<const glm::vec2> positions,
+                           std::span<glm::vec2> accelerations, glm::vec2 center, float k,
+                           float range);
+
+// Adds the acceleration of all the sources to every particle. Each particle is read and written
+// once while the contributions of the sources are summed in registers, in the order given.
+void accumulateRadialForces(std::span<const glm::vec2> positions,
+                            std::span<glm::vec2> accelerations,
+                            std::span<const RadialSource> sources);
+
+/* Integration kernels. Each particle has a position x, a velocity v, a constant base acceleration
+ * a (the thrust given by its emitter) and a force f, the acceleration from the effects in the
+ * current step. All spans have the same length. The SIMD versions perform the same operations in
+ * the same order as the scalar version, so the results do not depend on the SIMD level.
+ */
+
+// v += kick * (a + f), then x += drift * v
+void kickDrift(std::span<glm::vec2> x, std::span<glm::vec2> v, std::span<const glm::vec2> a,
+               std::span<const glm::vec2> f, float kick, float drift);
+
+// v += scale * (a + f)
+void kick(std::span<glm::vec2> v, std::span<const glm::vec2> a, std::span<const glm::vec2> f,
+          float scale);
+
+/**
+ * The first stage of a Runge-Kutta step, with the forces f at the start positions x:
+ *     dx = weight * v, dv = weight * (a + f), xs = x + step * v, vs = v + step * (a + f)
+ * dx and dv accumulate the weighted derivatives of the stages, and xs and vs are the state at
+ * which the forces of the next stage are evaluated.
+ */
+void rungeKuttaBegin(std::span<const glm::vec2> x, std::span<const glm::vec2> v,
+                     std::span<const glm::vec2> a, std::span<const glm::vec2> f,
+                     std::span<glm::vec2> xs, std::span<glm::vec2> vs, std::span<glm::vec2> dx,
+                     std::span<glm::vec2> dv, float weight, float step);
+
+// A middle stage, with the forces f at xs:
+//     dx += weight * vs, dv += weight * (a + f), xs = x + step * vs, vs = v + step * (a + f)
+void rungeKuttaStage(std::span<const glm::vec2> x, std::span<const glm::vec2> v,
+                     std::span<const glm::vec2> a, std::span<const glm::vec2> f,
+                     std::span<glm::vec2> xs, std::span<glm::vec2> vs, std::span<glm::vec2> dx,
+                     std::span<glm::vec2> dv, float weight, float step);
+
+// The last stage, with the forces f at xs: x += dx + weight * vs, v += dv + weight * (a + f)
+void rungeKuttaEnd(std::span<glm::vec2> x, std::span<glm::vec2> v, std::span<const glm::vec2> a,
+                   std::span<const glm::vec2> f, std::span<const glm::vec2> vs,
+                   std::span<const glm::vec2> dx, std::span<const glm::vec2> dv, float weight);
+
+}  // namespace particlesystem
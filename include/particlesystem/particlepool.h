@@ -0,0 +1,95 @@
+#pragma once
+
+#include <particlesystem/particlestore.h>
+
+#include <vector>
+
+class Particle;
+class Emitter;
+
+namespace particlesystem {
+
+// What a pool does with new particles once it has reached its capacity
+enum class OverflowPolicy {
+    DropNewest,     // The new particles are discarded
+    RecycleOldest,  // The oldest particles are removed to make room for the new ones
+    Grow            // The capacity is increased, which reallocates the particle storage
+};
+
+/**
+ * A particle store with a fixed capacity. All memory is allocated on construction and the slots
+ * of retired particles are reused by later spawns, so a pool that stays within its capacity never
+ * allocates. Live particles are always kept densely packed at the front of the store, which means
+ * the free slots form a single contiguous range at its end.
+ */
+class ParticlePool {
+public:
+    // Matches the number of points the renderer can draw in a single call
+    static constexpr size_t DefaultCapacity = 1024 * 1024;
+
+    /**
+     * Construct an empty pool and allocate the storage for all of its particles
+     * @param capacity The maximum number of live particles
+     * @param policy What to do with new particles when the pool is full
+     */
+    explicit ParticlePool(size_t capacity = DefaultCapacity,
+                          OverflowPolicy policy = OverflowPolicy::DropNewest);
+
+    size_t size() const { return store.size(); }
+    bool empty() const { return store.empty(); }
+    size_t capacity() const { return maxParticles; }
+    OverflowPolicy getPolicy() const { return policy; }
+
+    // The total number of particles that have been dropped or recycled due to overflow
+    size_t getOverflowCount() const { return overflowCount; }
+
+    /**
+     * Makes room for up to 'count' new particles at the end of the store according to the
+     * overflow policy. The new particles are zero initialized and should be written by the caller.
+     * @param count The number of particles requested
+     * @return The index of the first new particle, the number of particles actually added is
+     * size() minus the returned index
+     */
+    size_t acquire(size_t count);
+
+    // Adds a copy of the particle, returns false if it was dropped because the pool is full
+    bool spawn(const Particle& particle);
+
+    // Lets the emitter write the particles due after 'dt' seconds directly into the pool, see
+    // Emitter::emit. Returns the number of particles that were added.
+    size_t emit(Emitter& emitter, float dt);
+
+    /**
+     * Adds up to 'count' particles that are written by 'generate(store, first, n)', where the n
+     * new particles start at index 'first' in the store
+     * @return The number of particles that were added
+     */
+    template <typename Generate>
+    size_t spawn(size_t count, Generate&& generate) {
+        const size_t first = acquire(count);
+        const size_t added = store.size() - first;
+        generate(store, first, added);
+        store.resetPreviousPosition(first, added);
+        return added;
+    }
+
+    // Removes every particle older than 'maxLifetime', see ParticleStore::retireExpired
+    size_t retireExpired(float maxLifetime, RetireOrder order = RetireOrder::Unordered);
+
+    void clear() { store.clear(); }
+
+    ParticleStore& particles() { return store; }
+    const ParticleStore& particles() const { return store; }
+
+private:
+    // Removes the 'count' particles with the largest lifetime
+    void recycleOldest(size_t count);
+
+    ParticleStore store;
+    size_t maxParticles;
+    OverflowPolicy policy;
+    size_t overflowCount;
+    std::vector<float> scratch;
+};
+
+}  // namespace particlesystem
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <particlesystem/alignedallocator.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <span>
+#include <vector>
+
+class Particle;
+
+namespace particlesystem {
+
+// How the surviving particles are arranged after expired ones have been removed
+enum class RetireOrder {
+    Unordered,  // Expired particles are replaced by the last particle in the store
+    Stable      // The surviving particles keep their relative order
+};
+
+/**
+ * Structure-of-arrays storage for the particles in a system. Every attribute is kept in its own
+ * contiguous array so that a pass only streams the data it actually touches. The position,
+ * radius and color arrays can be handed directly to rendering::Window::drawPoints.
+ *
+ * All arrays always have the same length, particle i is described by the i:th element of each.
+ * Each array starts on a cache line boundary.
+ */
+class ParticleStore {
+public:
+    ParticleStore() = default;
+
+    /**
+     * Construct an empty store with room for 'capacity' particles before any reallocation
+     * @param capacity The number of particles to reserve memory for
+     */
+    explicit ParticleStore(size_t capacity);
+
+    size_t size() const { return position.size(); }
+    bool empty() const { return position.empty(); }
+    size_t capacity() const { return position.capacity(); }
+
+    void reserve(size_t capacity);
+    void clear();
+
+    // Appends a copy of the particle and returns its index
+    size_t push(const Particle& particle);
+
+    // Appends 'count' zero initialized particles and returns the index of the first one
+    size_t append(size_t count);
+
+    // Overwrites the particle at index i with a copy of 'particle'
+    void set(size_t i, const Particle& particle);
+
+    // Removes the particle at index i, the order of the remaining particles is kept
+    void erase(size_t i);
+
+    /**
+     * Removes every particle whose lifetime is larger than 'maxLifetime' in a single linear pass
+     * over the store. No memory is released, so the freed slots are reused by later pushes.
+     * @param maxLifetime The age at which a particle is considered expired
+     * @param order Whether the surviving particles have to keep their relative order
+     * @return The number of particles that were removed
+     */
+    size_t retireExpired(float maxLifetime, RetireOrder order = RetireOrder::Unordered);
+
+    // Advances the age of every particle by dt
+    void updateLifetime(const double dt);
+
+    // Saves the current positions as the previous ones, called before every simulation step
+    void storePreviousPosition();
+    // Sets the previous position of the particles in [first, first + count) to their current
+    // one, for new particles that were written directly into the position array
+    void resetPreviousPosition(size_t first, size_t count);
+
+    /**
+     * Blends the previous and current positions, for rendering between two simulation steps
+     * @param alpha 0 for the previous positions and 1 for the current ones, see
+     * SimulationClock::getAlpha
+     * @param out Receives one position per particle, must have size() elements
+     */
+    void interpolatePosition(float alpha, std::span<glm::vec2> out) const;
+
+    // Updates every particle's velocity and position from its acceleration and force with the
+    // semi-implicit Euler method: v += (a + f) * dt, then x += v * dt
+    void updatePosition(const double dt);
+    // Updates the position of the particles in [begin, end)
+    void updatePosition(const double dt, size_t begin, size_t end);
+
+    std::span<const glm::vec2> getPosition() const { return position; }
+    std::span<const glm::vec2> getPreviousPosition() const { return previousPosition; }
+    std::span<const glm::vec2> getVelocity() const { return velocity; }
+    std::span<const glm::vec2> getAcceleration() const { return acceleration; }
+    std::span<const glm::vec2> getForce() const { return force; }
+    std::span<const float> getLifetime() const { return lifetime; }
+    std::span<const float> getRadius() const { return radius; }
+    std::span<const glm::vec4> getColor() const { return color; }
+
+    std::span<glm::vec2> getPosition() { return position; }
+    std::span<glm::vec2> getPreviousPosition() { return previousPosition; }
+    std::span<glm::vec2> getVelocity() { return velocity; }
+    std::span<glm::vec2> getAcceleration() { return acceleration; }
+    std::span<glm::vec2> getForce() { return force; }
+    std::span<float> getLifetime() { return lifetime; }
+    std::span<float> getRadius() { return radius; }
+    std::span<glm::vec4> getColor() { return color; }
+
+private:
+    // Copies every attribute of particle 'from' into slot 'to'
+    void moveParticle(size_t from, size_t to);
+    // Resizes every attribute array to 'count' elements
+    void resize(size_t count);
+
+    AlignedVector<glm::vec2> position;
+    AlignedVector<glm::vec2> previousPosition;  // Position before the latest simulation step
+    AlignedVector<glm::vec2> velocity;
+    AlignedVector<glm::vec2> acceleration;  // Constant, the thrust given by the emitter
+    // The acceleration from the effects, evaluated again in every simulation step
+    AlignedVector<glm::vec2> force;
+    AlignedVector<float> lifetime;
+    AlignedVector<float> radius;
+    AlignedVector<glm::vec4> color;
+};
+
+}  // namespace particlesystem
@@ -1,11 +1,20 @@
 ﻿#pragma once
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
+#include <span>
 #include <vector>
 #include <cmath>
 #include <iostream>
+#include <limits>
 
-// random value (direction - width)
+#include <particlesystem/random.h>
+
+namespace particlesystem {
+class EffectTable;
+class ParticleStore;
+}
+
+// random value (direction - width), drawn from the calling thread's stream
 float randomValue(float direction, float width);
 
 class Particle {
@@ -36,7 +45,7 @@ public:
     // F�r spinner
     Particle(glm::vec2 pos, float direction) {
         position = pos;
-        float theta = 0.0f;  // ska uppdateras
+        float theta = direction;
         acceleration = {force * cos(theta), force * sin(theta)};
     }
 
@@ -48,9 +57,40 @@ public:
     float radius = 10.0f;
     glm::vec4 color = {1.0f, 0.0f, 0.0f, 1.0f};
     glm::vec2 position = {0.0f, 0.0f};
+    // Number of particles emitted per second
+    float rate = 500.0f;
+    // Every emitter draws from its own stream so that its particles do not depend on the others
+    particlesystem::RandomStream random = particlesystem::makeStream();
 
     virtual Particle createParticle() = 0;
+
+    // Returns the number of particles to emit after 'dt' seconds. The fractional part is carried
+    // over to the next call so that the emission rate is independent of the frame rate.
+    size_t particlesDue(float dt);
+
+    // Writes 'count' new particles into 'out' starting at index 'first'
+    virtual void generate(particlesystem::ParticleStore& out, size_t first, size_t count) = 0;
+
+    // Appends the particles due after 'dt' seconds to 'out'
+    void emit(float dt, particlesystem::ParticleStore& out);
+
+    // The fraction of a particle carried over to the next call to particlesDue
+    float getPending() const { return pending; }
+    void setPending(float value) { pending = value; }
+
     virtual ~Emitter() {}
+
+protected:
+    // Writes the attributes that every new particle shares and sets the acceleration to the
+    // unit vector of the angle that the caller has stored in acceleration.x
+    void generateFromAngles(particlesystem::ParticleStore& out, size_t first, size_t count) const;
+
+    // Stores angles uniformly distributed in [low, high) in acceleration.x of the new particles
+    void generateAngles(particlesystem::ParticleStore& out, size_t first, size_t count, float low,
+                        float high);
+
+private:
+    float pending = 0.0f;
 };
 
 class Uniform : public Emitter {
@@ -59,6 +99,7 @@ public:
     float theta = randomValue(0, twoPi);
 
     Particle createParticle() override;
+    void generate(particlesystem::ParticleStore& out, size_t first, size_t count) override;
 };
 
 class Directional : public Emitter {
@@ -80,14 +121,20 @@ public:
     }
 
     Particle createParticle() override;
+    void generate(particlesystem::ParticleStore& out, size_t first, size_t count) override;
 };
 
 class Spinner : public Emitter {
 public:
-    float direction;
+    float direction = 0.0f;
+    // Radians per second that the emission direction rotates
+    float spinSpeed = 3.14f;
     float theta = randomValue(0, 3.14);
 
     Particle createParticle() override;
+    // The particles are spread evenly over the arc that the direction covered since the last
+    // batch, which advances the direction
+    void generate(particlesystem::ParticleStore& out, size_t first, size_t count) override;
 };
 
 class Effect {
@@ -95,20 +142,33 @@ public:
     float radius = 10.0f;
     glm::vec4 color = {0.0f, 1.0f, 0.0f, 1.0f};
     glm::vec2 position = {0.2f, 0.0f};
-
-    virtual void effectParticle(std::vector<Particle>& allParticles) = 0;
+    // Only particles within this distance from the position are affected
+    float influenceRadius = std::numeric_limits<float>::infinity();
+
+    // Adds the effect's acceleration to every particle, positions[i] and accelerations[i] belong
+    // to the same particle
+    virtual void effectParticle(std::span<const glm::vec2> positions,
+                                std::span<glm::vec2> accelerations) = 0;
+    // Adds the effect's parameters to a table that evaluates all effects in a single pass over the
+    // particles. Returns false if the effect can only be applied through effectParticle.
+    virtual bool pack(particlesystem::EffectTable&) const { return false; }
+    virtual ~Effect() {}
 };
 
 class GravityWell : public Effect {
 public:
     float force = 0.05f;
 
-    void effectParticle(std::vector<Particle>& allParticles) override;
+    void effectParticle(std::span<const glm::vec2> positions,
+                        std::span<glm::vec2> accelerations) override;
+    bool pack(particlesystem::EffectTable& table) const override;
 };
 
 class Wind : public Effect {
 public:
     float force = 0.05f;
 
-    void effectParticle(std::vector<Particle>& allParticles) override;
+    void effectParticle(std::span<const glm::vec2> positions,
+                        std::span<glm::vec2> accelerations) override;
+    bool pack(particlesystem::EffectTable& table) const override;
 };
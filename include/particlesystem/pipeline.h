@@ -0,0 +1,106 @@
+#pragma once
+
+#include <particlesystem/alignedallocator.h>
+#include <particlesystem/particlestore.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <span>
+#include <thread>
+
+namespace particlesystem {
+
+// A copy of what the renderer needs from one frame of the simulation
+struct ParticleSnapshot {
+    AlignedVector<glm::vec2> previousPosition;
+    AlignedVector<glm::vec2> position;
+    AlignedVector<float> radius;
+    AlignedVector<glm::vec4> color;
+    // Interpolation factor between the previous and current position, see SimulationClock
+    float alpha = 0.0f;
+    // Number of the frame that produced the snapshot, starting at 1
+    uint64_t frame = 0;
+
+    size_t size() const { return position.size(); }
+
+    // Copies the particles, only allocates when the store has grown past any earlier capture
+    void capture(const ParticleStore& particles, float alpha);
+
+    // Same as ParticleStore::interpolatePosition with the captured alpha
+    void interpolatePosition(std::span<glm::vec2> out) const;
+};
+
+/**
+ * Overlaps the simulation of the next frame with the drawing of the current one. Two snapshots are
+ * kept: the front one is only read by the caller and the back one is only written by the step
+ * function, so neither needs a lock. The snapshots change roles in sync(), at the frame boundary,
+ * when the step is known to have finished.
+ *
+ * A frame in the calling thread looks like:
+ *     const ParticleSnapshot& snapshot = pipeline.sync();  // Wait for the previous step
+ *     ...edit the simulation state, e.g. from the user interface...
+ *     pipeline.launch();                                    // Start simulating the next frame
+ *     ...draw 'snapshot'...
+ * Between launch() and the next sync() the step owns the simulation state, so the caller must
+ * not modify anything the step reads.
+ */
+class SimulationPipeline {
+public:
+    enum class Mode {
+        // The step runs in launch(), on the calling thread
+        Serial,
+        // The step runs on a worker thread while the caller draws the previous frame
+        Pipelined
+    };
+
+    // Simulates a frame and captures the result into the snapshot it is given
+    using Step = std::function<void(ParticleSnapshot&)>;
+
+    explicit SimulationPipeline(Step step, Mode mode = Mode::Pipelined);
+    ~SimulationPipeline();
+
+    SimulationPipeline(const SimulationPipeline&) = delete;
+    SimulationPipeline& operator=(const SimulationPipeline&) = delete;
+
+    // Starts the step for the next frame. Must not be called again before sync().
+    void launch();
+
+    /**
+     * Waits for the launched step and swaps the snapshots. Rethrows any exception from the step.
+     * @return The snapshot of the latest finished frame, valid until the next sync()
+     */
+    const ParticleSnapshot& sync();
+
+    // The snapshot returned by the latest sync()
+    const ParticleSnapshot& front() const { return snapshots[frontIndex]; }
+
+    Mode getMode() const { return mode; }
+    // Only takes effect on the next launch(), must not be called between launch() and sync()
+    void setMode(Mode mode);
+
+private:
+    void workerLoop();
+
+    Step step;
+    Mode mode;
+
+    std::array<ParticleSnapshot, 2> snapshots;
+    size_t frontIndex = 0;
+    uint64_t frameCount = 0;
+
+    // The frames launched and finished so far. The worker waits on 'launched' and the caller on
+    // 'finished', which also publishes the snapshot written by the step.
+    std::atomic<uint64_t> launched{0};
+    std::atomic<uint64_t> finished{0};
+    std::atomic<bool> stopping{false};
+    std::exception_ptr error;
+    std::thread worker;
+};
+
+}  // namespace particlesystem
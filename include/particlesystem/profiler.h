@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Scoped timing zones for the phases of a frame. PARTICLESYSTEM_PROFILE_ZONE("name") measures the
+// rest of the enclosing scope and adds it to the zone's time for the current frame, and
+// PARTICLESYSTEM_PROFILE_FRAME() ends the frame. Building with PARTICLESYSTEM_PROFILING=0 removes
+// the zones completely. When Tracy is enabled (TRACY_ENABLE) and its header is available, every
+// zone and frame is also reported to Tracy.
+#ifndef PARTICLESYSTEM_PROFILING
+#define PARTICLESYSTEM_PROFILING 1
+#endif
+
+#if defined(TRACY_ENABLE) && __has_include(<tracy/Tracy.hpp>)
+#include <tracy/Tracy.hpp>
+#define PARTICLESYSTEM_TRACY_ZONE(name) ZoneScopedN(name);
+#define PARTICLESYSTEM_TRACY_FRAME() FrameMark;
+#else
+#define PARTICLESYSTEM_TRACY_ZONE(name)
+#define PARTICLESYSTEM_TRACY_FRAME()
+#endif
+
+#define PARTICLESYSTEM_CONCAT_IMPL(a, b) a##b
+#define PARTICLESYSTEM_CONCAT(a, b) PARTICLESYSTEM_CONCAT_IMPL(a, b)
+
+#if PARTICLESYSTEM_PROFILING
+#define PARTICLESYSTEM_PROFILE_ZONE(name)                                                      \
+    PARTICLESYSTEM_TRACY_ZONE(name)                                                            \
+    static const ::particlesystem::profiling::ZoneId PARTICLESYSTEM_CONCAT(profileZoneId_,     \
+                                                                           __LINE__) =         \
+        ::particlesystem::profiling::registerZone(name);                                       \
+    const ::particlesystem::profiling::Zone PARTICLESYSTEM_CONCAT(profileZone_, __LINE__) {    \
+        PARTICLESYSTEM_CONCAT(profileZoneId_, __LINE__)                                        \
+    }
+#define PARTICLESYSTEM_PROFILE_FRAME()  \
+    PARTICLESYSTEM_TRACY_FRAME()        \
+    ::particlesystem::profiling::endFrame()
+#else
+#define PARTICLESYSTEM_PROFILE_ZONE(name) static_cast<void>(0)
+#define PARTICLESYSTEM_PROFILE_FRAME() static_cast<void>(0)
+#endif
+
+namespace particlesystem::profiling {
+
+using ZoneId = uint32_t;
+
+// Number of frames kept for the statistics and the report
+inline constexpr size_t HistorySize = 1024;
+// Zones beyond this number are ignored
+inline constexpr size_t MaxZones = 64;
+
+// Returns the id of the zone with the given name, creating it on first use. Thread safe.
+ZoneId registerZone(std::string_view name);
+
+// Adds time to the zone for the current frame. Thread safe, so zones may run on worker threads.
+void record(ZoneId zone, std::chrono::nanoseconds duration);
+
+// Ends the current frame, the time recorded since the previous call becomes the latest sample of
+// every zone. Should only be called from one thread.
+void endFrame();
+
+// Forgets every sample, but keeps the zones
+void reset();
+
+// Measures the time until it is destroyed, see PARTICLESYSTEM_PROFILE_ZONE
+class Zone {
+public:
+    explicit Zone(ZoneId id) : id{id}, start{std::chrono::steady_clock::now()} {}
+    ~Zone() { record(id, std::chrono::steady_clock::now() - start); }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    ZoneId id;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Statistics over the frames in the history, all times in milliseconds
+struct ZoneStats {
+    std::string name;
+    double last;
+    double mean;
+    double min;
+    double max;
+    double p95;
+};
+
+// The statistics of every zone in the order they were registered
+std::vector<ZoneStats> getStats();
+
+// Number of frames ended so far
+uint64_t getFrameCount();
+
+/**
+ * Renders the latest frames of a zone as a single line of text, one character per frame, where
+ * taller characters are slower frames. Scaled to the slowest of the shown frames.
+ * @param name The zone
+ * @param width The number of frames to show
+ */
+std::string sparkline(std::string_view name, size_t width);
+
+/**
+ * Writes the per-frame times of every zone in the history, in milliseconds. The format is chosen
+ * from the extension: ".json" writes the statistics and the samples as JSON and anything else a
+ * CSV table with one row per frame and one column per zone.
+ * \throw std::runtime_error if the file could not be written
+ */
+void writeReport(std::string_view path);
+
+}  // namespace particlesystem::profiling
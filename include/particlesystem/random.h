@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+// Counter based random numbers. Every value is a pure function of (seed, stream, index), which
+// makes the streams cheap to create, independent of each other and reproducible regardless of
+// which thread draws from them or in which order.
+namespace particlesystem {
+
+// The seed used until setMasterSeed is called, so that runs are reproducible by default
+constexpr uint64_t DefaultMasterSeed = 0x5eed'c0de'2024'0001;
+
+/**
+ * The Philox4x32-10 block function from "Parallel Random Numbers: As Easy as 1, 2, 3" (Salmon et
+ * al. 2011). Maps a 128 bit counter and a 64 bit key to four 32 bit random values.
+ */
+std::array<uint32_t, 4> philox4x32(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key);
+
+/**
+ * A sequence of random numbers identified by a seed and a stream id. The seed is used as the
+ * Philox key and the stream id together with the position in the stream forms the counter, so two
+ * streams with different ids never overlap.
+ */
+class RandomStream {
+public:
+    RandomStream(uint64_t seed = DefaultMasterSeed, uint64_t stream = 0);
+
+    uint64_t getSeed() const { return seed; }
+    uint64_t getStream() const { return stream; }
+    // The number of 32 bit values drawn so far
+    uint64_t getPosition() const { return 4 * block - (4 - bufferIndex); }
+
+    // Moves to the start of the stream
+    void reset();
+
+    // Moves to 'position' values from the start of the stream, see getPosition
+    void seek(uint64_t position);
+
+    uint32_t nextUInt();
+
+    // Uniformly distributed in [0, 1)
+    float nextFloat();
+
+    // Uniformly distributed in [low, high)
+    float uniform(float low, float high) { return low + (high - low) * nextFloat(); }
+
+    /**
+     * Fills 'out' with values uniformly distributed in [low, high). Produces the same values as
+     * calling uniform() once per element, but whole Philox blocks are generated in a loop without
+     * dependencies between the iterations which the compiler vectorizes.
+     */
+    void fillUniform(std::span<float> out, float low, float high);
+
+    // Fills 'out' with angles uniformly distributed in [0, 2 pi)
+    void fillAngles(std::span<float> out);
+
+private:
+    std::array<uint32_t, 4> counter(uint64_t index) const;
+
+    uint64_t seed;
+    uint64_t stream;
+    uint64_t block;  // Index of the next block to generate
+    std::array<uint32_t, 4> buffer;
+    uint32_t bufferIndex;  // Next value to use from the buffer, 4 if it is empty
+};
+
+// Sets the seed of all streams created by makeStream and threadStream from now on and restarts the
+// stream ids, so that creating the same emitters in the same order reproduces the same particles
+void setMasterSeed(uint64_t seed);
+uint64_t getMasterSeed();
+
+// Creates a stream from the master seed with the next unused stream id, e.g. one per emitter
+RandomStream makeStream();
+
+// A stream for the calling thread derived from the master seed. The streams of the threads are
+// disjoint from each other and from the streams created by makeStream.
+RandomStream& threadStream();
+
+}  // namespace particlesystem
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <particlesystem/particlestore.h>
+#include <particlesystem/snapshot.h>
+#include <particlesystem/system.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Recording and replay of a simulation session.
+ *
+ * A recording is an append-only log of events: the edits made to the emitters, effects and
+ * settings of a system, and for every frame the wall clock time passed to
+ * ParticleSystem::update together with a checksum of the particles afterwards. Since the
+ * simulation is deterministic, applying the same events to a system that starts in the same state
+ * reproduces the same particles, which the checksums confirm.
+ *
+ *   RecordingHeader
+ *   event*             uint32 type, uint32 payload size, payload
+ *
+ * All values are little endian, see snapshot.h for the emitter and effect records.
+ */
+namespace particlesystem {
+
+inline constexpr uint32_t RecordingVersion = 3;
+
+struct RecordingHeader {
+    char magic[8];  // "PSYSREC\0"
+    uint32_t version;
+    uint32_t overflowPolicy;  // OverflowPolicy of the pool
+    uint64_t masterSeed;
+    uint64_t capacity;  // Of the pool when the recording started
+};
+static_assert(sizeof(RecordingHeader) == 32);
+
+enum class RecordedEvent : uint32_t {
+    Settings,      // SystemRecord
+    AddEmitter,    // EmitterRecord
+    AddEffect,     // EffectRecord
+    RemoveEmitter, // uint32 index into getEmitters()
+    RemoveEffect,  // uint32 index into getEffects()
+    EditEmitter,   // uint32 index, EmitterRecord
+    EditEffect,    // uint32 index, EffectRecord
+    Frame          // FrameRecord
+};
+
+struct FrameRecord {
+    double elapsed;  // Seconds passed to ParticleSystem::update
+    uint64_t particleCount;
+    uint64_t checksum;  // See checksum()
+};
+static_assert(sizeof(FrameRecord) == 24);
+
+// A hash of the position, velocity and lifetime of every particle, to compare two runs
+uint64_t checksum(const ParticleStore& particles);
+
+/**
+ * Records a session to a file. The events of a frame are collected in memory and handed to a
+ * background thread that writes them, so recording never waits for the disk.
+ *
+ * The recording starts from the settings, emitters and effects the system has when start() is
+ * called, but not from its particles. Start it before the first step, or load the same snapshot
+ * into the system before replaying.
+ *
+ * Every edit to the system should be reported through the record functions between two frames.
+ * A recorder that has not been started ignores all calls, so they can stay in place.
+ */
+class Recorder {
+public:
+    Recorder() = default;
+    ~Recorder();
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // \throw std::runtime_error if the file could not be created
+    void start(const std::string& path, const ParticleSystem& system);
+    // Writes the remaining events and closes the file
+    void stop();
+    bool isRecording() const { return writer.joinable(); }
+
+    void recordSettings(const ParticleSystem& system);
+    // Call after the emitter or effect was added
+    void recordAdd(const ParticleSystem& system, EmitterHandle handle);
+    void recordAdd(const ParticleSystem& system, EffectHandle handle);
+    // Call before the emitter or effect is removed
+    void recordRemove(const ParticleSystem& system, EmitterHandle handle);
+    void recordRemove(const ParticleSystem& system, EffectHandle handle);
+    // Call after an emitter or effect was changed
+    void recordEdit(const ParticleSystem& system, EmitterHandle handle);
+    void recordEdit(const ParticleSystem& system, EffectHandle handle);
+
+    // Call after ParticleSystem::update(elapsed), completes the events of the frame
+    void recordFrame(double elapsed, const ParticleStore& particles);
+
+    // The number of frames recorded since start()
+    uint64_t getFrameCount() const { return frameCount; }
+
+private:
+    template <typename... T>
+    void append(RecordedEvent type, const T&... payload);
+    void writerLoop();
+
+    std::vector<std::byte> events;  // The events of the current frame
+    uint64_t frameCount = 0;
+
+    // Shared with the writer thread
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::byte> queued;
+    bool stopping = false;
+    std::string writeError;
+
+    std::ofstream file;
+    std::thread writer;
+};
+
+struct ReplayResult {
+    uint64_t frames = 0;
+    uint64_t steps = 0;
+    // Frames whose particles did not match the recording, and the first of them
+    uint64_t mismatches = 0;
+    uint64_t firstMismatch = 0;
+    double seconds = 0.0;  // Wall clock time of the replay
+};
+
+/**
+ * Reads the header of a recording. A replay only reproduces the recorded session if the system
+ * was created with the recorded pool capacity and overflow policy.
+ * \throw std::runtime_error if the file is not a valid recording
+ */
+RecordingHeader readRecordingHeader(const std::string& path);
+
+/**
+ * Applies the recorded events to the system as fast as possible. The emitters and effects of the
+ * system are replaced by the recorded ones, the clock is reset and the master seed is set to the
+ * recorded one, but the particles are kept.
+ * \throw std::runtime_error if the file is not a valid recording
+ */
+ReplayResult replay(const std::string& path, ParticleSystem& system);
+
+}  // namespace particlesystem
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <particlesystem/effecttable.h>
+#include <particlesystem/particlestore.h>
+#include <particlesystem/particlesystem.h>
+
+#include <glm/vec2.hpp>
+
+#include <span>
+#include <type_traits>
+
+namespace particlesystem {
+
+// A compile time list of types
+template <typename... Ts>
+struct TypeList {
+    static constexpr size_t size = sizeof...(Ts);
+};
+
+namespace detail {
+
+template <typename List, typename... Ts>
+struct Append;
+template <typename... Ts, typename... Us>
+struct Append<TypeList<Ts...>, Us...> {
+    using type = TypeList<Ts..., Us...>;
+};
+
+template <template <typename...> class Target, template <typename> class Wrap, typename List>
+struct Rebind;
+template <template <typename...> class Target, template <typename> class Wrap, typename... Ts>
+struct Rebind<Target, Wrap, TypeList<Ts...>> {
+    using type = Target<Wrap<Ts>...>;
+};
+
+template <typename T, typename List>
+struct Contains;
+template <typename T, typename... Ts>
+struct Contains<T, TypeList<Ts...>> : std::bool_constant<(std::is_same_v<T, Ts> || ...)> {};
+
+}  // namespace detail
+
+// TypeList<Ts..., Us...> for a TypeList<Ts...>
+template <typename List, typename... Us>
+using AppendT = typename detail::Append<List, Us...>::type;
+
+// Target<Wrap<Ts>...> for a TypeList<Ts...>, e.g. a std::tuple of containers
+template <template <typename...> class Target, template <typename> class Wrap, typename List>
+using RebindT = typename detail::Rebind<Target, Wrap, List>::type;
+
+template <typename T, typename List>
+inline constexpr bool ContainsV = detail::Contains<T, List>::value;
+
+/**
+ * The emitter and effect types a BasicParticleSystem stores, see DefaultRegistry. Each type gets
+ * its own contiguous container and every call into it is resolved at compile time.
+ */
+template <typename EmitterList, typename EffectList>
+struct Registry {
+    using Emitters = EmitterList;
+    using Effects = EffectList;
+};
+
+using DefaultRegistry =
+    Registry<TypeList<Uniform, Directional, Spinner>, TypeList<GravityWell, Wind>>;
+
+/**
+ * Adds types to a registry, for example
+ *     using MyRegistry = ExtendRegistry<DefaultRegistry, TypeList<MyEmitter>, TypeList<MyEffect>>;
+ *     particlesystem::BasicParticleSystem<MyRegistry> system;
+ */
+template <typename Base, typename MoreEmitters, typename MoreEffects = TypeList<>>
+struct ExtendRegistry;
+template <typename Base, typename... MoreEmitters, typename... MoreEffects>
+struct ExtendRegistry<Base, TypeList<MoreEmitters...>, TypeList<MoreEffects...>>
+    : Registry<AppendT<typename Base::Emitters, MoreEmitters...>,
+               AppendT<typename Base::Effects, MoreEffects...>> {};
+
+/**
+ * How a particle system creates the particles of an emitter of type T. The default calls the
+ * type's own generate() by name instead of through the vtable, so the compiler can inline it.
+ * Specialize it to give a type a different kernel.
+ */
+template <typename T>
+struct EmitterKernel {
+    static void generate(T& emitter, ParticleStore& out, size_t first, size_t count) {
+        emitter.T::generate(out, first, count);
+    }
+};
+
+/**
+ * How a particle system applies an effect of type T. Effects that can be packed into the fused
+ * EffectTable are evaluated there, the others through apply(). Like EmitterKernel, the default
+ * calls the type's own functions without virtual dispatch, and it can be specialized.
+ */
+template <typename T>
+struct EffectKernel {
+    // Returns false if the effect has to be applied through apply()
+    static bool pack(const T& effect, EffectTable& table) { return effect.T::pack(table); }
+
+    // Adds the acceleration from the effect to a chunk of particles
+    static void apply(T& effect, std::span<const glm::vec2> positions,
+                      std::span<glm::vec2> accelerations) {
+        effect.T::effectParticle(positions, accelerations);
+    }
+};
+
+}  // namespace particlesystem
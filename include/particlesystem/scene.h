@@ -0,0 +1,100 @@
+#pragma once
+
+#include <particlesystem/system.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Scene files describe the settings, emitters and effects of a particle system in a subset of
+ * TOML: tables, arrays of tables and single line key = value pairs whose values are numbers,
+ * strings, booleans or arrays of numbers.
+ *
+ *   [system]
+ *   capacity = 200_000
+ *   max_lifetime = 4.0
+ *   seed = 42
+ *
+ *   [[emitter]]
+ *   type = "directional"
+ *   position = [0.0, -0.8]
+ *   rate = 5000
+ *   direction = 1.57
+ *   width = 0.3
+ *
+ *   [[effect]]
+ *   type = "gravity_well"
+ *   position = [0.0, 0.3]
+ *   force = 0.05
+ *   range = 0.5
+ *
+ * [system] accepts capacity, overflow ("drop_newest", "recycle_oldest" or "grow"), max_lifetime,
+ * seed, tick_rate, max_substeps, threads, scheduler ("work_stealing" or "deterministic"),
+ * backend ("reference", "cpu" or "gl_compute", see BackendType) and integrator
+ * ("semi_implicit_euler", "velocity_verlet" or "rk4").
+ * Every emitter accepts type ("uniform", "directional" or "spinner"), position, color, radius and
+ * rate, directional emitters also direction and width, and spinners direction and spin_speed.
+ * Every effect accepts type ("gravity_well" or "wind"), position, color, radius, force and range.
+ * Anything that is left out keeps the default of the system or the object.
+ */
+namespace particlesystem {
+
+// An error in a scene file, what() reads "<file>:<line>: <message>"
+class SceneError : public std::runtime_error {
+public:
+    SceneError(std::string_view file, size_t line, std::string_view message);
+
+    size_t getLine() const { return line; }
+
+private:
+    size_t line;
+};
+
+struct EmitterDescription {
+    uint32_t type;  // Index into DefaultRegistry::Emitters
+    std::optional<glm::vec2> position;
+    std::optional<glm::vec4> color;
+    std::optional<float> radius;
+    std::optional<float> rate;
+    std::optional<float> direction;
+    std::optional<float> width;
+    std::optional<float> spinSpeed;
+};
+
+struct EffectDescription {
+    uint32_t type;  // Index into DefaultRegistry::Effects
+    std::optional<glm::vec2> position;
+    std::optional<glm::vec4> color;
+    std::optional<float> radius;
+    std::optional<float> force;
+    std::optional<float> range;  // The influence radius
+};
+
+struct SceneDescription {
+    ParticleSystem::Settings settings;
+    // The master seed, see setMasterSeed
+    std::optional<uint64_t> seed;
+    std::vector<EmitterDescription> emitters;
+    std::vector<EffectDescription> effects;
+
+    // Sets the master seed if the scene has one and adds the emitters and effects to the system
+    void populate(ParticleSystem& system) const;
+};
+
+/**
+ * Parses a scene in a single pass over the text
+ * @param file The name used in the error messages
+ * \throw SceneError if the text is not a valid scene
+ */
+SceneDescription parseScene(std::string_view text, std::string_view file = "scene");
+
+// \throw std::runtime_error if the file could not be read, SceneError if it is not a valid scene
+SceneDescription loadScene(const std::string& path);
+
+}  // namespace particlesystem
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace particlesystem {
+
+/**
+ * A thread pool that runs data parallel loops over a range of particles. The range is split into
+ * chunks whose length is a multiple of 16 elements, so for float, glm::vec2 and glm::vec4 arrays
+ * that start on a cache line boundary every chunk starts on a cache line boundary as well and no
+ * two threads write to the same cache line.
+ *
+ * Each thread owns a deque of chunks. A thread takes chunks from the front of its own deque and
+ * once that is empty, it steals chunks from the back of the other threads' deques.
+ */
+class Scheduler {
+public:
+    enum class Mode {
+        // Chunk sizes are picked based on the number of threads to balance the load
+        WorkStealing,
+        // Chunk boundaries only depend on the number of elements, which gives bit identical
+        // results regardless of the thread count even for kernels that treat the end of a
+        // chunk differently, such as SIMD kernels with a scalar tail
+        Deterministic
+    };
+
+    // Number of elements in a chunk is always a multiple of this
+    static constexpr size_t ChunkAlignment = 16;
+    // Chunk size used in deterministic mode
+    static constexpr size_t DeterministicChunkSize = 4096;
+
+    /**
+     * Construct a scheduler and start its worker threads
+     * @param threadCount Total number of threads including the calling thread, 0 means one per
+     * hardware thread
+     * @param mode How the ranges are split into chunks
+     */
+    explicit Scheduler(size_t threadCount = 0, Mode mode = Mode::WorkStealing);
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+    ~Scheduler();
+
+    size_t getThreadCount() const { return threadCount; }
+    Mode getMode() const { return mode; }
+
+    // Returns the chunk size used for a range of 'count' elements
+    size_t chunkSize(size_t count) const;
+
+    /**
+     * Calls fn(begin, end) for consecutive chunks that together cover [0, count) exactly once.
+     * The chunks are run in parallel and the call blocks until all of them have completed. The
+     * calling thread takes part in the work. Must not be called from within another parallelFor.
+     */
+    template <typename Fn>
+    void parallelFor(size_t count, Fn&& fn) {
+        auto call = [](void* ctx, size_t begin, size_t end) {
+            (*static_cast<std::remove_reference_t<Fn>*>(ctx))(begin, end);
+        };
+        run(count, call, &fn);
+    }
+
+private:
+    using ChunkFunction = void (*)(void* ctx, size_t begin, size_t end);
+
+    // The chunk indices [begin, end) that a thread has left to run, packed into one word so
+    // that the owner and thieves can update it with a single compare and swap
+    struct alignas(64) Deque {
+        std::atomic<uint64_t> range{0};
+
+        void assign(uint32_t begin, uint32_t end);
+        bool popFront(uint32_t& chunk);
+        bool popBack(uint32_t& chunk);
+    };
+
+    void run(size_t count, ChunkFunction fn, void* ctx);
+    void runChunks(size_t self);
+    void workerLoop(size_t self);
+
+    size_t threadCount;
+    Mode mode;
+    std::vector<std::thread> threads;
+    std::unique_ptr<Deque[]> workers;
+
+    // The loop that is currently running
+    ChunkFunction jobFunction = nullptr;
+    void* jobContext = nullptr;
+    size_t jobCount = 0;
+    size_t jobChunkSize = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation = 0;
+    size_t busyWorkers = 0;
+    bool stopping = false;
+};
+
+}  // namespace particlesystem
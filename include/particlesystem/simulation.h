@@ -0,0 +1,77 @@
+#pragma once
+
+#include <particlesystem/alignedallocator.h>
+#include <particlesystem/effecttable.h>
+#include <particlesystem/particlestore.h>
+#include <particlesystem/scheduler.h>
+#include <particlesystem/spatialgrid.h>
+
+#include <glm/vec2.hpp>
+
+#include <functional>
+#include <span>
+
+class Effect;
+
+// Simulation phases that run over all particles in parallel on a scheduler. Each particle is only
+// touched by the thread that owns its chunk, and within a particle the effects are applied in the
+// same order as a sequential loop would.
+//
+// The effects write the force of the particles, which is the acceleration they cause in the
+// current step. It is reset every time the effects are applied, while the acceleration given to a
+// particle by its emitter stays the same for its whole life.
+namespace particlesystem {
+
+// Sets the force of the particles to the acceleration from every effect, one effect at a time
+void applyEffects(std::span<Effect* const> effects, ParticleStore& particles, Scheduler& scheduler);
+
+// Sets the force of the particles to the acceleration from every effect in the table in a single
+// pass
+void applyEffects(const EffectTable& effects, ParticleStore& particles, Scheduler& scheduler);
+
+// Same as above, but effects with a finite range only visit the particles within their range.
+// The grid is rebuilt from the current particle positions when the table has such effects.
+void applyEffects(const EffectTable& effects, ParticleStore& particles, Scheduler& scheduler,
+                  SpatialGrid& grid);
+
+// Sets forces[i] to the acceleration from every effect in the table at positions[i], the same as
+// applyEffects but for any set of positions
+void evaluateForces(const EffectTable& effects, std::span<const glm::vec2> positions,
+                    std::span<glm::vec2> forces, Scheduler& scheduler, SpatialGrid& grid);
+
+// Updates the velocity and position of the particles based on acceleration and time (dt), see
+// ParticleStore::updatePosition
+void integrate(ParticleStore& particles, double dt, Scheduler& scheduler);
+
+enum class Integrator {
+    SemiImplicitEuler,  // First order and symplectic, the forces are evaluated once per step
+    VelocityVerlet,     // Second order and symplectic, two force evaluations per step
+    RungeKutta4         // Fourth order, four force evaluations per step
+};
+
+// Returns the name of the integrator, e.g. "velocity_verlet"
+const char* toString(Integrator integrator);
+
+// Sets forces[i] to the acceleration from the effects at positions[i]
+using ForceField =
+    std::function<void(std::span<const glm::vec2> positions, std::span<glm::vec2> forces)>;
+
+// The intermediate state of the integrators with several stages, the memory is reused
+struct IntegratorBuffers {
+    AlignedVector<glm::vec2> position;
+    AlignedVector<glm::vec2> velocity;
+    AlignedVector<glm::vec2> positionChange;
+    AlignedVector<glm::vec2> velocityChange;
+};
+
+/**
+ * Advances the particles by dt with the integrator
+ * @param particles Their force has to hold the forces at their current positions, e.g. from
+ * applyEffects. Afterwards it holds the forces of the last stage of the integrator.
+ * @param forces Evaluates the forces at the intermediate positions of the integrators that have
+ * more than one stage. It is called from the calling thread.
+ */
+void integrate(ParticleStore& particles, double dt, Integrator integrator,
+               const ForceField& forces, IntegratorBuffers& buffers, Scheduler& scheduler);
+
+}  // namespace particlesystem
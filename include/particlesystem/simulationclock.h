@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+namespace particlesystem {
+
+/**
+ * Turns the variable time between rendered frames into a whole number of fixed simulation steps.
+ * The elapsed time is accumulated and consumed in steps of 1 / tickRate seconds, so the cost of
+ * the simulation per second only depends on the tick rate and the result only depends on the
+ * number of steps, not on the frame rate.
+ *
+ * The time left over after the last step is exposed as an interpolation factor between the
+ * previous and the current simulation state, see ParticleStore::interpolatePosition.
+ */
+class SimulationClock {
+public:
+    static constexpr double DefaultTickRate = 60.0;
+    static constexpr int DefaultMaxSubsteps = 8;
+
+    /**
+     * Construct a clock with no accumulated time
+     * @param tickRate The number of simulation steps per second
+     * @param maxSubsteps The largest number of steps a single frame may run. Time beyond that is
+     * dropped, so that a long hitch does not make the following frames even slower.
+     */
+    explicit SimulationClock(double tickRate = DefaultTickRate,
+                             int maxSubsteps = DefaultMaxSubsteps);
+
+    /**
+     * Adds the time since the previous frame
+     * @param elapsed Wall clock time in seconds, negative values are ignored
+     * @return The number of fixed steps to simulate this frame, at most getMaxSubsteps()
+     */
+    int advance(double elapsed);
+
+    // Length of a simulation step in seconds
+    double getTimestep() const { return timestep; }
+
+    // Fraction of a step accumulated after the last step, in [0, 1)
+    float getAlpha() const;
+
+    double getTickRate() const { return 1.0 / timestep; }
+    // Changes the length of the coming steps, the accumulated time is kept
+    void setTickRate(double tickRate);
+
+    int getMaxSubsteps() const { return maxSubsteps; }
+    void setMaxSubsteps(int maxSubsteps);
+
+    // Total number of steps returned by advance
+    uint64_t getTickCount() const { return tickCount; }
+    // Total time dropped because a frame needed more than getMaxSubsteps() steps
+    double getDroppedTime() const { return droppedTime; }
+
+    // Drops the accumulated time and resets the counters
+    void reset();
+
+private:
+    double timestep;
+    int maxSubsteps;
+    double accumulator = 0.0;
+    double droppedTime = 0.0;
+    uint64_t tickCount = 0;
+};
+
+}  // namespace particlesystem
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace particlesystem {
+
+/**
+ * Refers to an object in a SlotMap<T>. A handle stays valid while its object lives, regardless of
+ * what else is added or removed, and never refers to a different object once its own has been
+ * removed: the slot's generation is bumped on removal, so old handles no longer match it.
+ */
+template <typename T>
+struct Handle {
+    using Type = T;
+    static constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+    uint32_t index = InvalidIndex;
+    uint32_t generation = 0;
+
+    bool operator==(const Handle&) const = default;
+};
+
+/**
+ * Stores objects of a single type contiguously and hands out stable handles to them. Removing an
+ * object moves the last one into its place, so iterating over values() always visits a dense
+ * array. Lookups go through a slot table that maps the handle to the object's current position.
+ */
+template <typename T>
+class SlotMap {
+public:
+    using value_type = T;
+
+    size_t size() const { return objects.size(); }
+    bool empty() const { return objects.empty(); }
+
+    template <typename... Args>
+    Handle<T> emplace(Args&&... args) {
+        uint32_t slot;
+        if (freeSlots.empty()) {
+            slot = static_cast<uint32_t>(slots.size());
+            slots.push_back({});
+        } else {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        slots[slot].dense = static_cast<uint32_t>(objects.size());
+        objects.emplace_back(std::forward<Args>(args)...);
+        denseToSlot.push_back(slot);
+        return {slot, slots[slot].generation};
+    }
+
+    Handle<T> insert(T value) { return emplace(std::move(value)); }
+
+    // Removes the object, returns false if the handle did not refer to a live object
+    bool erase(Handle<T> handle) {
+        if (!contains(handle)) return false;
+
+        const uint32_t dense = slots[handle.index].dense;
+        const uint32_t last = static_cast<uint32_t>(objects.size() - 1);
+        if (dense != last) {
+            objects[dense] = std::move(objects[last]);
+            denseToSlot[dense] = denseToSlot[last];
+            slots[denseToSlot[dense]].dense = dense;
+        }
+        objects.pop_back();
+        denseToSlot.pop_back();
+
+        slots[handle.index].dense = Slot::Free;
+        slots[handle.index].generation++;
+        freeSlots.push_back(handle.index);
+        return true;
+    }
+
+    bool contains(Handle<T> handle) const {
+        return handle.index < slots.size() && slots[handle.index].generation == handle.generation &&
+               slots[handle.index].dense != Slot::Free;
+    }
+
+    // Returns the object or nullptr if the handle does not refer to a live object
+    T* get(Handle<T> handle) {
+        return contains(handle) ? &objects[slots[handle.index].dense] : nullptr;
+    }
+    const T* get(Handle<T> handle) const {
+        return contains(handle) ? &objects[slots[handle.index].dense] : nullptr;
+    }
+
+    // The handle of the object at position i in values()
+    Handle<T> handleAt(size_t i) const {
+        assert(i < objects.size());
+        return {denseToSlot[i], slots[denseToSlot[i]].generation};
+    }
+
+    std::span<T> values() { return objects; }
+    std::span<const T> values() const { return objects; }
+
+    void clear() {
+        while (!objects.empty()) {
+            erase(handleAt(objects.size() - 1));
+        }
+    }
+
+private:
+    struct Slot {
+        static constexpr uint32_t Free = std::numeric_limits<uint32_t>::max();
+        uint32_t dense = Free;  // Position of the object in 'objects'
+        uint32_t generation = 0;
+    };
+
+    std::vector<T> objects;
+    std::vector<uint32_t> denseToSlot;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+};
+
+}  // namespace particlesystem
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <particlesystem/particlepool.h>
+#include <particlesystem/particlestore.h>
+#include <particlesystem/system.h>
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/* Binary snapshots of a particle system.
+ *
+ * A snapshot is a header followed by a sequence of chunks and a table describing them. All
+ * values are little endian. Each chunk is a contiguous array of fixed size elements that starts on
+ * a 64 byte boundary, so that an attribute can be used directly from a memory mapped file, e.g. by
+ * SIMD loads, without any parsing.
+ *
+ *   offset 0           SnapshotHeader, 64 bytes
+ *   64, 128, ...       The chunks in the order they were written, padded to 64 bytes
+ *   tableOffset        SnapshotChunk[chunkCount]
+ *
+ * Readers ignore chunks they do not know, so chunks may be added without changing the version.
+ */
+namespace particlesystem {
+
+static_assert(std::endian::native == std::endian::little,
+              "Snapshots are stored little endian and mapped without conversion");
+
+// Identifies a chunk by four ASCII characters, e.g. chunkId("POS ")
+constexpr uint32_t chunkId(const char (&name)[5]) {
+    return static_cast<uint32_t>(static_cast<unsigned char>(name[0])) |
+           static_cast<uint32_t>(static_cast<unsigned char>(name[1])) << 8 |
+           static_cast<uint32_t>(static_cast<unsigned char>(name[2])) << 16 |
+           static_cast<uint32_t>(static_cast<unsigned char>(name[3])) << 24;
+}
+
+namespace chunks {
+// One element per particle
+inline constexpr uint32_t Position = chunkId("POS ");
+inline constexpr uint32_t PreviousPosition = chunkId("PPOS");
+inline constexpr uint32_t Velocity = chunkId("VEL ");
+inline constexpr uint32_t Acceleration = chunkId("ACC ");
+inline constexpr uint32_t Lifetime = chunkId("LIFE");
+inline constexpr uint32_t Radius = chunkId("RAD ");
+inline constexpr uint32_t Color = chunkId("COL ");
+// One EmitterRecord or EffectRecord per object, in the order they were added to the system
+inline constexpr uint32_t Emitters = chunkId("EMIT");
+inline constexpr uint32_t Effects = chunkId("EFCT");
+// A single SystemRecord
+inline constexpr uint32_t System = chunkId("SYST");
+}  // namespace chunks
+
+inline constexpr size_t SnapshotAlignment = 64;
+inline constexpr uint32_t SnapshotVersion = 2;
+
+struct SnapshotHeader {
+    char magic[8];  // "PSYSSNAP"
+    uint32_t version;
+    uint32_t chunkCount;
+    uint64_t tableOffset;
+    uint64_t fileSize;
+    uint8_t reserved[32];
+};
+static_assert(sizeof(SnapshotHeader) == SnapshotAlignment);
+
+struct SnapshotChunk {
+    uint32_t id;
+    uint32_t elementSize;
+    uint64_t count;
+    uint64_t offset;  // From the start of the file, a multiple of SnapshotAlignment
+    uint64_t size;    // elementSize * count, without the padding
+};
+static_assert(sizeof(SnapshotChunk) == 32);
+
+struct SystemRecord {
+    double tickRate;
+    int32_t maxSubsteps;
+    float maxLifetime;
+    uint32_t integrator;  // Integrator
+    uint32_t reserved;
+};
+static_assert(sizeof(SystemRecord) == 24);
+
+// An emitter of the default registry. The fields that only some types use are zero for the others.
+struct EmitterRecord {
+    uint32_t type;  // Index into DefaultRegistry::Emitters
+    float radius;
+    glm::vec2 position;
+    glm::vec4 color;
+    float rate;
+    float pending;
+    float direction;  // Directional and Spinner
+    float width;      // Directional
+    float spinSpeed;  // Spinner
+    uint32_t reserved;
+    uint64_t randomSeed;
+    uint64_t randomStream;
+    uint64_t randomPosition;
+};
+static_assert(sizeof(EmitterRecord) == 80);
+
+// An effect of the default registry
+struct EffectRecord {
+    uint32_t type;  // Index into DefaultRegistry::Effects
+    float radius;
+    glm::vec2 position;
+    glm::vec4 color;
+    float influenceRadius;
+    float force;
+};
+static_assert(sizeof(EffectRecord) == 40);
+
+// A read only view of a whole file through the virtual memory system
+class MappedFile {
+public:
+    // \throw std::runtime_error if the file could not be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    std::span<const std::byte> data() const { return {bytes, size}; }
+
+private:
+    void close();
+
+    const std::byte* bytes = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+/**
+ * Writes a snapshot one chunk at a time. Each chunk goes straight to the file, so nothing but the
+ * chunk table is held in memory. The file is only valid after finish() has been called.
+ */
+class SnapshotWriter {
+public:
+    // \throw std::runtime_error if the file could not be created
+    explicit SnapshotWriter(const std::string& path);
+
+    template <typename T>
+    void write(uint32_t id, std::span<const T> elements) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        writeChunk(id, sizeof(T), elements.size(), std::as_bytes(elements));
+    }
+
+    /**
+     * Appends a chunk of 'count' elements of 'elementSize' bytes each
+     * \throw std::runtime_error if the data could not be written
+     */
+    void writeChunk(uint32_t id, uint32_t elementSize, uint64_t count,
+                    std::span<const std::byte> data);
+
+    // Writes the chunk table and completes the header
+    void finish();
+
+private:
+    void pad();
+
+    std::string path;
+    std::ofstream file;
+    std::vector<SnapshotChunk> table;
+    uint64_t offset = 0;
+};
+
+/**
+ * A snapshot file mapped into memory. Loading only validates the header and the chunk table, the
+ * chunks themselves are accessed in place.
+ */
+class Snapshot {
+public:
+    // \throw std::runtime_error if the file could not be mapped or is not a valid snapshot
+    explicit Snapshot(const std::string& path);
+
+    uint32_t getVersion() const { return header().version; }
+    std::span<const SnapshotChunk> getChunks() const { return table; }
+    bool contains(uint32_t id) const { return find(id) != nullptr; }
+
+    /**
+     * The elements of a chunk, pointing into the mapped file
+     * \throw std::runtime_error if there is no such chunk or its elements are not of type T
+     */
+    template <typename T>
+    std::span<const T> get(uint32_t id) const {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const SnapshotChunk& chunk = require(id, sizeof(T));
+        return {reinterpret_cast<const T*>(file.data().data() + chunk.offset),
+                static_cast<size_t>(chunk.count)};
+    }
+
+private:
+    const SnapshotHeader& header() const {
+        return *reinterpret_cast<const SnapshotHeader*>(file.data().data());
+    }
+    const SnapshotChunk* find(uint32_t id) const;
+    const SnapshotChunk& require(uint32_t id, size_t elementSize) const;
+
+    MappedFile file;
+    std::span<const SnapshotChunk> table;
+};
+
+// The settings of a system that can change while it runs
+SystemRecord toRecord(const ParticleSystem& system);
+// \throw std::runtime_error if the record is invalid
+void applyRecord(ParticleSystem& system, const SystemRecord& record);
+
+// The current state of an emitter or effect
+EmitterRecord toRecord(const ParticleSystem& system, EmitterHandle handle);
+EffectRecord toRecord(const ParticleSystem& system, EffectHandle handle);
+
+/**
+ * Sets the emitter to the state in the record, which must be of the same type
+ * @param restoreState Also restore the random stream and the pending fraction of a particle, and
+ * not only what can be edited
+ */
+void applyRecord(ParticleSystem& system, EmitterHandle handle, const EmitterRecord& record,
+                 bool restoreState = true);
+void applyRecord(ParticleSystem& system, EffectHandle handle, const EffectRecord& record);
+
+// Adds an emitter or effect of the type in the record and sets it to the record's state
+EmitterHandle addFromRecord(ParticleSystem& system, const EmitterRecord& record);
+EffectHandle addFromRecord(ParticleSystem& system, const EffectRecord& record);
+
+// Adds a default constructed emitter or effect of the type with the given index in the registry
+// \throw std::runtime_error if there is no type with the index
+EmitterHandle addEmitterOfType(ParticleSystem& system, uint32_t type);
+EffectHandle addEffectOfType(ParticleSystem& system, uint32_t type);
+
+// Writes every attribute of the particles
+void writeParticles(SnapshotWriter& writer, const ParticleStore& particles);
+
+/**
+ * Replaces the particles in the pool by those in the snapshot. If they do not all fit, a
+ * RecycleOldest pool keeps the youngest particles and the other policies keep the first ones.
+ * @return The number of particles restored
+ */
+size_t readParticles(const Snapshot& snapshot, ParticlePool& pool);
+
+/**
+ * Saves the particles, emitters, effects and settings of the system, including the state of the
+ * emitters' random streams, so that a restored system continues exactly like the saved one
+ */
+void saveSnapshot(const ParticleSystem& system, const std::string& path);
+
+// Replaces the particles, emitters, effects and settings of the system by those in the snapshot
+void loadSnapshot(ParticleSystem& system, const Snapshot& snapshot);
+void loadSnapshot(ParticleSystem& system, const std::string& path);
+
+}  // namespace particlesystem
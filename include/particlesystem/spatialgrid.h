@@ -0,0 +1,143 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace particlesystem {
+
+/**
+ * A uniform grid over particle positions used to find all particles within a radius without
+ * visiting every particle. The grid is unbounded: cells are hashed into a table whose size
+ * follows the number of particles, and the particles are sorted by bucket with a counting sort, so
+ * building it is O(n) and reuses its memory between builds.
+ *
+ * The grid stores particle indices, the positions passed to the queries must be the same ones the
+ * grid was built from.
+ */
+class SpatialGrid {
+public:
+    explicit SpatialGrid(float cellSize = 0.05f);
+
+    float getCellSize() const { return cellSize; }
+    // Takes effect on the next build
+    void setCellSize(float size);
+
+    // Sorts the particles into the grid cells
+    void build(std::span<const glm::vec2> positions);
+
+    // Number of particles in the grid
+    size_t size() const { return sortedIndices.size(); }
+    // Number of hash buckets, every particle is in exactly one
+    uint32_t getBucketCount() const {
+        return bucketStart.empty() ? 0 : static_cast<uint32_t>(bucketStart.size() - 1);
+    }
+
+    /**
+     * Calls fn(index) once for every particle within 'radius' of 'center'
+     * @param positions The positions the grid was built from
+     */
+    template <typename Fn>
+    void forEachNeighbour(std::span<const glm::vec2> positions, glm::vec2 center, float radius,
+                          Fn&& fn) const;
+
+    /**
+     * Like forEachNeighbour but only reports the particles in the buckets [beginBucket,
+     * endBucket), so queries over disjoint bucket ranges never report the same particle
+     */
+    template <typename Fn>
+    void forEachNeighbour(std::span<const glm::vec2> positions, glm::vec2 center, float radius,
+                          uint32_t beginBucket, uint32_t endBucket, Fn&& fn) const;
+
+    // Appends the index of every particle within 'radius' of 'center' to 'result'
+    void query(std::span<const glm::vec2> positions, glm::vec2 center, float radius,
+               std::vector<uint32_t>& result) const;
+
+private:
+    struct Cell {
+        int x;
+        int y;
+        bool operator==(const Cell&) const = default;
+    };
+
+    Cell cellOf(glm::vec2 position) const;
+    uint32_t bucketOf(Cell cell) const;
+
+    float cellSize;
+    float invCellSize;
+    uint32_t bucketMask;
+    // Particles in bucket b are sortedIndices[bucketStart[b], bucketStart[b + 1])
+    std::vector<uint32_t> bucketStart;
+    std::vector<uint32_t> sortedIndices;
+    std::vector<uint32_t> particleBucket;
+};
+
+inline SpatialGrid::Cell SpatialGrid::cellOf(glm::vec2 position) const {
+    // Keep the coordinates representable as int, this also maps NaN to the lowest cell
+    constexpr float limit = 1.0e9f;
+    auto coordinate = [&](float v) {
+        float c = std::floor(v * invCellSize);
+        if (!(c >= -limit)) c = -limit;
+        if (c > limit) c = limit;
+        return static_cast<int>(c);
+    };
+    return {coordinate(position.x), coordinate(position.y)};
+}
+
+inline uint32_t SpatialGrid::bucketOf(Cell cell) const {
+    const uint32_t h = static_cast<uint32_t>(cell.x) * 73856093u ^
+                       static_cast<uint32_t>(cell.y) * 19349663u;
+    return h & bucketMask;
+}
+
+template <typename Fn>
+void SpatialGrid::forEachNeighbour(std::span<const glm::vec2> positions, glm::vec2 center,
+                                   float radius, Fn&& fn) const {
+    forEachNeighbour(positions, center, radius, 0, getBucketCount(), fn);
+}
+
+template <typename Fn>
+void SpatialGrid::forEachNeighbour(std::span<const glm::vec2> positions, glm::vec2 center,
+                                   float radius, uint32_t beginBucket, uint32_t endBucket,
+                                   Fn&& fn) const {
+    if (sortedIndices.empty() || !(radius >= 0.0f) || beginBucket >= endBucket) return;
+
+    const float radius2 = radius * radius;
+    auto visit = [&](uint32_t begin, uint32_t end, auto&& accept) {
+        for (uint32_t i = begin; i < end; ++i) {
+            const uint32_t index = sortedIndices[i];
+            const glm::vec2 d = positions[index] - center;
+            if (d.x * d.x + d.y * d.y <= radius2 && accept(index)) {
+                fn(index);
+            }
+        }
+    };
+
+    const Cell low = cellOf(center - glm::vec2{radius, radius});
+    const Cell high = cellOf(center + glm::vec2{radius, radius});
+    const double cells = (static_cast<double>(high.x) - low.x + 1.0) *
+                         (static_cast<double>(high.y) - low.y + 1.0);
+
+    if (cells >= static_cast<double>(endBucket - beginBucket)) {
+        // The query covers more cells than there are buckets, visit every bucket once instead
+        visit(bucketStart[beginBucket], bucketStart[endBucket], [](uint32_t) { return true; });
+        return;
+    }
+
+    for (int y = low.y; y <= high.y; ++y) {
+        for (int x = low.x; x <= high.x; ++x) {
+            const Cell cell{x, y};
+            const uint32_t bucket = bucketOf(cell);
+            if (bucket < beginBucket || bucket >= endBucket) continue;
+            // Several cells can share a bucket, only accept the particles of this cell so that
+            // no particle is reported twice
+            visit(bucketStart[bucket], bucketStart[bucket + 1],
+                  [&](uint32_t index) { return cellOf(positions[index]) == cell; });
+        }
+    }
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <particlesystem/backend.h>
+#include <particlesystem/effecttable.h>
+#include <particlesystem/particlepool.h>
+#include <particlesystem/particlesystem.h>
+#include <particlesystem/profiler.h>
+#include <particlesystem/registry.h>
+#include <particlesystem/scheduler.h>
+#include <particlesystem/simulation.h>
+#include <particlesystem/simulationclock.h>
+#include <particlesystem/slotmap.h>
+
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace particlesystem {
+
+/**
+ * A complete particle simulation: the particles together with the emitters and effects acting on
+ * them. Every emitter and effect type in the registry is stored by value in its own contiguous
+ * container and is referred to by a handle that stays valid until the object is removed. The
+ * containers are processed one type at a time through EmitterKernel and EffectKernel, so no
+ * virtual function is called during a step.
+ *
+ * A simulation step runs the phases emit, applyEffects, retire and integrate in that order. They
+ * are public so that each phase can be timed on its own, but step() is all that is needed to run
+ * the simulation. The data parallel work of applyEffects and integrate is done by a
+ * SimulationBackend, which can be swapped at runtime.
+ *
+ * applyEffects evaluates the forces at the current positions, and integrators with more than one
+ * stage evaluate them again at their intermediate positions during integrate.
+ */
+template <typename R = DefaultRegistry>
+class BasicParticleSystem {
+public:
+    using Emitters = typename R::Emitters;
+    using Effects = typename R::Effects;
+
+    // Refers to an emitter or effect of any registered type
+    using EmitterHandle = RebindT<std::variant, Handle, Emitters>;
+    using EffectHandle = RebindT<std::variant, Handle, Effects>;
+
+    struct Settings {
+        // Maximum number of live particles and what happens to particles beyond that
+        size_t capacity = ParticlePool::DefaultCapacity;
+        OverflowPolicy overflowPolicy = OverflowPolicy::DropNewest;
+        // Particles older than this are removed, in seconds
+        float maxLifetime = 4.0f;
+        // Number of scheduler threads, 0 uses all hardware threads
+        size_t threadCount = 0;
+        Scheduler::Mode schedulerMode = Scheduler::Mode::WorkStealing;
+        double tickRate = SimulationClock::DefaultTickRate;
+        int maxSubsteps = SimulationClock::DefaultMaxSubsteps;
+        BackendType backend = BackendType::Cpu;
+        Integrator integrator = Integrator::SemiImplicitEuler;
+    };
+
+    BasicParticleSystem() : BasicParticleSystem(Settings{}) {}
+    explicit BasicParticleSystem(const Settings& settings)
+        : pool(settings.capacity, settings.overflowPolicy)
+        , scheduler(settings.threadCount, settings.schedulerMode)
+        , backend(makeBackend(settings.backend, scheduler))
+        , clock(settings.tickRate, settings.maxSubsteps)
+        , maxLifetime{settings.maxLifetime}
+        , integrator{settings.integrator} {}
+
+    BasicParticleSystem(const BasicParticleSystem&) = delete;
+    BasicParticleSystem& operator=(const BasicParticleSystem&) = delete;
+
+    // Adds a copy of the emitter, the new emitter is the last one in getEmitters()
+    template <typename T>
+        requires ContainsV<T, Emitters>
+    Handle<T> addEmitter(T emitter = {}) {
+        const Handle<T> handle = container<T>().insert(std::move(emitter));
+        emitterOrder.push_back(handle);
+        return handle;
+    }
+
+    // Adds a copy of the effect, the new effect is the last one in getEffects()
+    template <typename T>
+        requires ContainsV<T, Effects>
+    Handle<T> addEffect(T effect = {}) {
+        const Handle<T> handle = container<T>().insert(std::move(effect));
+        effectOrder.push_back(handle);
+        return handle;
+    }
+
+    // Removes the emitter or effect, returns false if the handle was no longer valid
+    bool remove(EmitterHandle handle) { return removeHandle(emitterOrder, handle); }
+    bool remove(EffectHandle handle) { return removeHandle(effectOrder, handle); }
+
+    // Returns the object or nullptr if the handle is no longer valid
+    template <typename T>
+    T* get(Handle<T> handle) {
+        return container<T>().get(handle);
+    }
+    Emitter* get(EmitterHandle handle) {
+        return std::visit([&](auto h) -> Emitter* { return get(h); }, handle);
+    }
+    Effect* get(EffectHandle handle) {
+        return std::visit([&](auto h) -> Effect* { return get(h); }, handle);
+    }
+    template <typename T>
+    const T* get(Handle<T> handle) const {
+        return container<T>().get(handle);
+    }
+    const Emitter* get(EmitterHandle handle) const {
+        return std::visit([&](auto h) -> const Emitter* { return get(h); }, handle);
+    }
+    const Effect* get(EffectHandle handle) const {
+        return std::visit([&](auto h) -> const Effect* { return get(h); }, handle);
+    }
+
+    // Every emitter and effect in the order they were added
+    std::span<const EmitterHandle> getEmitters() const { return emitterOrder; }
+    std::span<const EffectHandle> getEffects() const { return effectOrder; }
+
+    // All emitters or effects of one type, in no particular order
+    template <typename T>
+    std::span<T> all() {
+        return container<T>().values();
+    }
+
+    /**
+     * Advances the clock by the elapsed wall clock time and runs the fixed steps that are due
+     * @return The number of steps that were run
+     */
+    int update(double elapsed) {
+        const int steps = clock.advance(elapsed);
+        for (int i = 0; i < steps; ++i) {
+            step(clock.getTimestep());
+        }
+        return steps;
+    }
+
+    // Runs a single simulation step of 'dt' seconds
+    void step(double dt) {
+        emit(dt);
+        applyEffects();
+        retire(dt);
+        integrate(dt);
+    }
+
+    // The phases of a step
+    void emit(double dt);
+    void applyEffects();
+    // Ages the particles and removes the expired ones
+    void retire(double dt);
+    // Saves the previous positions and moves the particles, using the effects packed by the
+    // latest applyEffects
+    void integrate(double dt);
+
+    // Removes all particles, but keeps the emitters and effects
+    void clearParticles() {
+        pool.clear();
+        reusableForces = 0;
+    }
+
+    const ParticleStore& particles() const { return pool.particles(); }
+    // The particles may be changed through the pool, so the forces are evaluated again
+    ParticlePool& getPool() {
+        reusableForces = 0;
+        return pool;
+    }
+    const ParticlePool& getPool() const { return pool; }
+    SimulationClock& getClock() { return clock; }
+    const SimulationClock& getClock() const { return clock; }
+    Scheduler& getScheduler() { return scheduler; }
+
+    // Replaces the backend, the particles are kept
+    // \throw std::runtime_error if the backend is not available
+    void setBackend(BackendType type) {
+        backend = makeBackend(type, scheduler);
+        reusableForces = 0;
+    }
+    SimulationBackend& getBackend() { return *backend; }
+
+    float getMaxLifetime() const { return maxLifetime; }
+    void setMaxLifetime(float lifetime) { maxLifetime = lifetime; }
+
+    Integrator getIntegrator() const { return integrator; }
+    void setIntegrator(Integrator type) { integrator = type; }
+
+private:
+    // The effects of one type that could not be packed into the effect table
+    template <typename T>
+    using Unpacked = std::vector<T*>;
+
+    template <typename T>
+    SlotMap<T>& container() {
+        if constexpr (ContainsV<T, Emitters>) {
+            return std::get<SlotMap<T>>(emitters);
+        } else {
+            return std::get<SlotMap<T>>(effects);
+        }
+    }
+    template <typename T>
+    const SlotMap<T>& container() const {
+        return const_cast<BasicParticleSystem*>(this)->container<T>();
+    }
+
+    // Sets forces[i] to the acceleration from every effect at positions[i]
+    void evaluateForces(std::span<const glm::vec2> positions, std::span<glm::vec2> forces);
+    bool hasUnpacked() const {
+        return std::apply([](const auto&... rest) { return (!rest.empty() || ...); }, unpacked);
+    }
+
+    template <typename HandleVariant>
+    bool removeHandle(std::vector<HandleVariant>& order, HandleVariant handle) {
+        const bool erased =
+            std::visit([&](auto h) { return container<typename decltype(h)::Type>().erase(h); },
+                       handle);
+        if (erased) {
+            order.erase(std::ranges::find(order, handle));
+        }
+        return erased;
+    }
+
+    ParticlePool pool;
+    Scheduler scheduler;
+    std::unique_ptr<SimulationBackend> backend;
+    SimulationClock clock;
+    EffectTable effectTable;
+    // The table of the previous applyEffects, to tell whether the effects have changed since
+    EffectTable previousEffectTable;
+    // The particles at the front of the store whose forces were evaluated at their current
+    // position with the latest effect table, which a Velocity Verlet step leaves behind
+    size_t reusableForces = 0;
+    float maxLifetime;
+    Integrator integrator;
+
+    RebindT<std::tuple, SlotMap, Emitters> emitters;
+    RebindT<std::tuple, SlotMap, Effects> effects;
+    std::vector<EmitterHandle> emitterOrder;
+    std::vector<EffectHandle> effectOrder;
+    // Rebuilt every step, the memory is reused
+    RebindT<std::tuple, Unpacked, Effects> unpacked;
+    // The number of particles due from every emitter in the current step, in emitter order
+    std::vector<size_t> emitterDue;
+};
+
+template <typename R>
+void BasicParticleSystem<R>::emit(double dt) {
+    PARTICLESYSTEM_PROFILE_ZONE("emit");
+    const auto fdt = static_cast<float>(dt);
+    const size_t overflowBefore = pool.getOverflowCount();
+    auto forEachEmitter = [&](auto&& fn) {
+        std::apply(
+            [&]<typename... T>(SlotMap<T>&... container) {
+                auto visit = [&]<typename E>(std::span<E> all) {
+                    for (E& emitter : all) fn(emitter);
+                };
+                (visit(container.values()), ...);
+            },
+            emitters);
+    };
+
+    // Room for the particles of all emitters is made at once, so a full RecycleOldest pool selects
+    // the particles to recycle once per step instead of once per emitter
+    emitterDue.clear();
+    size_t total = 0;
+    forEachEmitter([&](auto& emitter) {
+        emitterDue.push_back(emitter.particlesDue(fdt));
+        total += emitterDue.back();
+    });
+    const size_t first = pool.acquire(total);
+    ParticleStore& store = pool.particles();
+    // Like a single spawn, a request that does not fit keeps its last particles when recycling
+    // and its first particles otherwise
+    size_t skip = pool.getPolicy() == OverflowPolicy::RecycleOldest ? total - (store.size() - first)
+                                                                     : 0;
+    size_t next = first;
+    size_t index = 0;
+    forEachEmitter([&]<typename E>(E& emitter) {
+        size_t count = emitterDue[index++];
+        const size_t skipped = std::min(skip, count);
+        skip -= skipped;
+        count = std::min(count - skipped, store.size() - next);
+        EmitterKernel<E>::generate(emitter, store, next, count);
+        next += count;
+    });
+    store.resetPreviousPosition(first, store.size() - first);
+    // New particles are appended, but recycling old ones to make room reorders the store
+    if (pool.getOverflowCount() != overflowBefore) reusableForces = 0;
+}
+
+template <typename R>
+void BasicParticleSystem<R>::applyEffects() {
+    PARTICLESYSTEM_PROFILE_ZONE("effects");
+    // The table is rebuilt every step since the effects may have been edited in between
+    std::swap(effectTable, previousEffectTable);
+    effectTable.clear();
+    std::apply(
+        [&]<typename... T>(SlotMap<T>&... container) {
+            auto pack = [&]<typename E>(std::span<E> all, Unpacked<E>& rest) {
+                rest.clear();
+                for (E& effect : all) {
+                    if (!EffectKernel<E>::pack(effect, effectTable)) {
+                        rest.push_back(&effect);
+                    }
+                }
+            };
+            (pack(container.values(), std::get<Unpacked<T>>(unpacked)), ...);
+        },
+        effects);
+
+    // Unless the effects have changed, the forces of the particles that a Velocity Verlet step
+    // moved are still current and only the newly emitted particles need theirs
+    ParticleStore& particles = pool.particles();
+    size_t first = 0;
+    if (effectTable == previousEffectTable && effectTable.getUnpacked().empty() &&
+        !hasUnpacked()) {
+        first = std::min(reusableForces, particles.size());
+    }
+    evaluateForces(particles.getPosition().subspan(first), particles.getForce().subspan(first));
+    reusableForces = particles.size();
+}
+
+template <typename R>
+void BasicParticleSystem<R>::evaluateForces(std::span<const glm::vec2> positions,
+                                            std::span<glm::vec2> forces) {
+    backend->evaluateForces(effectTable, positions, forces);
+
+    // The effects that could not be packed are applied through their kernels, which only run on
+    // the CPU
+    if (!hasUnpacked()) return;
+    scheduler.parallelFor(positions.size(), [&](size_t begin, size_t end) {
+        const std::span<const glm::vec2> pos = positions.subspan(begin, end - begin);
+        const std::span<glm::vec2> acc = forces.subspan(begin, end - begin);
+        std::apply(
+            [&]<typename... E>(Unpacked<E>&... rest) {
+                ((std::ranges::for_each(rest, [&](E* e) { EffectKernel<E>::apply(*e, pos, acc); })),
+                 ...);
+            },
+            unpacked);
+    });
+}
+
+template <typename R>
+void BasicParticleSystem<R>::retire(double dt) {
+    PARTICLESYSTEM_PROFILE_ZONE("retire");
+    pool.particles().updateLifetime(dt);
+    // The forces move with the particles, but a particle without one may fill a retired slot
+    const bool allReusable = reusableForces == pool.size();
+    pool.retireExpired(maxLifetime);
+    reusableForces = allReusable ? pool.size() : 0;
+}
+
+template <typename R>
+void BasicParticleSystem<R>::integrate(double dt) {
+    PARTICLESYSTEM_PROFILE_ZONE("integrate");
+    pool.particles().storePreviousPosition();
+    backend->integrate(pool.particles(), dt, integrator,
+                       [this](std::span<const glm::vec2> positions, std::span<glm::vec2> forces) {
+                           evaluateForces(positions, forces);
+                       });
+    // Velocity Verlet ends with the forces at the new positions
+    reusableForces = integrator == Integrator::VelocityVerlet ? pool.size() : 0;
+}
+
+// The default system is compiled once in the library
+extern template class BasicParticleSystem<DefaultRegistry>;
+using ParticleSystem = BasicParticleSystem<>;
+
+// Handles for the default system
+using EmitterHandle = ParticleSystem::EmitterHandle;
+using EffectHandle = ParticleSystem::EffectHandle;
+
+}  // namespace particlesystem
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rendering {
+
+// This structure represents how the points are stored in the vertex buffer
+struct PointVertex {
+    glm::vec2 position;
+    float scale;
+    uint32_t color_packed;
+};
+
+/**
+ * Receives the points submitted by a PointBatcher. Implemented on top of the vertex buffers by
+ * the window, which keeps the batching logic independent of OpenGL.
+ */
+class PointSink {
+public:
+    virtual ~PointSink() = default;
+
+    // Returns writable memory for 'count' points
+    virtual std::span<PointVertex> map(size_t count) = 0;
+
+    // Draws the points written to the memory returned by the last call to map
+    virtual void draw() = 0;
+};
+
+/**
+ * Collects the points drawn during a frame on the CPU, in the order they were submitted, so that
+ * they can be uploaded and drawn together instead of with one draw call each. Does not use any
+ * GL functions itself.
+ */
+class PointBatcher {
+public:
+    /**
+     * Appends 'count' points and packs their colors to RGBA8
+     * @param stride_in_bytes The number of bytes between the fields of consecutive points, 0 if
+     * the fields are in separate tightly packed arrays
+     */
+    void add(const glm::vec2* pos, const float* radius, const glm::vec4* color, size_t count,
+             size_t stride_in_bytes = 0);
+
+    /**
+     * Copies the recorded points to the sink and draws them in chunks of at most 'chunkSize'
+     * points, in the order they were added. The batch is empty afterwards.
+     * @return The number of chunks that were drawn
+     */
+    size_t submit(PointSink& sink, size_t chunkSize);
+
+    std::span<const PointVertex> points() const { return batch; }
+    size_t size() const { return batch.size(); }
+    bool empty() const { return batch.empty(); }
+
+    // Removes all points but keeps the memory for the next frame
+    void clear() { batch.clear(); }
+
+private:
+    std::vector<PointVertex> batch;
+};
+
+}  // namespace rendering
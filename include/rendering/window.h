@@ -2,17 +2,61 @@
 
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
+#include <cstdint>
 #include <memory>
 #include <string_view>
 #include <span>
+#include <vector>
 
 /// This namespace contains objects that are helper functions that support the rendering
 /// of general ui elements and graphics primitives.
 namespace rendering {
 
+// Counts the point draws of a frame
+struct DrawStats {
+    size_t pointsSubmitted = 0;  // Points passed to drawPoint and drawPoints
+    size_t drawsSubmitted = 0;   // Calls to drawPoint and drawPoints
+    size_t glDrawCalls = 0;      // Draw calls actually issued to the backend, e.g. OpenGL
+    size_t bytesUploaded = 0;    // Vertex data copied to the GPU
+};
+
+// Marks which attributes passed to drawPoints differ from the previous call, the GPU copy of an
+// unchanged attribute is reused instead of uploaded again
+struct ChangedAttributes {
+    bool position = true;
+    bool radius = true;
+    bool color = true;
+};
+
+// Where a window renders its frames
+enum class RenderBackend {
+    OpenGL,   // A GLFW window with an OpenGL 3.3 context and a user interface
+    Software  // Rendered on the CPU into memory, without a window or user interface
+};
+
+// How a window renders, including the sizes of the vertex buffers used for drawing points
+struct RenderSettings {
+    RenderBackend backend = RenderBackend::OpenGL;
+    // The number of threads used by the software backend, 0 uses all hardware threads
+    size_t threadCount = 0;
+    // The number of points that can be drawn each frame before the vertex buffer has to wait for
+    // the GPU to finish an earlier frame
+    size_t streamCapacity = 1024 * 1024;
+    // The maximum number of points drawn by a single draw call, larger frames are split up.
+    // Limited to streamCapacity.
+    size_t chunkSize = 1024 * 1024;
+};
+
+// An RGBA8 image, the pixels are packed like glm::packUnorm4x8 with the top row first
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> pixels;
+};
+
 class Window {
 public:
-    Window(std::string_view title, int width, int height);
+    Window(std::string_view title, int width, int height, RenderSettings settings = {});
     Window(const Window&) = delete;
     Window(Window&&) = delete;
     Window& operator=(const Window&) = delete;
@@ -41,17 +85,42 @@ public:
     // Clear the window with specific color, each channel is in range [0,1]
     void clear(glm::vec4 color);
 
-    // Draws points on screen
+    // Draws points on screen. The points are recorded and drawn together, in the order they
+    // were submitted, when the frame ends or the window is cleared.
     void drawPoint(glm::vec2 pos, float radius, glm::vec4 color);
+
+    // Draws points from separate attribute arrays. Each array is copied as is into its own GPU
+    // buffer, without packing, and is drawn right away after any recorded points. An unchanged
+    // attribute is only reused if the previous call drew the same number of points.
+    void drawPoints(std::span<const glm::vec2> pos, std::span<const float> radius,
+                    std::span<const glm::vec4> color, ChangedAttributes changed = {});
+    // Same as above with colors that are already packed as RGBA8, e.g. glm::packUnorm4x8
     void drawPoints(std::span<const glm::vec2> pos, std::span<const float> radius,
-                    std::span<const glm::vec4> color);
+                    std::span<const uint32_t> color, ChangedAttributes changed = {});
 
-    // Draws points by extracting fields from packed data.
+    // Draws points by extracting fields from packed data. There is no limit on the number of
+    // points, large batches are drawn in chunks of RenderSettings::chunkSize points.
     // The stride represents the number of bytes between each sphere primitive.
     void drawPoints(const glm::vec2* pos, const float* radius, const glm::vec4* color, size_t count,
                     size_t stride_in_bytes = 0);
 
-    // UI
+    // Uploads and draws the recorded points now instead of when the frame ends, e.g. to measure
+    // the upload separately from endFrame
+    void flush();
+
+    // Returns the draw counters of the last completed frame
+    DrawStats getDrawStats() const;
+
+    // Returns the contents of the current frame including all points drawn so far. Must be
+    // called before endFrame.
+    Image readPixels();
+
+    // Writes the current frame to a .png or .ppm file, see readPixels
+    // \throw std::runtime_error if the file could not be written
+    void saveFrame(std::string_view path);
+
+    // UI, does nothing for backends without a user interface. The functions that return whether
+    // the user changed a value then always return false.
     void beginGuiWindow(std::string_view label);
     void endGuiWindow();
 
@@ -0,0 +1,71 @@
+#include <allocationcounter/allocationcounter.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// All forms are replaced so that allocations and deallocations stay paired
+namespace {
+std::atomic<size_t> allocationCount{0};
+
+void* countedAllocation(size_t size) noexcept {
+    allocationCount++;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* countedAllocation(size_t size, std::align_val_t alignment) noexcept {
+    allocationCount++;
+    const auto align = static_cast<size_t>(alignment);
+#ifdef _MSC_VER
+    return _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+    return std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+}
+
+void alignedFree(void* ptr) noexcept {
+#ifdef _MSC_VER
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+}  // namespace
+
+void* operator new(size_t size) {
+    if (void* ptr = countedAllocation(size)) return ptr;
+    throw std::bad_alloc{};
+}
+void* operator new[](size_t size) {
+    if (void* ptr = countedAllocation(size)) return ptr;
+    throw std::bad_alloc{};
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAllocation(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocation(size);
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* ptr = countedAllocation(size, alignment)) return ptr;
+    throw std::bad_alloc{};
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    if (void* ptr = countedAllocation(size, alignment)) return ptr;
+    throw std::bad_alloc{};
+}
+void operator delete(void* ptr, std::align_val_t) noexcept { alignedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { alignedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { alignedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { alignedFree(ptr); }
+
+namespace allocationcounter {
+
+size_t getCount() { return allocationCount; }
+
+}  // namespace allocationcounter
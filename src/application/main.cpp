@@ -1,125 +1,133 @@
-﻿// #include <tracy/Tracy.hpp>
-#include <rendering/window.h>
+﻿#include <rendering/window.h>
 #include <particlesystem/particlesystem.h>
+#include <particlesystem/pipeline.h>
+#include <particlesystem/profiler.h>
+#include <particlesystem/recorder.h>
+#include <particlesystem/scene.h>
+#include <particlesystem/system.h>
 
 #include <cmath>
 #include <cstdlib>
+#include <limits>
+#include <span>
+#include <variant>
 #include <vector>
 
 #include <fmt/format.h>
 #include <iostream>
 
-int main(int, char**) try {
+int main(int argc, char** argv) try {
     rendering::Window window("Particle System v0.0.1 pre-release alpha", 850, 850);
 
     double prevTime = 0.0;
     bool running = true;
-    std::vector<Particle> allParticles;
-    std::vector<Emitter*> allEmitters;
-    std::vector<Effect*> allEffects;
+    // A scene file given on the command line sets up the system, see particlesystem/scene.h
+    particlesystem::SceneDescription scene;
+    if (argc > 1) scene = particlesystem::loadScene(argv[1]);
+    particlesystem::ParticleSystem system{scene.settings};
+    scene.populate(system);
+    particlesystem::SimulationClock& clock = system.getClock();
+    std::vector<glm::vec2> renderPosition;
     int currentEmitter = 0;
     int currentEffect = 0;
-    int particleLifetime = 4;
+    int tickRate = static_cast<int>(clock.getTickRate());
+    int integrator = static_cast<int>(system.getIntegrator());
+    bool pipelined = true;
+
+    // Set PARTICLESYSTEM_RECORD to a path to record the session for particlesystem-bench --replay
+    particlesystem::Recorder recorder;
+    if (const char* recordPath = std::getenv("PARTICLESYSTEM_RECORD")) {
+        recorder.start(recordPath, system);
+    }
+
+    // Simulates the steps that have passed since the previous frame. While the pipeline runs it on
+    // a worker thread, the main thread draws the snapshot of the previous frame.
+    double elapsed = 0.0;
+    auto simulate = [&](particlesystem::ParticleSnapshot& snapshot) {
+        system.update(elapsed);
+        recorder.recordFrame(elapsed, system.particles());
+        snapshot.capture(system.particles(), clock.getAlpha());
+    };
+    particlesystem::SimulationPipeline pipeline(simulate);
 
     while (running) {
         // Start frame
         window.beginFrame();
         window.setTitle("Particle system");
 
-        // Time
-        const double t = window.time();
-        const double dt = t - prevTime;
-        prevTime = t;
+        // Wait for the simulation of the previous frame. Until the next launch the emitters,
+        // effects and particles belong to this thread again and can be edited through the UI.
+        const particlesystem::ParticleSnapshot& snapshot =
+            [&]() -> const particlesystem::ParticleSnapshot& {
+            PARTICLESYSTEM_PROFILE_ZONE("wait");
+            return pipeline.sync();
+        }();
 
         // Clear screen with color
         window.clear({0, 0, 0, 1});
 
-        // Check if there are any Emitters
-        if (allEmitters.size() > 0) {
-            // If there are: Let them all emit (iterate through) new particles
-            for (Emitter* ptr : allEmitters) {
-                allParticles.push_back(ptr->createParticle());
-            }
-        }
-        // Check if there are any Effects
-        if (allEffects.size() > 0) {
-            // If there are: Let them all affect (iterate through) existing particles
-            for (Effect* ptr : allEffects) {
-                ptr->effectParticle(allParticles);
-            }
-        }
-
-        // Step through all particles
-        if (allParticles.size() > 0) {
-            for (size_t i = 0; i < allParticles.size(); i++) {
-                allParticles[i].lifetime += (float)dt;
-                // Remove particles that are too old
-                if (allParticles[i].lifetime > particleLifetime) {
-                    allParticles.erase(allParticles.begin() + i);
-                }
-                if (allParticles.size() > 0) {
-                    // Move existing particles
-                    allParticles[i].updatePosition(dt);
-                    // Draw all particles
-                    window.drawPoint(allParticles[i].position, allParticles[i].radius,
-                                     allParticles[i].color);
-                }
-            }
-        }
-
-        // Draw all emitters
-        if (allEmitters.size() > 0) {
-            for (Emitter* ptr : allEmitters) {
-                window.drawPoint(ptr->position, ptr->radius, ptr->color);
-            }
-        }
-        // Draw all effects
-        if (allEffects.size() > 0) {
-            for (Effect* ptr : allEffects) {
-                window.drawPoint(ptr->position, ptr->radius, ptr->color);
-            }
-        }
-
         // UI - Emitter
         {
             window.beginGuiWindow("Emitters");
+            const rendering::DrawStats drawStats = window.getDrawStats();
+            window.text(fmt::format("Particles: {}, draws: {} in {} GL calls", snapshot.size(),
+                                    drawStats.drawsSubmitted, drawStats.glDrawCalls));
+            if (window.checkbox("Simulate while drawing", pipelined)) {
+                pipeline.setMode(pipelined ? particlesystem::SimulationPipeline::Mode::Pipelined
+                                           : particlesystem::SimulationPipeline::Mode::Serial);
+            }
+            if (window.sliderInt("Simulation steps per second", tickRate, 10, 240)) {
+                clock.setTickRate(tickRate);
+                recorder.recordSettings(system);
+            }
+            if (window.sliderInt("Integrator", integrator, 0, 2)) {
+                system.setIntegrator(static_cast<particlesystem::Integrator>(integrator));
+                recorder.recordSettings(system);
+            }
+            window.text(
+                fmt::format("Integrator: {}", particlesystem::toString(system.getIntegrator())));
+            std::span<const particlesystem::EmitterHandle> emitters = system.getEmitters();
             // Mark current emitter, if there are any emitters
-            if (allEmitters.size() > 0) {
-                window.sliderInt("Current Emitter", currentEmitter, 0, (int)allEmitters.size() - 1);
+            if (emitters.size() > 0) {
+                window.sliderInt("Current Emitter", currentEmitter, 0, (int)emitters.size() - 1);
             }
 
             if (window.button("Add Uniform")) {
-                std::unique_ptr<Uniform> ptr = std::make_unique<Uniform>();
-                allEmitters.push_back(ptr.release());
+                recorder.recordAdd(system, system.addEmitter<Uniform>());
             }
 
             if (window.button("Add Directional")) {
-                std::unique_ptr<Directional> ptr = std::make_unique<Directional>();
-                allEmitters.push_back(ptr.release());
+                recorder.recordAdd(system, system.addEmitter<Directional>());
             }
 
             if (window.button("Add Spinner")) {
-                std::unique_ptr<Spinner> ptr = std::make_unique<Spinner>();
-                allEmitters.push_back(ptr.release());
+                recorder.recordAdd(system, system.addEmitter<Spinner>());
             }
 
-            if (allEmitters.size() > 0) {
+            if (emitters.size() > 0) {
                 if (window.button("Remove Current Emitter")) {
-                    allEmitters.erase(allEmitters.begin() + currentEmitter);
+                    recorder.recordRemove(system, emitters[currentEmitter]);
+                    system.remove(emitters[currentEmitter]);
                     currentEmitter = 0;
                 }
             }
 
-            if (allEmitters.size() > 0) {
-                window.sliderVec2("Position (x,y)", allEmitters[currentEmitter]->position, -1, 1);
+            emitters = system.getEmitters();
+            if (emitters.size() > 0) {
+                const particlesystem::EmitterHandle handle = emitters[currentEmitter];
+                Emitter* emitter = system.get(handle);
+                bool edited = window.sliderVec2("Position (x,y)", emitter->position, -1, 1);
+                edited |=
+                    window.sliderFloat("Particles per second", emitter->rate, 0.0f, 100'000.0f);
 
                 // If we're on a directional emitter, show slider for direction and width
-                if (Directional* ptrDirectional =
-                        dynamic_cast<Directional*>(allEmitters[currentEmitter])) {
+                if (auto* directional = std::get_if<particlesystem::Handle<Directional>>(&handle)) {
+                    Directional* ptrDirectional = system.get(*directional);
                     glm::vec2 values(ptrDirectional->getDirection(), ptrDirectional->getWidth());
-                    window.sliderVec2("Direction and Width", values, 0, 6.24f);
+                    edited |= window.sliderVec2("Direction and Width", values, 0, 6.24f);
                     ptrDirectional->changeDirValues(values);
                 }
+                if (edited) recorder.recordEdit(system, handle);
             }
 
             window.endGuiWindow();
@@ -128,34 +136,100 @@ int main(int, char**) try {
         // UI - Effect
         {
             window.beginGuiWindow("Effects");
-            if (allEffects.size() > 0) {
-                window.sliderInt("Current Effect", currentEffect, 0, (int)allEffects.size() - 1);
+            std::span<const particlesystem::EffectHandle> effects = system.getEffects();
+            if (effects.size() > 0) {
+                window.sliderInt("Current Effect", currentEffect, 0, (int)effects.size() - 1);
             }
             if (window.button("Add Gravity Well")) {
-                std::unique_ptr<GravityWell> ptr = std::make_unique<GravityWell>();
-                allEffects.push_back(ptr.release());
+                recorder.recordAdd(system, system.addEffect<GravityWell>());
             }
             if (window.button("Add Wind")) {
-                std::unique_ptr<Wind> ptr = std::make_unique<Wind>();
-                allEffects.push_back(ptr.release());
+                recorder.recordAdd(system, system.addEffect<Wind>());
             }
-            if (allEffects.size() > 0) {
+            if (effects.size() > 0) {
                 if (window.button("Remove Current Effect")) {
-                    allEffects.erase(allEffects.begin() + currentEffect);
+                    recorder.recordRemove(system, effects[currentEffect]);
+                    system.remove(effects[currentEffect]);
                     currentEffect = 0;
                 }
             }
-            if (allEffects.size() > 0) {
-                window.sliderVec2("Position (x,y)", allEffects[currentEffect]->position, -1, 1);
+            effects = system.getEffects();
+            if (effects.size() > 0) {
+                const particlesystem::EffectHandle handle = effects[currentEffect];
+                Effect* effect = system.get(handle);
+                bool edited = window.sliderVec2("Position (x,y)", effect->position, -1, 1);
+
+                // Effects affect every particle unless their range is limited
+                bool limitRange = std::isfinite(effect->influenceRadius);
+                if (window.checkbox("Limit range", limitRange)) {
+                    effect->influenceRadius =
+                        limitRange ? 0.5f : std::numeric_limits<float>::infinity();
+                    edited = true;
+                }
+                if (limitRange) {
+                    edited |= window.sliderFloat("Range", effect->influenceRadius, 0.01f, 2.0f);
+                }
+                if (edited) recorder.recordEdit(system, handle);
             }
 
             window.endGuiWindow();
         }
 
-        window.endFrame();
+        // UI - Profiler, the time of each phase in the latest frame and over the last frames
+        {
+            window.beginGuiWindow("Profiler");
+            for (const particlesystem::profiling::ZoneStats& zone :
+                 particlesystem::profiling::getStats()) {
+                window.text(fmt::format("{:<9} {:6.2f} ms  avg {:5.2f}  p95 {:5.2f}  max {:5.2f}",
+                                        zone.name, zone.last, zone.mean, zone.p95, zone.max));
+                window.text(fmt::format("          |{}|",
+                                        particlesystem::profiling::sparkline(zone.name, 48)));
+            }
+            window.endGuiWindow();
+        }
+
+        // Time. The simulation runs in fixed steps, as many as have passed since the last frame.
+        const double t = window.time();
+        elapsed = t - prevTime;
+        prevTime = t;
+        pipeline.launch();
+
+        {
+            PARTICLESYSTEM_PROFILE_ZONE("upload");
+            // Draw all particles between the last two simulation steps of the snapshot
+            if (snapshot.size() > 0) {
+                renderPosition.resize(snapshot.size());
+                snapshot.interpolatePosition(renderPosition);
+                window.drawPoints(renderPosition, snapshot.radius, snapshot.color);
+            }
+
+            // Draw all emitters
+            for (const particlesystem::EmitterHandle& handle : system.getEmitters()) {
+                const Emitter* ptr = system.get(handle);
+                window.drawPoint(ptr->position, ptr->radius, ptr->color);
+            }
+            // Draw all effects
+            for (const particlesystem::EffectHandle& handle : system.getEffects()) {
+                const Effect* ptr = system.get(handle);
+                window.drawPoint(ptr->position, ptr->radius, ptr->color);
+            }
+            // Upload the recorded emitters and effects here rather than in endFrame
+            window.flush();
+        }
+
+        {
+            PARTICLESYSTEM_PROFILE_ZONE("draw");
+            window.endFrame();
+        }
+        PARTICLESYSTEM_PROFILE_FRAME();
         running = running && !window.shouldClose();
     }
 
+    // Set PARTICLESYSTEM_PROFILE to a .csv or .json path to keep the frame times of the last frames
+    if (const char* profilePath = std::getenv("PARTICLESYSTEM_PROFILE")) {
+        particlesystem::profiling::writeReport(profilePath);
+    }
+
     return EXIT_SUCCESS;
 } catch (const std::exception& e) {
     fmt::print("{}", e.what());
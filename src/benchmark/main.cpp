@@ -0,0 +1,463 @@
+#include <particlesystem/particlesystem.h>
+#include <particlesystem/system.h>
+#include <particlesystem/kernels.h>
+#include <particlesystem/recorder.h>
+#include <particlesystem/scene.h>
+#include <particlesystem/snapshot.h>
+
+#include <allocationcounter/allocationcounter.h>
+
+#include <fmt/format.h>
+#include <fmt/os.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Headless benchmark of the particle system library. Runs scripted scenes through the same
+ * phases as the application (emit, effects, retire and integrate) and reports the time per
+ * particle and phase, the throughput and the number of heap allocations.
+ *
+ * Usage: particlesystem-bench [options]
+ *   --scene <name>      small, medium, large or all (default all)
+ *   --scene-file <file> Run the scene in a scene file instead, see particlesystem/scene.h. The
+ *                       thread count still comes from --threads.
+ *   --emitters <N>      Override the number of emitters of the scene
+ *   --effects <M>       Override the number of gravity wells and winds of the scene
+ *   --particles <K>     Override the steady state number of particles of the scene
+ *   --frames <F>        Number of measured frames (default 300)
+ *   --threads <T>       Number of scheduler threads, 0 uses all hardware threads (default 0)
+ *   --range <R>         Influence radius of the effects (default infinite)
+ *   --simd <level>      scalar, sse2 or avx2 (default the highest supported)
+ *   --backend <name>    reference or cpu, see particlesystem/backend.h (default cpu, or the one
+ *                       of the scene file)
+ *   --integrator <name> semi_implicit_euler, velocity_verlet or rk4 (default semi_implicit_euler,
+ *                       or the one of the scene file)
+ *   --json <file>       Also write the results as JSON to the file, '-' for stdout
+ *   --load <file>       Start from the particles, emitters and effects in a snapshot instead of
+ *                       a scene, the measurement starts immediately
+ *   --save <file>       Write a snapshot of the scene once it has reached its steady state
+ *   --replay <file>     Replay a session recorded by the application (PARTICLESYSTEM_RECORD) as
+ *                       fast as possible and check that it reproduces the recorded particles
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Scene {
+    std::string name;
+    size_t emitters;
+    size_t effects;
+    size_t particles;
+};
+
+struct Options {
+    std::vector<Scene> scenes;
+    size_t frames = 300;
+    size_t threads = 0;
+    float range = std::numeric_limits<float>::infinity();
+    particlesystem::SimdLevel simd = particlesystem::detectSimdLevel();
+    // Overrides the backend of the scene
+    std::optional<particlesystem::BackendType> backend;
+    // Overrides the integrator of the scene
+    std::optional<particlesystem::Integrator> integrator;
+    std::string json;
+    std::string load;
+    std::string save;
+    std::string replay;
+    // The scene read with --scene-file, which replaces the scripted scenes
+    std::optional<particlesystem::SceneDescription> sceneFile;
+};
+
+enum Phase { Emit, Effects, Retire, Integrate, PhaseCount };
+constexpr std::array<std::string_view, PhaseCount> phaseNames = {"emit", "effects", "retire",
+                                                                  "integrate"};
+
+struct Result {
+    Scene scene;
+    size_t frames;
+    size_t threads;
+    const char* backend;
+    particlesystem::Integrator integrator;
+    // Sum of the number of live particles over all measured frames
+    double particleFrames;
+    std::array<double, PhaseCount> seconds;
+    size_t allocations;
+
+    double totalSeconds() const {
+        double sum = 0.0;
+        for (double s : seconds) sum += s;
+        return sum;
+    }
+    double nsPerParticle(size_t phase) const { return 1e9 * seconds[phase] / particleFrames; }
+    double particlesPerSecond() const { return particleFrames / totalSeconds(); }
+};
+
+constexpr float dt = 1.0f / 60.0f;
+constexpr float particleLifetime = 4.0f;
+
+const std::array<Scene, 3> presets = {{
+    {"small", 4, 4, 10'000},
+    {"medium", 16, 16, 200'000},
+    {"large", 32, 32, 1'000'000},
+}};
+
+// Replaces the scene by the state in the snapshot
+void restore(particlesystem::ParticleSystem& system, const particlesystem::Snapshot& snapshot,
+             bool quiet) {
+    const auto start = Clock::now();
+    particlesystem::loadSnapshot(system, snapshot);
+    const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (!quiet) {
+        fmt::print("Restored {} particles in {:.2f} ms\n", system.particles().size(),
+                   1e3 * seconds);
+    }
+}
+
+// Places the emitters and effects on circles around the origin. The emission rate is chosen so
+// that the number of live particles settles at the requested count.
+void placeObjects(particlesystem::ParticleSystem& system, const Scene& scene,
+                  const Options& options) {
+    const float totalRate = static_cast<float>(scene.particles) / particleLifetime;
+    for (size_t i = 0; i < scene.emitters; ++i) {
+        const float angle = 2.0f * std::numbers::pi_v<float> * static_cast<float>(i) /
+                            static_cast<float>(scene.emitters);
+        Uniform emitter;
+        emitter.position = 0.3f * glm::vec2{std::cos(angle), std::sin(angle)};
+        emitter.rate = totalRate / static_cast<float>(scene.emitters);
+        system.addEmitter(emitter);
+    }
+    for (size_t i = 0; i < scene.effects; ++i) {
+        const float angle = 2.0f * std::numbers::pi_v<float> * (static_cast<float>(i) + 0.5f) /
+                            static_cast<float>(scene.effects);
+        auto place = [&](Effect& effect) {
+            effect.position = 0.6f * glm::vec2{std::cos(angle), std::sin(angle)};
+            effect.influenceRadius = options.range;
+        };
+        if (i % 2 == 0) {
+            GravityWell effect;
+            place(effect);
+            system.addEffect(effect);
+        } else {
+            Wind effect;
+            place(effect);
+            system.addEffect(effect);
+        }
+    }
+}
+
+Result run(Scene scene, const Options& options) {
+    particlesystem::setMasterSeed(particlesystem::DefaultMasterSeed);
+    particlesystem::setSimdLevel(options.simd);
+
+    std::optional<particlesystem::Snapshot> snapshot;
+    if (!options.load.empty()) {
+        snapshot.emplace(options.load);
+        const auto emitters = snapshot->get<particlesystem::EmitterRecord>(
+            particlesystem::chunks::Emitters);
+        const auto effects =
+            snapshot->get<particlesystem::EffectRecord>(particlesystem::chunks::Effects);
+        const auto particles = snapshot->get<glm::vec2>(particlesystem::chunks::Position);
+        scene = {"snapshot", emitters.size(), effects.size(), particles.size()};
+    }
+
+    particlesystem::ParticleSystem::Settings settings;
+    if (options.sceneFile) {
+        settings = options.sceneFile->settings;
+    } else {
+        // Leave some headroom since the emission is not perfectly even between frames
+        settings.capacity = scene.particles + scene.particles / 4 + 1024;
+        settings.maxLifetime = particleLifetime;
+    }
+    settings.threadCount = options.threads;
+    if (options.backend) settings.backend = *options.backend;
+    if (options.integrator) settings.integrator = *options.integrator;
+    particlesystem::ParticleSystem system{settings};
+
+    if (options.sceneFile) {
+        options.sceneFile->populate(system);
+    } else {
+        placeObjects(system, scene, options);
+    }
+
+    Result result{scene,
+                  options.frames,
+                  system.getScheduler().getThreadCount(),
+                  system.getBackend().getName(),
+                  system.getIntegrator(),
+                  0.0,
+                  {},
+                  0};
+    auto frame = [&](bool measure) {
+        auto start = Clock::now();
+        auto lap = [&](Phase phase) {
+            const auto now = Clock::now();
+            if (measure) {
+                result.seconds[phase] += std::chrono::duration<double>(now - start).count();
+            }
+            start = now;
+        };
+
+        system.emit(dt);
+        lap(Emit);
+        system.applyEffects();
+        lap(Effects);
+        system.retire(dt);
+        lap(Retire);
+        system.integrate(dt);
+        lap(Integrate);
+
+        if (measure) result.particleFrames += static_cast<double>(system.particles().size());
+    };
+
+    if (snapshot) {
+        restore(system, *snapshot, options.json == "-");
+        // Lets the scratch buffers of the phases reach their size
+        frame(false);
+    } else {
+        // Run until the population has reached its steady state before measuring
+        const auto warmupFrames = static_cast<size_t>(system.getMaxLifetime() / dt) + 60;
+        for (size_t i = 0; i < warmupFrames; ++i) frame(false);
+    }
+    if (!options.save.empty()) particlesystem::saveSnapshot(system, options.save);
+
+    const size_t allocationsBefore = allocationcounter::getCount();
+    for (size_t i = 0; i < options.frames; ++i) frame(true);
+    result.allocations = allocationcounter::getCount() - allocationsBefore;
+
+    return result;
+}
+
+void printTable(const std::vector<Result>& results) {
+    fmt::print("{:<8} {:>8} {:>7} {:>10}", "scene", "emitters", "effects", "particles");
+    for (std::string_view name : phaseNames) fmt::print(" {:>10}", name);
+    fmt::print(" {:>10} {:>14} {:>7}\n", "total", "particles/s", "allocs");
+    for (const Result& r : results) {
+        fmt::print("{:<8} {:>8} {:>7} {:>10.0f}", r.scene.name, r.scene.emitters, r.scene.effects,
+                   r.particleFrames / static_cast<double>(r.frames));
+        double total = 0.0;
+        for (size_t phase = 0; phase < PhaseCount; ++phase) {
+            fmt::print(" {:>10.3f}", r.nsPerParticle(phase));
+            total += r.nsPerParticle(phase);
+        }
+        fmt::print(" {:>10.3f} {:>14.4g} {:>7}\n", total, r.particlesPerSecond(), r.allocations);
+    }
+    fmt::print("(times in ns per particle and frame)\n");
+}
+
+std::string toJson(const std::vector<Result>& results, const Options& options) {
+    std::string json = "{\n";
+    json += fmt::format("  \"simd\": \"{}\",\n", particlesystem::toString(options.simd));
+    json += fmt::format("  \"frames\": {},\n", options.frames);
+    json += fmt::format("  \"dt\": {},\n", dt);
+    json += "  \"scenes\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        json += i == 0 ? "\n" : ",\n";
+        json += "    {\n";
+        json += fmt::format("      \"name\": \"{}\",\n", r.scene.name);
+        json += fmt::format("      \"emitters\": {},\n", r.scene.emitters);
+        json += fmt::format("      \"effects\": {},\n", r.scene.effects);
+        json += fmt::format("      \"particles\": {},\n", r.scene.particles);
+        json += fmt::format("      \"threads\": {},\n", r.threads);
+        json += fmt::format("      \"backend\": \"{}\",\n", r.backend);
+        json += fmt::format("      \"integrator\": \"{}\",\n",
+                            particlesystem::toString(r.integrator));
+        json += fmt::format("      \"mean_live_particles\": {:.1f},\n",
+                            r.particleFrames / static_cast<double>(r.frames));
+        json += "      \"ns_per_particle\": {";
+        for (size_t phase = 0; phase < PhaseCount; ++phase) {
+            json += fmt::format("{}\"{}\": {:.4f}", phase == 0 ? "" : ", ", phaseNames[phase],
+                                r.nsPerParticle(phase));
+        }
+        json += "},\n";
+        json += fmt::format("      \"seconds\": {:.6f},\n", r.totalSeconds());
+        json += fmt::format("      \"particles_per_second\": {:.1f},\n", r.particlesPerSecond());
+        json += fmt::format("      \"allocations\": {}\n", r.allocations);
+        json += "    }";
+    }
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    std::string sceneName = "all";
+    std::string sceneFile;
+    size_t emitters = 0, effects = 0, particles = 0;
+
+    auto value = [&](int& i) -> std::string_view {
+        if (i + 1 >= argc) throw std::runtime_error(fmt::format("Missing value for {}", argv[i]));
+        return argv[++i];
+    };
+    // Converts the value of the option, reporting bad input as a usage error
+    auto parse = [&](int& i, auto convert) {
+        const std::string_view arg = argv[i];
+        const std::string v{value(i)};
+        try {
+            return convert(v);
+        } catch (const std::exception&) {
+            throw std::runtime_error(fmt::format("Invalid value for {}: '{}'", arg, v));
+        }
+    };
+    auto number = [&](int& i) -> size_t {
+        return parse(i, [](const std::string& v) { return std::stoull(v); });
+    };
+    auto real = [&](int& i) -> float {
+        return parse(i, [](const std::string& v) { return std::stof(v); });
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--scene") {
+            sceneName = value(i);
+        } else if (arg == "--scene-file") {
+            sceneFile = value(i);
+        } else if (arg == "--emitters") {
+            emitters = number(i);
+        } else if (arg == "--effects") {
+            effects = number(i);
+        } else if (arg == "--particles") {
+            particles = number(i);
+        } else if (arg == "--frames") {
+            options.frames = std::max<size_t>(1, number(i));
+        } else if (arg == "--threads") {
+            options.threads = number(i);
+        } else if (arg == "--range") {
+            options.range = real(i);
+        } else if (arg == "--simd") {
+            const std::string_view level = value(i);
+            if (level == "scalar") {
+                options.simd = particlesystem::SimdLevel::Scalar;
+            } else if (level == "sse2") {
+                options.simd = particlesystem::SimdLevel::SSE2;
+            } else if (level == "avx2") {
+                options.simd = particlesystem::SimdLevel::AVX2;
+            } else {
+                throw std::runtime_error(fmt::format("Unknown SIMD level '{}'", level));
+            }
+        } else if (arg == "--backend") {
+            const std::string_view name = value(i);
+            if (name == "reference") {
+                options.backend = particlesystem::BackendType::Reference;
+            } else if (name == "cpu") {
+                options.backend = particlesystem::BackendType::Cpu;
+            } else {
+                throw std::runtime_error(fmt::format("Unknown backend '{}'", name));
+            }
+        } else if (arg == "--integrator") {
+            const std::string_view name = value(i);
+            if (name == "semi_implicit_euler") {
+                options.integrator = particlesystem::Integrator::SemiImplicitEuler;
+            } else if (name == "velocity_verlet") {
+                options.integrator = particlesystem::Integrator::VelocityVerlet;
+            } else if (name == "rk4") {
+                options.integrator = particlesystem::Integrator::RungeKutta4;
+            } else {
+                throw std::runtime_error(fmt::format("Unknown integrator '{}'", name));
+            }
+        } else if (arg == "--json") {
+            options.json = value(i);
+        } else if (arg == "--load") {
+            options.load = value(i);
+        } else if (arg == "--save") {
+            options.save = value(i);
+        } else if (arg == "--replay") {
+            options.replay = value(i);
+        } else {
+            throw std::runtime_error(fmt::format("Unknown option '{}'", arg));
+        }
+    }
+
+    for (const Scene& preset : presets) {
+        if (sceneName == "all" || sceneName == preset.name) options.scenes.push_back(preset);
+    }
+    if (options.scenes.empty()) {
+        throw std::runtime_error(fmt::format("Unknown scene '{}'", sceneName));
+    }
+    for (Scene& scene : options.scenes) {
+        if (emitters > 0) scene.emitters = emitters;
+        if (effects > 0) scene.effects = effects;
+        if (particles > 0) scene.particles = particles;
+    }
+    if (!sceneFile.empty()) {
+        options.sceneFile = particlesystem::loadScene(sceneFile);
+        options.scenes = {{std::filesystem::path{sceneFile}.stem().string(),
+                           options.sceneFile->emitters.size(), options.sceneFile->effects.size(),
+                           options.sceneFile->settings.capacity}};
+    }
+    if (!options.load.empty()) {
+        options.scenes.resize(1);
+    } else if (!options.save.empty() && options.scenes.size() > 1) {
+        throw std::runtime_error("--save needs a single scene");
+    }
+    return options;
+}
+
+// Returns false if the replay did not reproduce the recorded particles
+bool replay(const Options& options) {
+    particlesystem::setSimdLevel(options.simd);
+    // Overflowing particles are only dropped or recycled like in the recording if the pool is
+    // the same
+    const particlesystem::RecordingHeader header =
+        particlesystem::readRecordingHeader(options.replay);
+    particlesystem::ParticleSystem::Settings settings;
+    settings.capacity = static_cast<size_t>(header.capacity);
+    settings.overflowPolicy = static_cast<particlesystem::OverflowPolicy>(header.overflowPolicy);
+    settings.threadCount = options.threads;
+    if (options.backend) settings.backend = *options.backend;
+    particlesystem::ParticleSystem system{settings};
+
+    const particlesystem::ReplayResult result = particlesystem::replay(options.replay, system);
+    fmt::print("Replayed {} frames, {} steps in {:.3f} s ({:.1f} steps/s)\n", result.frames,
+               result.steps, result.seconds, static_cast<double>(result.steps) / result.seconds);
+    if (result.mismatches > 0) {
+        fmt::print("{} frames differ from the recording, the first is frame {}\n",
+                   result.mismatches, result.firstMismatch);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) try {
+    const Options options = parseOptions(argc, argv);
+    if (!options.replay.empty()) {
+        return replay(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    std::vector<Result> results;
+    for (const Scene& scene : options.scenes) {
+        results.push_back(run(scene, options));
+    }
+
+    if (options.json != "-") {
+        fmt::print("SIMD level: {}, backend: {}, integrator: {}\n",
+                   particlesystem::toString(options.simd), results.front().backend,
+                   particlesystem::toString(results.front().integrator));
+        printTable(results);
+    }
+    if (options.json == "-") {
+        fmt::print("{}", toJson(results, options));
+    } else if (!options.json.empty()) {
+        auto file = fmt::output_file(options.json);
+        file.print("{}", toJson(results, options));
+    }
+    return EXIT_SUCCESS;
+} catch (const std::exception& e) {
+    fmt::print("{}\n", e.what());
+    return EXIT_FAILURE;
+}
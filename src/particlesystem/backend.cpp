@@ -0,0 +1,167 @@
+#include <particlesystem/backend.h>
+
+#include <particlesystem/particlesystem.h>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <mutex>
+#include <stdexcept>
+
+namespace particlesystem {
+
+namespace {
+
+constexpr size_t BackendTypeCount = 3;
+
+struct BackendRegistry {
+    std::mutex mutex;
+    std::array<BackendFactory, BackendTypeCount> factories{
+        [](Scheduler&) -> std::unique_ptr<SimulationBackend> {
+            return std::make_unique<ReferenceBackend>();
+        },
+        [](Scheduler& scheduler) -> std::unique_ptr<SimulationBackend> {
+            return std::make_unique<CpuBackend>(scheduler);
+        },
+        nullptr};
+};
+
+BackendRegistry& backendRegistry() {
+    static BackendRegistry registry;
+    return registry;
+}
+
+void addRadialForce(glm::vec2 position, glm::vec2& force, const RadialSource& source) {
+    const glm::vec2 d = source.center - position;
+    force += d * (source.k / (d.x * d.x + d.y * d.y));
+}
+
+}  // namespace
+
+const char* toString(BackendType type) {
+    switch (type) {
+        case BackendType::Reference:
+            return "reference";
+        case BackendType::Cpu:
+            return "cpu";
+        case BackendType::GLCompute:
+            return "gl_compute";
+    }
+    return "unknown";
+}
+
+void registerBackend(BackendType type, BackendFactory factory) {
+    BackendRegistry& registry = backendRegistry();
+    std::lock_guard lock(registry.mutex);
+    registry.factories[static_cast<size_t>(type)] = std::move(factory);
+}
+
+bool isBackendAvailable(BackendType type) {
+    BackendRegistry& registry = backendRegistry();
+    std::lock_guard lock(registry.mutex);
+    return static_cast<bool>(registry.factories[static_cast<size_t>(type)]);
+}
+
+std::unique_ptr<SimulationBackend> makeBackend(BackendType type, Scheduler& scheduler) {
+    BackendFactory factory;
+    {
+        BackendRegistry& registry = backendRegistry();
+        std::lock_guard lock(registry.mutex);
+        factory = registry.factories[static_cast<size_t>(type)];
+    }
+    if (!factory) {
+        throw std::runtime_error(
+            fmt::format("The '{}' simulation backend is not available", toString(type)));
+    }
+    return factory(scheduler);
+}
+
+void ReferenceBackend::evaluateForces(const EffectTable& effects,
+                                      std::span<const glm::vec2> positions,
+                                      std::span<glm::vec2> forces) {
+    for (size_t i = 0; i < positions.size(); ++i) {
+        forces[i] = {0.0f, 0.0f};
+        for (const RadialSource& source : effects.getRadial()) {
+            addRadialForce(positions[i], forces[i], source);
+        }
+    }
+    for (Effect* effect : effects.getUnpacked()) {
+        effect->effectParticle(positions, forces);
+    }
+    for (const EffectTable::LocalRadialSource& local : effects.getLocalRadial()) {
+        const float range2 = local.range * local.range;
+        for (size_t i = 0; i < positions.size(); ++i) {
+            const glm::vec2 d = local.source.center - positions[i];
+            if (d.x * d.x + d.y * d.y <= range2) {
+                addRadialForce(positions[i], forces[i], local.source);
+            }
+        }
+    }
+}
+
+void ReferenceBackend::integrate(ParticleStore& particles, double dt, Integrator integrator,
+                                 const ForceField& forces) {
+    const auto h = static_cast<float>(dt);
+    const size_t size = particles.size();
+    std::span<glm::vec2> x = particles.getPosition();
+    std::span<glm::vec2> v = particles.getVelocity();
+    std::span<const glm::vec2> a = particles.getAcceleration();
+    std::span<glm::vec2> f = particles.getForce();
+
+    switch (integrator) {
+        case Integrator::SemiImplicitEuler:
+            for (size_t i = 0; i < size; ++i) {
+                v[i] += (a[i] + f[i]) * h;
+                x[i] += v[i] * h;
+            }
+            return;
+        case Integrator::VelocityVerlet:
+            for (size_t i = 0; i < size; ++i) {
+                v[i] += (a[i] + f[i]) * (0.5f * h);
+                x[i] += v[i] * h;
+            }
+            forces(x, f);
+            for (size_t i = 0; i < size; ++i) {
+                v[i] += (a[i] + f[i]) * (0.5f * h);
+            }
+            return;
+        case Integrator::RungeKutta4: {
+            // The particles hold the state of the current stage
+            startPosition.assign(x.begin(), x.end());
+            startVelocity.assign(v.begin(), v.end());
+            positionChange.assign(size, {0.0f, 0.0f});
+            velocityChange.assign(size, {0.0f, 0.0f});
+            const float weights[4] = {h / 6.0f, h / 3.0f, h / 3.0f, h / 6.0f};
+            const float steps[3] = {0.5f * h, 0.5f * h, h};
+            for (size_t stage = 0; stage < 4; ++stage) {
+                if (stage > 0) forces(x, f);
+                for (size_t i = 0; i < size; ++i) {
+                    const glm::vec2 acceleration = a[i] + f[i];
+                    positionChange[i] += v[i] * weights[stage];
+                    velocityChange[i] += acceleration * weights[stage];
+                    if (stage < 3) {
+                        x[i] = startPosition[i] + v[i] * steps[stage];
+                        v[i] = startVelocity[i] + acceleration * steps[stage];
+                    }
+                }
+            }
+            for (size_t i = 0; i < size; ++i) {
+                x[i] = startPosition[i] + positionChange[i];
+                v[i] = startVelocity[i] + velocityChange[i];
+            }
+            return;
+        }
+    }
+}
+
+void CpuBackend::evaluateForces(const EffectTable& effects, std::span<const glm::vec2> positions,
+                                std::span<glm::vec2> forces) {
+    particlesystem::evaluateForces(effects, positions, forces, scheduler, grid);
+}
+
+void CpuBackend::integrate(ParticleStore& particles, double dt, Integrator integrator,
+                           const ForceField& forces) {
+    particlesystem::integrate(particles, dt, integrator, forces, buffers, scheduler);
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,62 @@
+#include <particlesystem/effecttable.h>
+#include <particlesystem/particlesystem.h>
+
+namespace particlesystem {
+
+void EffectTable::build(std::span<Effect* const> effects) {
+    clear();
+    for (Effect* effect : effects) {
+        if (!effect->pack(*this)) {
+            unpacked.push_back(effect);
+        }
+    }
+}
+
+void EffectTable::clear() {
+    radial.clear();
+    localRadial.clear();
+    unpacked.clear();
+}
+
+void EffectTable::addRadial(glm::vec2 center, float k, float range) {
+    if (range == std::numeric_limits<float>::infinity()) {
+        radial.push_back({center, k});
+    } else {
+        localRadial.push_back({{center, k}, range});
+    }
+}
+
+void EffectTable::apply(std::span<const glm::vec2> positions,
+                        std::span<glm::vec2> accelerations) const {
+    accumulateRadialForces(positions, accelerations, radial);
+    for (Effect* effect : unpacked) {
+        effect->effectParticle(positions, accelerations);
+    }
+}
+
+void EffectTable::applyLocal(std::span<const glm::vec2> positions,
+                             std::span<glm::vec2> accelerations, const SpatialGrid* grid) const {
+    if (grid) {
+        applyLocal(positions, accelerations, *grid, 0, grid->getBucketCount());
+        return;
+    }
+    for (const LocalRadialSource& local : localRadial) {
+        accumulateRadialForce(positions, accelerations, local.source.center, local.source.k,
+                              local.range);
+    }
+}
+
+void EffectTable::applyLocal(std::span<const glm::vec2> positions,
+                             std::span<glm::vec2> accelerations, const SpatialGrid& grid,
+                             uint32_t beginBucket, uint32_t endBucket) const {
+    for (const LocalRadialSource& local : localRadial) {
+        const RadialSource& source = local.source;
+        grid.forEachNeighbour(positions, source.center, local.range, beginBucket, endBucket,
+                              [&](uint32_t i) {
+                                  const glm::vec2 d = source.center - positions[i];
+                                  accelerations[i] += d * (source.k / (d.x * d.x + d.y * d.y));
+                              });
+    }
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,518 @@
+#include <particlesystem/kernels.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PARTICLESYSTEM_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// The kernels treat an array of glm::vec2 as an array of interleaved x and y floats
+static_assert(sizeof(glm::vec2) == 2 * sizeof(float));
+
+namespace particlesystem {
+
+namespace {
+
+std::atomic<SimdLevel> currentLevel{detectSimdLevel()};
+
+void radialForceScalar(const glm::vec2* pos, glm::vec2* acc, size_t begin, size_t end,
+                       std::span<const RadialSource> sources) {
+    for (size_t i = begin; i < end; ++i) {
+        glm::vec2 sum = acc[i];
+        for (const RadialSource& source : sources) {
+            const glm::vec2 d = source.center - pos[i];
+            const float scale = source.k / (d.x * d.x + d.y * d.y);
+            sum += d * scale;
+        }
+        acc[i] = sum;
+    }
+}
+
+// The integration kernels treat the arrays as plain floats and process [begin, end) of them
+void kickDriftScalar(float* x, float* v, const float* a, const float* f, size_t begin, size_t end,
+                     float kick, float drift) {
+    for (size_t j = begin; j < end; ++j) {
+        v[j] += kick * (a[j] + f[j]);
+        x[j] += drift * v[j];
+    }
+}
+
+void kickScalar(float* v, const float* a, const float* f, size_t begin, size_t end, float kick) {
+    for (size_t j = begin; j < end; ++j) {
+        v[j] += kick * (a[j] + f[j]);
+    }
+}
+
+void rungeKuttaBeginScalar(const float* x, const float* v, const float* a, const float* f,
+                           float* xs, float* vs, float* dx, float* dv, size_t begin, size_t end,
+                           float weight, float step) {
+    for (size_t j = begin; j < end; ++j) {
+        const float acc = a[j] + f[j];
+        dx[j] = weight * v[j];
+        dv[j] = weight * acc;
+        xs[j] = x[j] + step * v[j];
+        vs[j] = v[j] + step * acc;
+    }
+}
+
+void rungeKuttaStageScalar(const float* x, const float* v, const float* a, const float* f,
+                           float* xs, float* vs, float* dx, float* dv, size_t begin, size_t end,
+                           float weight, float step) {
+    for (size_t j = begin; j < end; ++j) {
+        const float acc = a[j] + f[j];
+        dx[j] += weight * vs[j];
+        dv[j] += weight * acc;
+        xs[j] = x[j] + step * vs[j];
+        vs[j] = v[j] + step * acc;
+    }
+}
+
+void rungeKuttaEndScalar(float* x, float* v, const float* a, const float* f, const float* vs,
+                         const float* dx, const float* dv, size_t begin, size_t end,
+                         float weight) {
+    for (size_t j = begin; j < end; ++j) {
+        const float acc = a[j] + f[j];
+        x[j] += dx[j] + weight * vs[j];
+        v[j] += dv[j] + weight * acc;
+    }
+}
+
+#ifdef PARTICLESYSTEM_X86
+
+// Returns k * d / |d|^2 for two particles stored as interleaved x and y
+TARGET_SSE2 inline __m128 radialScaleSSE2(__m128 d, __m128 k) {
+    // Squared length of each (x, y) pair, duplicated into both of its lanes
+    const __m128 sq = _mm_mul_ps(d, d);
+    const __m128 len2 = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+    // Approximate reciprocal refined with one Newton-Raphson step: r * (2 - len2 * r)
+    __m128 inv = _mm_rcp_ps(len2);
+    inv = _mm_mul_ps(inv, _mm_sub_ps(_mm_set1_ps(2.0f), _mm_mul_ps(len2, inv)));
+    return _mm_mul_ps(_mm_mul_ps(k, d), inv);
+}
+
+// Returns k * d / |d|^2 for four particles stored as interleaved x and y
+TARGET_AVX2 inline __m256 radialScaleAVX2(__m256 d, __m256 k) {
+    const __m256 sq = _mm256_mul_ps(d, d);
+    const __m256 len2 = _mm256_add_ps(sq, _mm256_permute_ps(sq, _MM_SHUFFLE(2, 3, 0, 1)));
+    __m256 inv = _mm256_rcp_ps(len2);
+    inv = _mm256_mul_ps(inv, _mm256_sub_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(len2, inv)));
+    return _mm256_mul_ps(_mm256_mul_ps(k, d), inv);
+}
+
+// Processes 4 particles per iteration as two registers of interleaved x and y
+TARGET_SSE2 void radialForceSSE2(const glm::vec2* pos, glm::vec2* acc, size_t count,
+                                 std::span<const RadialSource> sources) {
+    const float* p = reinterpret_cast<const float*>(pos);
+    float* a = reinterpret_cast<float*>(acc);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 p0 = _mm_loadu_ps(p + 2 * i);
+        const __m128 p1 = _mm_loadu_ps(p + 2 * i + 4);
+        __m128 a0 = _mm_loadu_ps(a + 2 * i);
+        __m128 a1 = _mm_loadu_ps(a + 2 * i + 4);
+        for (const RadialSource& source : sources) {
+            const __m128 c =
+                _mm_setr_ps(source.center.x, source.center.y, source.center.x, source.center.y);
+            const __m128 k = _mm_set1_ps(source.k);
+            a0 = _mm_add_ps(a0, radialScaleSSE2(_mm_sub_ps(c, p0), k));
+            a1 = _mm_add_ps(a1, radialScaleSSE2(_mm_sub_ps(c, p1), k));
+        }
+        _mm_storeu_ps(a + 2 * i, a0);
+        _mm_storeu_ps(a + 2 * i + 4, a1);
+    }
+    radialForceScalar(pos, acc, i, count, sources);
+}
+
+// Processes 8 particles per iteration as two registers of interleaved x and y
+TARGET_AVX2 void radialForceAVX2(const glm::vec2* pos, glm::vec2* acc, size_t count,
+                                 std::span<const RadialSource> sources) {
+    const float* p = reinterpret_cast<const float*>(pos);
+    float* a = reinterpret_cast<float*>(acc);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 p0 = _mm256_loadu_ps(p + 2 * i);
+        const __m256 p1 = _mm256_loadu_ps(p + 2 * i + 8);
+        __m256 a0 = _mm256_loadu_ps(a + 2 * i);
+        __m256 a1 = _mm256_loadu_ps(a + 2 * i + 8);
+        for (const RadialSource& source : sources) {
+            const __m256 c = _mm256_setr_ps(source.center.x, source.center.y, source.center.x,
+                                            source.center.y, source.center.x, source.center.y,
+                                            source.center.x, source.center.y);
+            const __m256 k = _mm256_set1_ps(source.k);
+            a0 = _mm256_add_ps(a0, radialScaleAVX2(_mm256_sub_ps(c, p0), k));
+            a1 = _mm256_add_ps(a1, radialScaleAVX2(_mm256_sub_ps(c, p1), k));
+        }
+        _mm256_storeu_ps(a + 2 * i, a0);
+        _mm256_storeu_ps(a + 2 * i + 8, a1);
+    }
+    radialForceScalar(pos, acc, i, count, sources);
+}
+
+// The integration kernels process 4 floats, i.e. 2 particles, per iteration
+TARGET_SSE2 void kickDriftSSE2(float* x, float* v, const float* a, const float* f, size_t count,
+                               float kick, float drift) {
+    const __m128 k = _mm_set1_ps(kick);
+    const __m128 d = _mm_set1_ps(drift);
+    size_t j = 0;
+    for (; j + 4 <= count; j += 4) {
+        const __m128 acc = _mm_add_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(f + j));
+        const __m128 vj = _mm_add_ps(_mm_loadu_ps(v + j), _mm_mul_ps(k, acc));
+        _mm_storeu_ps(v + j, vj);
+        _mm_storeu_ps(x + j, _mm_add_ps(_mm_loadu_ps(x + j), _mm_mul_ps(d, vj)));
+    }
+    kickDriftScalar(x, v, a, f, j, count, kick, drift);
+}
+
+TARGET_SSE2 void kickSSE2(float* v, const float* a, const float* f, size_t count, float kick) {
+    const __m128 k = _mm_set1_ps(kick);
+    size_t j = 0;
+    for (; j + 4 <= count; j += 4) {
+        const __m128 acc = _mm_add_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(f + j));
+        _mm_storeu_ps(v + j, _mm_add_ps(_mm_loadu_ps(v + j), _mm_mul_ps(k, acc)));
+    }
+    kickScalar(v, a, f, j, count, kick);
+}
+
+TARGET_SSE2 void rungeKuttaBeginSSE2(const float* x, const float* v, const float* a,
+                                     const float* f, float* xs, float* vs, float* dx, float* dv,
+                                     size_t count, float weight, float step) {
+    const __m128 w = _mm_set1_ps(weight);
+    const __m128 h = _mm_set1_ps(step);
+    size_t j = 0;
+    for (; j + 4 <= count; j += 4) {
+        const __m128 vj = _mm_loadu_ps(v + j);
+        const __m128 acc = _mm_add_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(f + j));
+        _mm_storeu_ps(dx + j, _mm_mul_ps(w, vj));
+        _mm_storeu_ps(dv + j, _mm_mul_ps(w, acc));
+        _mm_storeu_ps(xs + j, _mm_add_ps(_mm_loadu_ps(x + j), _mm_mul_ps(h, vj)));
+        _mm_storeu_ps(vs + j, _mm_add_ps(vj, _mm_mul_ps(h, acc)));
+    }
+    rungeKuttaBeginScalar(x, v, a, f, xs, vs, dx, dv, j, count, weight, step);
+}
+
+TARGET_SSE2 void rungeKuttaStageSSE2(const float* x, const float* v, const float* a,
+                                     const float* f, float* xs, float* vs, float* dx, float* dv,
+                                     size_t count, float weight, float step) {
+    const __m128 w = _mm_set1_ps(weight);
+    const __m128 h = _mm_set1_ps(step);
+    size_t j = 0;
+    for (; j + 4 <= count; j += 4) {
+        const __m128 vsj = _mm_loadu_ps(vs + j);
+        const __m128 acc = _mm_add_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(f + j));
+        _mm_storeu_ps(dx + j, _mm_add_ps(_mm_loadu_ps(dx + j), _mm_mul_ps(w, vsj)));
+        _mm_storeu_ps(dv + j, _mm_add_ps(_mm_loadu_ps(dv + j), _mm_mul_ps(w, acc)));
+        _mm_storeu_ps(xs + j, _mm_add_ps(_mm_loadu_ps(x + j), _mm_mul_ps(h, vsj)));
+        _mm_storeu_ps(vs + j, _mm_add_ps(_mm_loadu_ps(v + j), _mm_mul_ps(h, acc)));
+    }
+    rungeKuttaStageScalar(x, v, a, f, xs, vs, dx, dv, j, count, weight, step);
+}
+
+TARGET_SSE2 void rungeKuttaEndSSE2(float* x, float* v, const float* a, const float* f,
+                                   const float* vs, const float* dx, const float* dv, size_t count,
+                                   float weight) {
+    const __m128 w = _mm_set1_ps(weight);
+    size_t j = 0;
+    for (; j + 4 <= count; j += 4) {
+        const __m128 acc = _mm_add_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(f + j));
+        const __m128 dxj = _mm_add_ps(_mm_loadu_ps(dx + j), _mm_mul_ps(w, _mm_loadu_ps(vs + j)));
+        const __m128 dvj = _mm_add_ps(_mm_loadu_ps(dv + j), _mm_mul_ps(w, acc));
+        _mm_storeu_ps(x + j, _mm_add_ps(_mm_loadu_ps(x + j), dxj));
+        _mm_storeu_ps(v + j, _mm_add_ps(_mm_loadu_ps(v + j), dvj));
+    }
+    rungeKuttaEndScalar(x, v, a, f, vs, dx, dv, j, count, weight);
+}
+
+// The integration kernels process 8 floats, i.e. 4 particles, per iteration
+TARGET_AVX2 void kickDriftAVX2(float* x, float* v, const float* a, const float* f, size_t count,
+                               float kick, float drift) {
+    const __m256 k = _mm256_set1_ps(kick);
+    const __m256 d = _mm256_set1_ps(drift);
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        const __m256 acc = _mm256_add_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(f + j));
+        const __m256 vj = _mm256_add_ps(_mm256_loadu_ps(v + j), _mm256_mul_ps(k, acc));
+        _mm256_storeu_ps(v + j, vj);
+        _mm256_storeu_ps(x + j, _mm256_add_ps(_mm256_loadu_ps(x + j), _mm256_mul_ps(d, vj)));
+    }
+    kickDriftScalar(x, v, a, f, j, count, kick, drift);
+}
+
+TARGET_AVX2 void kickAVX2(float* v, const float* a, const float* f, size_t count, float kick) {
+    const __m256 k = _mm256_set1_ps(kick);
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        const __m256 acc = _mm256_add_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(f + j));
+        _mm256_storeu_ps(v + j, _mm256_add_ps(_mm256_loadu_ps(v + j), _mm256_mul_ps(k, acc)));
+    }
+    kickScalar(v, a, f, j, count, kick);
+}
+
+TARGET_AVX2 void rungeKuttaBeginAVX2(const float* x, const float* v, const float* a,
+                                     const float* f, float* xs, float* vs, float* dx, float* dv,
+                                     size_t count, float weight, float step) {
+    const __m256 w = _mm256_set1_ps(weight);
+    const __m256 h = _mm256_set1_ps(step);
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        const __m256 vj = _mm256_loadu_ps(v + j);
+        const __m256 acc = _mm256_add_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(f + j));
+        _mm256_storeu_ps(dx + j, _mm256_mul_ps(w, vj));
+        _mm256_storeu_ps(dv + j, _mm256_mul_ps(w, acc));
+        _mm256_storeu_ps(xs + j, _mm256_add_ps(_mm256_loadu_ps(x + j), _mm256_mul_ps(h, vj)));
+        _mm256_storeu_ps(vs + j, _mm256_add_ps(vj, _mm256_mul_ps(h, acc)));
+    }
+    rungeKuttaBeginScalar(x, v, a, f, xs, vs, dx, dv, j, count, weight, step);
+}
+
+TARGET_AVX2 void rungeKuttaStageAVX2(const float* x, const float* v, const float* a,
+                                     const float* f, float* xs, float* vs, float* dx, float* dv,
+                                     size_t count, float weight, float step) {
+    const __m256 w = _mm256_set1_ps(weight);
+    const __m256 h = _mm256_set1_ps(step);
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        const __m256 vsj = _mm256_loadu_ps(vs + j);
+        const __m256 acc = _mm256_add_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(f + j));
+        _mm256_storeu_ps(dx + j, _mm256_add_ps(_mm256_loadu_ps(dx + j), _mm256_mul_ps(w, vsj)));
+        _mm256_storeu_ps(dv + j, _mm256_add_ps(_mm256_loadu_ps(dv + j), _mm256_mul_ps(w, acc)));
+        _mm256_storeu_ps(xs + j, _mm256_add_ps(_mm256_loadu_ps(x + j), _mm256_mul_ps(h, vsj)));
+        _mm256_storeu_ps(vs + j, _mm256_add_ps(_mm256_loadu_ps(v + j), _mm256_mul_ps(h, acc)));
+    }
+    rungeKuttaStageScalar(x, v, a, f, xs, vs, dx, dv, j, count, weight, step);
+}
+
+TARGET_AVX2 void rungeKuttaEndAVX2(float* x, float* v, const float* a, const float* f,
+                                   const float* vs, const float* dx, const float* dv, size_t count,
+                                   float weight) {
+    const __m256 w = _mm256_set1_ps(weight);
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        const __m256 acc = _mm256_add_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(f + j));
+        const __m256 vsj = _mm256_loadu_ps(vs + j);
+        const __m256 dxj = _mm256_add_ps(_mm256_loadu_ps(dx + j), _mm256_mul_ps(w, vsj));
+        const __m256 dvj = _mm256_add_ps(_mm256_loadu_ps(dv + j), _mm256_mul_ps(w, acc));
+        _mm256_storeu_ps(x + j, _mm256_add_ps(_mm256_loadu_ps(x + j), dxj));
+        _mm256_storeu_ps(v + j, _mm256_add_ps(_mm256_loadu_ps(v + j), dvj));
+    }
+    rungeKuttaEndScalar(x, v, a, f, vs, dx, dv, j, count, weight);
+}
+
+#endif
+
+// The floats of an array of vectors
+float* floats(std::span<glm::vec2> values) { return reinterpret_cast<float*>(values.data()); }
+const float* floats(std::span<const glm::vec2> values) {
+    return reinterpret_cast<const float*>(values.data());
+}
+
+}  // namespace
+
+const char* toString(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar:
+            return "Scalar";
+        case SimdLevel::SSE2:
+            return "SSE2";
+        case SimdLevel::AVX2:
+            return "AVX2";
+    }
+    return "Unknown";
+}
+
+SimdLevel detectSimdLevel() {
+#if defined(PARTICLESYSTEM_X86) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    // The operating system has to save the ymm registers on context switches
+    const bool ymmEnabled = osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+    bool avx2 = false;
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = ymmEnabled && (info[1] & (1 << 5)) != 0;
+    }
+    return avx2 ? SimdLevel::AVX2 : sse2 ? SimdLevel::SSE2 : SimdLevel::Scalar;
+#elif defined(PARTICLESYSTEM_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+    return SimdLevel::Scalar;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel getSimdLevel() { return currentLevel.load(std::memory_order_relaxed); }
+
+void setSimdLevel(SimdLevel level) {
+    currentLevel.store(std::min(level, detectSimdLevel()), std::memory_order_relaxed);
+}
+
+void accumulateRadialForce(std::span<const glm::vec2> positions,
+                           std::span<glm::vec2> accelerations, glm::vec2 center, float k) {
+    const RadialSource source{center, k};
+    accumulateRadialForces(positions, accelerations, {&source, 1});
+}
+
+void accumulateRadialForce(std::span<const glm::vec2> positions,
+                           std::span<glm::vec2> accelerations, glm::vec2 center, float k,
+                           float range) {
+    if (range == std::numeric_limits<float>::infinity()) {
+        accumulateRadialForce(positions, accelerations, center, k);
+        return;
+    }
+
+    const float range2 = range * range;
+    const size_t count = std::min(positions.size(), accelerations.size());
+    for (size_t i = 0; i < count; ++i) {
+        const glm::vec2 d = center - positions[i];
+        const float len2 = d.x * d.x + d.y * d.y;
+        if (len2 <= range2) {
+            accelerations[i] += d * (k / len2);
+        }
+    }
+}
+
+void accumulateRadialForces(std::span<const glm::vec2> positions,
+                            std::span<glm::vec2> accelerations,
+                            std::span<const RadialSource> sources) {
+    if (sources.empty()) return;
+
+    const size_t count = std::min(positions.size(), accelerations.size());
+    switch (getSimdLevel()) {
+#ifdef PARTICLESYSTEM_X86
+        case SimdLevel::AVX2:
+            radialForceAVX2(positions.data(), accelerations.data(), count, sources);
+            return;
+        case SimdLevel::SSE2:
+            radialForceSSE2(positions.data(), accelerations.data(), count, sources);
+            return;
+#endif
+        default:
+            radialForceScalar(positions.data(), accelerations.data(), 0, count, sources);
+            return;
+    }
+}
+
+void kickDrift(std::span<glm::vec2> x, std::span<glm::vec2> v, std::span<const glm::vec2> a,
+               std::span<const glm::vec2> f, float kick, float drift) {
+    const size_t count = 2 * x.size();
+    switch (getSimdLevel()) {
+#ifdef PARTICLESYSTEM_X86
+        case SimdLevel::AVX2:
+            kickDriftAVX2(floats(x), floats(v), floats(a), floats(f), count, kick, drift);
+            return;
+        case SimdLevel::SSE2:
+            kickDriftSSE2(floats(x), floats(v), floats(a), floats(f), count, kick, drift);
+            return;
+#endif
+        default:
+            kickDriftScalar(floats(x), floats(v), floats(a), floats(f), 0, count, kick, drift);
+            return;
+    }
+}
+
+void kick(std::span<glm::vec2> v, std::span<const glm::vec2> a, std::span<const glm::vec2> f,
+          float scale) {
+    const size_t count = 2 * v.size();
+    switch (getSimdLevel()) {
+#ifdef PARTICLESYSTEM_X86
+        case SimdLevel::AVX2:
+            kickAVX2(floats(v), floats(a), floats(f), count, scale);
+            return;
+        case SimdLevel::SSE2:
+            kickSSE2(floats(v), floats(a), floats(f), count, scale);
+            return;
+#endif
+        default:
+            kickScalar(floats(v), floats(a), floats(f), 0, count, scale);
+            return;
+    }
+}
+
+void rungeKuttaBegin(std::span<const glm::vec2> x, std::span<const glm::vec2> v,
+                     std::span<const glm::vec2> a, std::span<const glm::vec2> f,
+                     std::span<glm::vec2> xs, std::span<glm::vec2> vs, std::span<glm::vec2> dx,
+                     std::span<glm::vec2> dv, float weight, float step) {
+    const size_t count = 2 * x.size();
+    switch (getSimdLevel()) {
+#ifdef PARTICLESYSTEM_X86
+        case SimdLevel::AVX2:
+            rungeKuttaBeginAVX2(floats(x), floats(v), floats(a), floats(f), floats(xs), floats(vs),
+                                floats(dx), floats(dv), count, weight, step);
+            return;
+        case SimdLevel::SSE2:
+            rungeKuttaBeginSSE2(floats(x), floats(v), floats(a), floats(f), floats(xs), floats(vs),
+                                floats(dx), floats(dv), count, weight, step);
+            return;
+#endif
+        default:
+            rungeKuttaBeginScalar(floats(x), floats(v), floats(a), floats(f), floats(xs),
+                                  floats(vs), floats(dx), floats(dv), 0, count, weight, step);
+            return;
+    }
+}
+
+void rungeKuttaStage(std::span<const glm::vec2> x, std::span<const glm::vec2> v,
+                     std::span<const glm::vec2> a, std::span<const glm::vec2> f,
+                     std::span<glm::vec2> xs, std::span<glm::vec2> vs, std::span<glm::vec2> dx,
+                     std::span<glm::vec2> dv, float weight, float step) {
+    const size_t count = 2 * x.size();
+    switch (getSimdLevel()) {
+#ifdef PARTICLESYSTEM_X86
+        case SimdLevel::AVX2:
+            rungeKuttaStageAVX2(floats(x), floats(v), floats(a), floats(f), floats(xs), floats(vs),
+                                floats(dx), floats(dv), count, weight, step);
+            return;
+        case SimdLevel::SSE2:
+            rungeKuttaStageSSE2(floats(x), floats(v), floats(a), floats(f), floats(xs), floats(vs),
+                                floats(dx), floats(dv), count, weight, step);
+            return;
+#endif
+        default:
+            rungeKuttaStageScalar(floats(x), floats(v), floats(a), floats(f), floats(xs),
+                                  floats(vs), floats(dx), floats(dv), 0, count, weight, step);
+            return;
+    }
+}
+
+void rungeKuttaEnd(std::span<glm::vec2> x, std::span<glm::vec2> v, std::span<const glm::vec2> a,
+                   std::span<const glm::vec2> f, std::span<const glm::vec2> vs,
+                   std::span<const glm::vec2> dx, std::span<const glm::vec2> dv, float weight) {
+    const size_t count = 2 * x.size();
+    switch (getSimdLevel()) {
+#ifdef PARTICLESYSTEM_X86
+        case SimdLevel::AVX2:
+            rungeKuttaEndAVX2(floats(x), floats(v), floats(a), floats(f), floats(vs), floats(dx),
+                              floats(dv), count, weight);
+            return;
+        case SimdLevel::SSE2:
+            rungeKuttaEndSSE2(floats(x), floats(v), floats(a), floats(f), floats(vs), floats(dx),
+                              floats(dv), count, weight);
+            return;
+#endif
+        default:
+            rungeKuttaEndScalar(floats(x), floats(v), floats(a), floats(f), floats(vs), floats(dx),
+                                floats(dv), 0, count, weight);
+            return;
+    }
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,91 @@
+#include <particlesystem/particlepool.h>
+#include <particlesystem/particlesystem.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace particlesystem {
+
+ParticlePool::ParticlePool(size_t capacity, OverflowPolicy policy)
+    : store(capacity), maxParticles{capacity}, policy{policy}, overflowCount{0} {
+    if (policy == OverflowPolicy::RecycleOldest) {
+        scratch.reserve(capacity);
+    }
+}
+
+size_t ParticlePool::acquire(size_t count) {
+    const size_t available = maxParticles - std::min(maxParticles, store.size());
+    if (count > available) {
+        switch (policy) {
+            case OverflowPolicy::DropNewest:
+                overflowCount += count - available;
+                count = available;
+                break;
+            case OverflowPolicy::RecycleOldest:
+                // A request larger than the whole pool only keeps its last particles
+                count = std::min(count, maxParticles);
+                overflowCount += count - available;
+                recycleOldest(count - available);
+                break;
+            case OverflowPolicy::Grow:
+                maxParticles = std::max(store.size() + count, 2 * maxParticles);
+                store.reserve(maxParticles);
+                break;
+        }
+    }
+    return store.append(count);
+}
+
+bool ParticlePool::spawn(const Particle& particle) {
+    const size_t first = acquire(1);
+    if (first == store.size()) {
+        return false;
+    }
+    store.set(first, particle);
+    return true;
+}
+
+size_t ParticlePool::emit(Emitter& emitter, float dt) {
+    return spawn(emitter.particlesDue(dt), [&](ParticleStore& out, size_t first, size_t count) {
+        emitter.generate(out, first, count);
+    });
+}
+
+size_t ParticlePool::retireExpired(float maxLifetime, RetireOrder order) {
+    return store.retireExpired(maxLifetime, order);
+}
+
+void ParticlePool::recycleOldest(size_t count) {
+    std::span<float> lifetime = store.getLifetime();
+    if (count >= lifetime.size()) {
+        store.clear();
+        return;
+    }
+
+    // Find the lifetime of the count:th oldest particle, the scratch buffer was reserved up front
+    // so this does not allocate
+    scratch.assign(lifetime.begin(), lifetime.end());
+    const auto nth = scratch.begin() + static_cast<std::ptrdiff_t>(count - 1);
+    std::nth_element(scratch.begin(), nth, scratch.end(), std::greater<>{});
+    const float threshold = *nth;
+
+    // Mark exactly 'count' particles as expired. Everything older than the threshold is marked
+    // first and any remaining slots are taken from the particles that are exactly as old.
+    const auto older =
+        static_cast<size_t>(std::count_if(lifetime.begin(), lifetime.end(),
+                                          [&](float age) { return age > threshold; }));
+    size_t sameAge = count - older;
+    constexpr float expired = std::numeric_limits<float>::infinity();
+    for (float& age : lifetime) {
+        if (age > threshold) {
+            age = expired;
+        } else if (age == threshold && sameAge > 0) {
+            age = expired;
+            --sameAge;
+        }
+    }
+    store.retireExpired(std::numeric_limits<float>::max());
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,163 @@
+#include <particlesystem/particlestore.h>
+#include <particlesystem/kernels.h>
+#include <particlesystem/particlesystem.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace particlesystem {
+
+ParticleStore::ParticleStore(size_t capacity) { reserve(capacity); }
+
+void ParticleStore::reserve(size_t capacity) {
+    position.reserve(capacity);
+    previousPosition.reserve(capacity);
+    velocity.reserve(capacity);
+    acceleration.reserve(capacity);
+    force.reserve(capacity);
+    lifetime.reserve(capacity);
+    radius.reserve(capacity);
+    color.reserve(capacity);
+}
+
+void ParticleStore::clear() {
+    position.clear();
+    previousPosition.clear();
+    velocity.clear();
+    acceleration.clear();
+    force.clear();
+    lifetime.clear();
+    radius.clear();
+    color.clear();
+}
+
+size_t ParticleStore::push(const Particle& particle) {
+    position.push_back(particle.position);
+    previousPosition.push_back(particle.position);
+    velocity.push_back(particle.velocity);
+    acceleration.push_back(particle.acceleration);
+    force.push_back({0.0f, 0.0f});
+    lifetime.push_back(particle.lifetime);
+    radius.push_back(particle.radius);
+    color.push_back(particle.color);
+    return position.size() - 1;
+}
+
+size_t ParticleStore::append(size_t count) {
+    const size_t first = size();
+    resize(first + count);
+    return first;
+}
+
+void ParticleStore::set(size_t i, const Particle& particle) {
+    position[i] = particle.position;
+    previousPosition[i] = particle.position;
+    velocity[i] = particle.velocity;
+    acceleration[i] = particle.acceleration;
+    force[i] = {0.0f, 0.0f};
+    lifetime[i] = particle.lifetime;
+    radius[i] = particle.radius;
+    color[i] = particle.color;
+}
+
+void ParticleStore::erase(size_t i) {
+    const auto offset = static_cast<std::ptrdiff_t>(i);
+    position.erase(position.begin() + offset);
+    previousPosition.erase(previousPosition.begin() + offset);
+    velocity.erase(velocity.begin() + offset);
+    acceleration.erase(acceleration.begin() + offset);
+    force.erase(force.begin() + offset);
+    lifetime.erase(lifetime.begin() + offset);
+    radius.erase(radius.begin() + offset);
+    color.erase(color.begin() + offset);
+}
+
+size_t ParticleStore::retireExpired(float maxLifetime, RetireOrder order) {
+    const size_t initialSize = size();
+    size_t count = initialSize;
+
+    if (order == RetireOrder::Unordered) {
+        // Swap-and-pop: fill the hole with the last particle and check the same slot again since
+        // the particle moved into it may also have expired
+        size_t i = 0;
+        while (i < count) {
+            if (lifetime[i] > maxLifetime) {
+                --count;
+                moveParticle(count, i);
+            } else {
+                ++i;
+            }
+        }
+    } else {
+        // Stream compaction: copy every surviving particle to the next free slot
+        count = 0;
+        for (size_t i = 0; i < initialSize; ++i) {
+            if (lifetime[i] <= maxLifetime) {
+                if (count != i) {
+                    moveParticle(i, count);
+                }
+                ++count;
+            }
+        }
+    }
+
+    resize(count);
+    return initialSize - count;
+}
+
+void ParticleStore::moveParticle(size_t from, size_t to) {
+    position[to] = position[from];
+    previousPosition[to] = previousPosition[from];
+    velocity[to] = velocity[from];
+    acceleration[to] = acceleration[from];
+    force[to] = force[from];
+    lifetime[to] = lifetime[from];
+    radius[to] = radius[from];
+    color[to] = color[from];
+}
+
+void ParticleStore::resize(size_t count) {
+    position.resize(count);
+    previousPosition.resize(count);
+    velocity.resize(count);
+    acceleration.resize(count);
+    force.resize(count);
+    lifetime.resize(count);
+    radius.resize(count);
+    color.resize(count);
+}
+
+void ParticleStore::updateLifetime(const double dt) {
+    const float fdt = static_cast<float>(dt);
+    for (float& age : lifetime) {
+        age += fdt;
+    }
+}
+
+void ParticleStore::storePreviousPosition() {
+    std::ranges::copy(position, previousPosition.begin());
+}
+
+void ParticleStore::resetPreviousPosition(size_t first, size_t count) {
+    std::copy_n(position.begin() + static_cast<std::ptrdiff_t>(first), count,
+                previousPosition.begin() + static_cast<std::ptrdiff_t>(first));
+}
+
+void ParticleStore::interpolatePosition(float alpha, std::span<glm::vec2> out) const {
+    assert(out.size() == size());
+    for (size_t i = 0; i < out.size(); ++i) {
+        out[i] = previousPosition[i] + (position[i] - previousPosition[i]) * alpha;
+    }
+}
+
+void ParticleStore::updatePosition(const double dt) { updatePosition(dt, 0, size()); }
+
+void ParticleStore::updatePosition(const double dt, size_t begin, size_t end) {
+    const auto fdt = static_cast<float>(dt);
+    const size_t count = end - begin;
+    kickDrift(std::span(position).subspan(begin, count), std::span(velocity).subspan(begin, count),
+              std::span(acceleration).subspan(begin, count), std::span(force).subspan(begin, count),
+              fdt, fdt);
+}
+
+}  // namespace particlesystem
@@ -1,9 +1,15 @@
 ﻿#include <particlesystem/particlesystem.h>
+#include <particlesystem/kernels.h>
+#include <particlesystem/effecttable.h>
+#include <particlesystem/particlestore.h>
+#include <particlesystem/random.h>
+#include <algorithm>
+#include <array>
 #include <iostream>
 
 // Returns a random value between "direction" and "width"
 float randomValue(float direction, float width) {
-    return direction + width * rand() / static_cast<float>(RAND_MAX);
+    return direction + width * particlesystem::threadStream().nextFloat();
 }
 
 // Updates the particle's position based on acceleration and time (dt)
@@ -29,40 +35,103 @@ Particle Spinner::createParticle() {
     return myParticle;
 }
 
-// Manipulates particle positions and accelerations by attracting particles
-void GravityWell::effectParticle(std::vector<Particle>& allParticles) {
-    for (Particle& p : allParticles) {
-        // Calculate the distance between the GravityWell object's position and the particle's
-        // position
-        float dx = position.x - p.position.x;
-        float dy = position.y - p.position.y;
-        float length = std::sqrt(std::pow(dx, 2.0f) + std::pow(dy, 2.0f));
-        // Calculate the strength of gravitational force based on distance
-        float strength = force / (length * 5);
-        // Normalize the distance vector
-        float nx = dx / length;
-        float ny = dy / length;
-        // Apply an acceleration to the particle in the direction of the GravityWell object
-        p.acceleration.x += strength * nx;
-        p.acceleration.y += strength * ny;
+size_t Emitter::particlesDue(float dt) {
+    pending += rate * dt;
+    if (!(pending >= 0.0f)) {
+        pending = 0.0f;
     }
+    const float due = std::floor(pending);
+    pending -= due;
+    return static_cast<size_t>(due);
 }
 
-// Manipulates particle positions and accelerations by repelling particles
-void Wind::effectParticle(std::vector<Particle>& allParticles) {
-    for (Particle& p : allParticles) {
-        // Calculate the distance between the Wind object's position and the particle's
-        // position
-        float dx = position.x - p.position.x;
-        float dy = position.y - p.position.y;
-        float length = std::sqrt(std::pow(dx, 2.0f) + std::pow(dy, 2.0f));
-        // Calculate the strength of the force based on distance
-        float strength = force / (length * 5.0f);
-        // Normalize the distance vector
-        float nx = dx / length;
-        float ny = dy / length;
-        // Apply an acceleration to the particle in the direction away from the Wind object
-        p.acceleration.x -= strength * nx;
-        p.acceleration.y -= strength * ny;
+void Emitter::emit(float dt, particlesystem::ParticleStore& out) {
+    const size_t count = particlesDue(dt);
+    const size_t first = out.append(count);
+    generate(out, first, count);
+    out.resetPreviousPosition(first, count);
+}
+
+// Each attribute is written in its own loop without any calls between the elements, which lets
+// the compiler vectorize them
+void Emitter::generateFromAngles(particlesystem::ParticleStore& out, size_t first,
+                                 size_t count) const {
+    const Particle prototype(this->position, 0.0f);
+    std::ranges::fill(out.getPosition().subspan(first, count), prototype.position);
+    std::ranges::fill(out.getVelocity().subspan(first, count), prototype.velocity);
+    std::ranges::fill(out.getLifetime().subspan(first, count), prototype.lifetime);
+    std::ranges::fill(out.getRadius().subspan(first, count), prototype.radius);
+    std::ranges::fill(out.getColor().subspan(first, count), prototype.color);
+    for (glm::vec2& acceleration : out.getAcceleration().subspan(first, count)) {
+        const float theta = acceleration.x;
+        acceleration = {prototype.force * std::cos(theta), prototype.force * std::sin(theta)};
+    }
+}
+
+// The angles are generated in batches on the stack, the acceleration array interleaves x and y so
+// the random numbers cannot be written into it directly
+void Emitter::generateAngles(particlesystem::ParticleStore& out, size_t first, size_t count,
+                             float low, float high) {
+    constexpr size_t batchSize = 256;
+    std::array<float, batchSize> angles;
+    std::span<glm::vec2> accelerations = out.getAcceleration().subspan(first, count);
+    for (size_t begin = 0; begin < count; begin += batchSize) {
+        const size_t n = std::min(batchSize, count - begin);
+        random.fillUniform(std::span(angles).first(n), low, high);
+        for (size_t i = 0; i < n; ++i) {
+            accelerations[begin + i].x = angles[i];
+        }
     }
 }
+
+// Creates particles with "uniform" distribution
+void Uniform::generate(particlesystem::ParticleStore& out, size_t first, size_t count) {
+    generateAngles(out, first, count, 0.0f, twoPi);
+    generateFromAngles(out, first, count);
+}
+
+// Creates particles with "directional" distribution
+void Directional::generate(particlesystem::ParticleStore& out, size_t first, size_t count) {
+    generateAngles(out, first, count, direction, direction + width);
+    generateFromAngles(out, first, count);
+}
+
+void Spinner::generate(particlesystem::ParticleStore& out, size_t first, size_t count) {
+    if (count == 0) return;
+
+    // The particles are emitted 1 / rate seconds apart
+    const float step = spinSpeed / rate;
+    std::span<glm::vec2> accelerations = out.getAcceleration().subspan(first, count);
+    for (size_t i = 0; i < count; ++i) {
+        accelerations[i].x = direction + step * static_cast<float>(i + 1);
+    }
+    constexpr float twoPi = static_cast<float>(2 * 3.14159265358979323846);
+    direction = std::fmod(direction + step * static_cast<float>(count), twoPi);
+    generateFromAngles(out, first, count);
+}
+
+// Manipulates particle positions and accelerations by attracting particles. The strength of the
+// force is force / (5 * distance) in the direction of the GravityWell object.
+void GravityWell::effectParticle(std::span<const glm::vec2> positions,
+                                 std::span<glm::vec2> accelerations) {
+    particlesystem::accumulateRadialForce(positions, accelerations, position, force / 5.0f,
+                                          influenceRadius);
+}
+
+bool GravityWell::pack(particlesystem::EffectTable& table) const {
+    table.addRadial(position, force / 5.0f, influenceRadius);
+    return true;
+}
+
+// Manipulates particle positions and accelerations by repelling particles. The strength of the
+// force is force / (5 * distance) in the direction away from the Wind object.
+void Wind::effectParticle(std::span<const glm::vec2> positions,
+                          std::span<glm::vec2> accelerations) {
+    particlesystem::accumulateRadialForce(positions, accelerations, position, -force / 5.0f,
+                                          influenceRadius);
+}
+
+bool Wind::pack(particlesystem::EffectTable& table) const {
+    table.addRadial(position, -force / 5.0f, influenceRadius);
+    return true;
+}
@@ -0,0 +1,98 @@
+#include <particlesystem/pipeline.h>
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace particlesystem {
+
+void ParticleSnapshot::capture(const ParticleStore& particles, float interpolation) {
+    previousPosition.assign(particles.getPreviousPosition().begin(),
+                            particles.getPreviousPosition().end());
+    position.assign(particles.getPosition().begin(), particles.getPosition().end());
+    radius.assign(particles.getRadius().begin(), particles.getRadius().end());
+    color.assign(particles.getColor().begin(), particles.getColor().end());
+    alpha = interpolation;
+}
+
+void ParticleSnapshot::interpolatePosition(std::span<glm::vec2> out) const {
+    assert(out.size() == size());
+    for (size_t i = 0; i < out.size(); ++i) {
+        out[i] = previousPosition[i] + (position[i] - previousPosition[i]) * alpha;
+    }
+}
+
+SimulationPipeline::SimulationPipeline(Step step, Mode mode) : step{std::move(step)}, mode{mode} {}
+
+SimulationPipeline::~SimulationPipeline() {
+    if (worker.joinable()) {
+        stopping.store(true, std::memory_order_relaxed);
+        launched.fetch_add(1, std::memory_order_release);
+        launched.notify_one();
+        worker.join();
+    }
+}
+
+void SimulationPipeline::launch() {
+    assert(launched.load() == finished.load() && "sync() must be called between launches");
+    ParticleSnapshot& back = snapshots[1 - frontIndex];
+    back.frame = ++frameCount;
+
+    if (mode == Mode::Serial) {
+        try {
+            step(back);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // The counters are left alone, so that an idle worker from an earlier pipelined frame
+        // is not woken up
+        return;
+    }
+
+    if (!worker.joinable()) {
+        worker = std::thread([this]() { workerLoop(); });
+    }
+    launched.fetch_add(1, std::memory_order_release);
+    launched.notify_one();
+}
+
+const ParticleSnapshot& SimulationPipeline::sync() {
+    const uint64_t target = launched.load(std::memory_order_relaxed);
+    for (uint64_t done = finished.load(std::memory_order_acquire); done != target;
+         done = finished.load(std::memory_order_acquire)) {
+        finished.wait(done, std::memory_order_acquire);
+    }
+
+    if (error) {
+        // The back snapshot is incomplete, so the front one stays
+        std::rethrow_exception(std::exchange(error, nullptr));
+    }
+    if (snapshots[1 - frontIndex].frame > snapshots[frontIndex].frame) {
+        frontIndex = 1 - frontIndex;
+    }
+    return snapshots[frontIndex];
+}
+
+void SimulationPipeline::setMode(Mode newMode) {
+    assert(launched.load() == finished.load() && "the mode cannot change while a step is running");
+    mode = newMode;
+}
+
+void SimulationPipeline::workerLoop() {
+    uint64_t seen = finished.load(std::memory_order_relaxed);
+    while (true) {
+        launched.wait(seen, std::memory_order_acquire);
+        seen = launched.load(std::memory_order_acquire);
+        if (stopping.load(std::memory_order_relaxed)) return;
+
+        try {
+            step(snapshots[1 - frontIndex]);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        finished.store(seen, std::memory_order_release);
+        finished.notify_one();
+    }
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,212 @@
+#include <particlesystem/profiler.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+namespace particlesystem::profiling {
+
+namespace {
+
+struct ZoneData {
+    std::string name;
+    // Nanoseconds recorded during the current frame
+    std::atomic<uint64_t> pending{0};
+    // Milliseconds per frame, indexed by the frame number modulo HistorySize
+    std::array<float, HistorySize> history{};
+};
+
+// Registration and the history are guarded by the mutex, recording only touches the atomics
+struct Profiler {
+    std::mutex mutex;
+    std::array<ZoneData, MaxZones> zones;
+    std::atomic<uint32_t> zoneCount{0};
+    uint64_t frameCount = 0;
+
+    size_t historyFrames() const {
+        return static_cast<size_t>(std::min<uint64_t>(frameCount, HistorySize));
+    }
+
+    // The i:th of the frames in the history, oldest first
+    float sample(const ZoneData& zone, size_t i) const {
+        return zone.history[(frameCount - historyFrames() + i) % HistorySize];
+    }
+};
+
+Profiler& profiler() {
+    static Profiler instance;
+    return instance;
+}
+
+ZoneStats computeStats(const Profiler& p, const ZoneData& zone) {
+    const size_t frames = p.historyFrames();
+    ZoneStats stats{zone.name, 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (frames == 0) return stats;
+
+    std::vector<float> samples(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        samples[i] = p.sample(zone, i);
+    }
+    stats.last = samples.back();
+    double sum = 0.0;
+    for (float s : samples) sum += s;
+    stats.mean = sum / static_cast<double>(frames);
+    const auto [min, max] = std::ranges::minmax(samples);
+    stats.min = min;
+    stats.max = max;
+    const auto p95 = samples.begin() + static_cast<std::ptrdiff_t>((frames - 1) * 95 / 100);
+    std::ranges::nth_element(samples, p95);
+    stats.p95 = *p95;
+    return stats;
+}
+
+std::string toCsv(const Profiler& p) {
+    const uint32_t zoneCount = p.zoneCount.load();
+    std::string csv = "frame";
+    for (uint32_t z = 0; z < zoneCount; ++z) {
+        csv += fmt::format(",{}", p.zones[z].name);
+    }
+    csv += '\n';
+    const size_t frames = p.historyFrames();
+    for (size_t i = 0; i < frames; ++i) {
+        csv += fmt::format("{}", p.frameCount - frames + i);
+        for (uint32_t z = 0; z < zoneCount; ++z) {
+            csv += fmt::format(",{}", p.sample(p.zones[z], i));
+        }
+        csv += '\n';
+    }
+    return csv;
+}
+
+std::string toJson(const Profiler& p) {
+    const uint32_t zoneCount = p.zoneCount.load();
+    const size_t frames = p.historyFrames();
+    std::string json = "{\n";
+    json += fmt::format("  \"frames\": {},\n", p.frameCount);
+    json += fmt::format("  \"firstSample\": {},\n", p.frameCount - frames);
+    json += "  \"zones\": [";
+    for (uint32_t z = 0; z < zoneCount; ++z) {
+        const ZoneStats stats = computeStats(p, p.zones[z]);
+        json += z == 0 ? "\n" : ",\n";
+        json += "    {\n";
+        json += fmt::format("      \"name\": \"{}\",\n", stats.name);
+        json += fmt::format("      \"mean\": {},\n", stats.mean);
+        json += fmt::format("      \"min\": {},\n", stats.min);
+        json += fmt::format("      \"max\": {},\n", stats.max);
+        json += fmt::format("      \"p95\": {},\n", stats.p95);
+        json += "      \"samples\": [";
+        for (size_t i = 0; i < frames; ++i) {
+            json += fmt::format("{}{}", i == 0 ? "" : ", ", p.sample(p.zones[z], i));
+        }
+        json += "]\n    }";
+    }
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+}  // namespace
+
+ZoneId registerZone(std::string_view name) {
+    Profiler& p = profiler();
+    std::lock_guard lock(p.mutex);
+    const uint32_t count = p.zoneCount.load(std::memory_order_relaxed);
+    for (uint32_t z = 0; z < count; ++z) {
+        if (p.zones[z].name == name) return z;
+    }
+    if (count == MaxZones) return MaxZones;
+
+    p.zones[count].name = name;
+    p.zoneCount.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void record(ZoneId zone, std::chrono::nanoseconds duration) {
+    if (zone >= MaxZones) return;
+    profiler().zones[zone].pending.fetch_add(static_cast<uint64_t>(duration.count()),
+                                             std::memory_order_relaxed);
+}
+
+void endFrame() {
+    Profiler& p = profiler();
+    std::lock_guard lock(p.mutex);
+    const uint32_t count = p.zoneCount.load(std::memory_order_relaxed);
+    for (uint32_t z = 0; z < count; ++z) {
+        const uint64_t ns = p.zones[z].pending.exchange(0, std::memory_order_relaxed);
+        p.zones[z].history[p.frameCount % HistorySize] = static_cast<float>(ns) * 1e-6f;
+    }
+    p.frameCount++;
+}
+
+void reset() {
+    Profiler& p = profiler();
+    std::lock_guard lock(p.mutex);
+    for (ZoneData& zone : p.zones) {
+        zone.pending.store(0, std::memory_order_relaxed);
+        zone.history.fill(0.0f);
+    }
+    p.frameCount = 0;
+}
+
+std::vector<ZoneStats> getStats() {
+    Profiler& p = profiler();
+    std::lock_guard lock(p.mutex);
+    std::vector<ZoneStats> stats;
+    const uint32_t count = p.zoneCount.load(std::memory_order_relaxed);
+    for (uint32_t z = 0; z < count; ++z) {
+        stats.push_back(computeStats(p, p.zones[z]));
+    }
+    return stats;
+}
+
+uint64_t getFrameCount() {
+    Profiler& p = profiler();
+    std::lock_guard lock(p.mutex);
+    return p.frameCount;
+}
+
+std::string sparkline(std::string_view name, size_t width) {
+    constexpr std::string_view levels = " .:-=+*#%@";
+
+    Profiler& p = profiler();
+    std::lock_guard lock(p.mutex);
+    const uint32_t count = p.zoneCount.load(std::memory_order_relaxed);
+    const auto zone = std::find_if(p.zones.begin(), p.zones.begin() + count,
+                                   [&](const ZoneData& z) { return z.name == name; });
+    if (zone == p.zones.begin() + count) return {};
+
+    const size_t frames = p.historyFrames();
+    const size_t shown = std::min(width, frames);
+    float peak = 0.0f;
+    for (size_t i = frames - shown; i < frames; ++i) {
+        peak = std::max(peak, p.sample(*zone, i));
+    }
+    std::string line(width - shown, levels[0]);
+    for (size_t i = frames - shown; i < frames; ++i) {
+        const float t = peak > 0.0f ? p.sample(*zone, i) / peak : 0.0f;
+        const auto level = static_cast<size_t>(t * static_cast<float>(levels.size() - 1) + 0.5f);
+        line += levels[std::min(level, levels.size() - 1)];
+    }
+    return line;
+}
+
+void writeReport(std::string_view path) {
+    Profiler& p = profiler();
+    std::string report;
+    {
+        std::lock_guard lock(p.mutex);
+        report = path.ends_with(".json") ? toJson(p) : toCsv(p);
+    }
+
+    std::ofstream file{std::string{path}};
+    file << report;
+    if (!file) {
+        throw std::runtime_error(fmt::format("Unable to write profile '{}'", path));
+    }
+}
+
+}  // namespace particlesystem::profiling
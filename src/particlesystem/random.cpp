@@ -0,0 +1,136 @@
+#include <particlesystem/random.h>
+
+#include <atomic>
+#include <numbers>
+
+namespace particlesystem {
+
+namespace {
+
+std::atomic<uint64_t> masterSeed{DefaultMasterSeed};
+std::atomic<uint64_t> nextStreamId{0};
+// Incremented by setMasterSeed so that the thread streams know when to restart
+std::atomic<uint64_t> seedGeneration{0};
+std::atomic<uint64_t> nextThreadIndex{0};
+
+// The thread streams use the upper half of the stream ids, makeStream the lower
+constexpr uint64_t ThreadStreamBit = uint64_t{1} << 63;
+
+inline void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+    const uint64_t product = static_cast<uint64_t>(a) * b;
+    hi = static_cast<uint32_t>(product >> 32);
+    lo = static_cast<uint32_t>(product);
+}
+
+// Maps the upper 24 bits to [0, 1), every float in the result is equally likely
+inline float toUnitFloat(uint32_t x) { return static_cast<float>(x >> 8) * 0x1.0p-24f; }
+
+}  // namespace
+
+std::array<uint32_t, 4> philox4x32(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key) {
+    constexpr uint32_t M0 = 0xD2511F53;
+    constexpr uint32_t M1 = 0xCD9E8D57;
+    constexpr uint32_t W0 = 0x9E3779B9;
+    constexpr uint32_t W1 = 0xBB67AE85;
+
+    for (int round = 0; round < 10; ++round) {
+        uint32_t hi0, lo0, hi1, lo1;
+        mulhilo(M0, counter[0], hi0, lo0);
+        mulhilo(M1, counter[2], hi1, lo1);
+        counter = {hi1 ^ counter[1] ^ key[0], lo1, hi0 ^ counter[3] ^ key[1], lo0};
+        key[0] += W0;
+        key[1] += W1;
+    }
+    return counter;
+}
+
+RandomStream::RandomStream(uint64_t seed, uint64_t stream)
+    : seed{seed}, stream{stream}, block{0}, buffer{}, bufferIndex{4} {}
+
+void RandomStream::reset() {
+    block = 0;
+    bufferIndex = 4;
+}
+
+void RandomStream::seek(uint64_t position) {
+    block = position / 4;
+    bufferIndex = 4;
+    for (uint64_t i = 0; i < position % 4; ++i) {
+        nextUInt();
+    }
+}
+
+std::array<uint32_t, 4> RandomStream::counter(uint64_t index) const {
+    return {static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32),
+            static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)};
+}
+
+uint32_t RandomStream::nextUInt() {
+    if (bufferIndex == 4) {
+        buffer = philox4x32(counter(block++),
+                            {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)});
+        bufferIndex = 0;
+    }
+    return buffer[bufferIndex++];
+}
+
+float RandomStream::nextFloat() { return toUnitFloat(nextUInt()); }
+
+void RandomStream::fillUniform(std::span<float> out, float low, float high) {
+    const float width = high - low;
+    size_t i = 0;
+
+    // Use up what is left of the current block first so that the sequence does not depend on how
+    // it is split into calls
+    for (; i < out.size() && bufferIndex < 4; ++i) {
+        out[i] = low + width * nextFloat();
+    }
+
+    const std::array<uint32_t, 2> key{static_cast<uint32_t>(seed),
+                                      static_cast<uint32_t>(seed >> 32)};
+    const size_t blocks = (out.size() - i) / 4;
+    float* dst = out.data() + i;
+    for (size_t b = 0; b < blocks; ++b) {
+        const std::array<uint32_t, 4> r = philox4x32(counter(block + b), key);
+        for (size_t j = 0; j < 4; ++j) {
+            dst[4 * b + j] = low + width * toUnitFloat(r[j]);
+        }
+    }
+    block += blocks;
+    i += 4 * blocks;
+
+    for (; i < out.size(); ++i) {
+        out[i] = low + width * nextFloat();
+    }
+}
+
+void RandomStream::fillAngles(std::span<float> out) {
+    fillUniform(out, 0.0f, 2.0f * std::numbers::pi_v<float>);
+}
+
+void setMasterSeed(uint64_t seed) {
+    masterSeed = seed;
+    nextStreamId = 0;
+    seedGeneration++;
+}
+
+uint64_t getMasterSeed() { return masterSeed; }
+
+RandomStream makeStream() { return RandomStream(masterSeed, nextStreamId++ & ~ThreadStreamBit); }
+
+RandomStream& threadStream() {
+    struct ThreadState {
+        uint64_t index = nextThreadIndex++;
+        uint64_t generation = ~uint64_t{0};
+        RandomStream stream;
+    };
+    thread_local ThreadState state;
+
+    if (state.generation != seedGeneration) {
+        state.generation = seedGeneration;
+        state.stream = RandomStream(masterSeed, ThreadStreamBit | state.index);
+    }
+    return state.stream;
+}
+
+}  // namespace particlesystem
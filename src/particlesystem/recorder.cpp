@@ -0,0 +1,305 @@
+#include <particlesystem/recorder.h>
+
+#include <particlesystem/random.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+
+namespace particlesystem {
+
+namespace {
+
+constexpr char Magic[8] = {'P', 'S', 'Y', 'S', 'R', 'E', 'C', '\0'};
+
+uint64_t hashBytes(uint64_t hash, std::span<const std::byte> bytes) {
+    constexpr uint64_t Prime = 0x100000001b3;
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes.data() + i, 8);
+        hash = (hash ^ word) * Prime;
+    }
+    for (; i < bytes.size(); ++i) {
+        hash = (hash ^ static_cast<uint64_t>(bytes[i])) * Prime;
+    }
+    return hash;
+}
+
+template <typename HandleVariant>
+uint32_t indexOf(std::span<const HandleVariant> handles, HandleVariant handle) {
+    return static_cast<uint32_t>(std::ranges::find(handles, handle) - handles.begin());
+}
+
+// Reads the events of a recording in order
+class EventReader {
+public:
+    explicit EventReader(std::span<const std::byte> data) : data{data} {}
+
+    bool atEnd() const { return offset == data.size(); }
+
+    // Returns the type of the next event and moves to its payload
+    RecordedEvent next() {
+        const auto type = read<uint32_t>();
+        payloadSize = read<uint32_t>();
+        payloadEnd = offset + payloadSize;
+        if (payloadEnd > data.size()) throw std::runtime_error("Truncated event in recording");
+        return static_cast<RecordedEvent>(type);
+    }
+
+    template <typename T>
+    T read() {
+        T value;
+        if (data.size() - offset < sizeof(T)) {
+            throw std::runtime_error("Truncated event in recording");
+        }
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    // Skips what is left of the payload of the current event
+    void skip() {
+        if (offset > payloadEnd) throw std::runtime_error("Malformed event in recording");
+        offset = payloadEnd;
+    }
+
+private:
+    std::span<const std::byte> data;
+    size_t offset = 0;
+    size_t payloadSize = 0;
+    size_t payloadEnd = 0;
+};
+
+template <typename HandleVariant>
+HandleVariant at(std::span<const HandleVariant> handles, uint32_t index) {
+    if (index >= handles.size()) {
+        throw std::runtime_error(fmt::format("Recording refers to a missing object {}", index));
+    }
+    return handles[index];
+}
+
+RecordingHeader readHeader(std::span<const std::byte> data, const std::string& path) {
+    RecordingHeader header;
+    if (data.size() < sizeof(header)) {
+        throw std::runtime_error(fmt::format("Invalid recording '{}'", path));
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+        throw std::runtime_error(fmt::format("Invalid recording '{}'", path));
+    }
+    if (header.version != RecordingVersion) {
+        throw std::runtime_error(fmt::format("Recording '{}' has unsupported version {}", path,
+                                             header.version));
+    }
+    if (header.overflowPolicy > static_cast<uint32_t>(OverflowPolicy::Grow)) {
+        throw std::runtime_error(fmt::format("Recording '{}' has an unknown overflow policy {}",
+                                             path, header.overflowPolicy));
+    }
+    return header;
+}
+
+}  // namespace
+
+uint64_t checksum(const ParticleStore& particles) {
+    uint64_t hash = 0xcbf29ce484222325;
+    hash = hashBytes(hash, std::as_bytes(particles.getPosition()));
+    hash = hashBytes(hash, std::as_bytes(particles.getVelocity()));
+    hash = hashBytes(hash, std::as_bytes(particles.getLifetime()));
+    return hash;
+}
+
+Recorder::~Recorder() { stop(); }
+
+void Recorder::start(const std::string& path, const ParticleSystem& system) {
+    stop();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error(fmt::format("Unable to create recording '{}'", path));
+
+    RecordingHeader header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = RecordingVersion;
+    header.masterSeed = getMasterSeed();
+    header.capacity = system.getPool().capacity();
+    header.overflowPolicy = static_cast<uint32_t>(system.getPool().getPolicy());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    events.clear();
+    queued.clear();
+    frameCount = 0;
+    stopping = false;
+    writeError.clear();
+    writer = std::thread(&Recorder::writerLoop, this);
+
+    recordSettings(system);
+    for (EmitterHandle handle : system.getEmitters()) recordAdd(system, handle);
+    for (EffectHandle handle : system.getEffects()) recordAdd(system, handle);
+}
+
+void Recorder::stop() {
+    if (!isRecording()) return;
+    {
+        std::lock_guard lock(mutex);
+        queued.insert(queued.end(), events.begin(), events.end());
+        stopping = true;
+    }
+    events.clear();
+    wake.notify_one();
+    writer.join();
+    file.close();
+}
+
+template <typename... T>
+void Recorder::append(RecordedEvent type, const T&... payload) {
+    if (!isRecording()) return;
+    const uint32_t header[2] = {static_cast<uint32_t>(type),
+                                static_cast<uint32_t>((sizeof(T) + ... + 0))};
+    auto add = [&](const auto& value) {
+        const auto bytes = std::as_bytes(std::span{&value, 1});
+        events.insert(events.end(), bytes.begin(), bytes.end());
+    };
+    add(header);
+    (add(payload), ...);
+}
+
+void Recorder::recordSettings(const ParticleSystem& system) {
+    append(RecordedEvent::Settings, toRecord(system));
+}
+
+void Recorder::recordAdd(const ParticleSystem& system, EmitterHandle handle) {
+    append(RecordedEvent::AddEmitter, toRecord(system, handle));
+}
+
+void Recorder::recordAdd(const ParticleSystem& system, EffectHandle handle) {
+    append(RecordedEvent::AddEffect, toRecord(system, handle));
+}
+
+void Recorder::recordRemove(const ParticleSystem& system, EmitterHandle handle) {
+    append(RecordedEvent::RemoveEmitter, indexOf(system.getEmitters(), handle));
+}
+
+void Recorder::recordRemove(const ParticleSystem& system, EffectHandle handle) {
+    append(RecordedEvent::RemoveEffect, indexOf(system.getEffects(), handle));
+}
+
+void Recorder::recordEdit(const ParticleSystem& system, EmitterHandle handle) {
+    append(RecordedEvent::EditEmitter, indexOf(system.getEmitters(), handle),
+           toRecord(system, handle));
+}
+
+void Recorder::recordEdit(const ParticleSystem& system, EffectHandle handle) {
+    append(RecordedEvent::EditEffect, indexOf(system.getEffects(), handle),
+           toRecord(system, handle));
+}
+
+void Recorder::recordFrame(double elapsed, const ParticleStore& particles) {
+    if (!isRecording()) return;
+    append(RecordedEvent::Frame, FrameRecord{elapsed, particles.size(), checksum(particles)});
+    frameCount++;
+
+    // Hand the frame over to the writer, the buffers keep their memory between frames
+    {
+        std::lock_guard lock(mutex);
+        if (!writeError.empty()) throw std::runtime_error(writeError);
+        queued.insert(queued.end(), events.begin(), events.end());
+    }
+    events.clear();
+    wake.notify_one();
+}
+
+void Recorder::writerLoop() {
+    std::vector<std::byte> writing;
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || !queued.empty(); });
+        if (queued.empty() && stopping) return;
+        std::swap(writing, queued);
+
+        lock.unlock();
+        file.write(reinterpret_cast<const char*>(writing.data()),
+                   static_cast<std::streamsize>(writing.size()));
+        file.flush();
+        const bool failed = !file;
+        writing.clear();
+        lock.lock();
+
+        if (failed) writeError = "Unable to write the recording";
+    }
+}
+
+RecordingHeader readRecordingHeader(const std::string& path) {
+    const MappedFile file{path};
+    return readHeader(file.data(), path);
+}
+
+ReplayResult replay(const std::string& path, ParticleSystem& system) {
+    const auto start = std::chrono::steady_clock::now();
+    const MappedFile file{path};
+    const std::span<const std::byte> data = file.data();
+
+    const RecordingHeader header = readHeader(data, path);
+
+    const std::vector<EmitterHandle> oldEmitters(system.getEmitters().begin(),
+                                                 system.getEmitters().end());
+    for (EmitterHandle handle : oldEmitters) system.remove(handle);
+    const std::vector<EffectHandle> oldEffects(system.getEffects().begin(),
+                                               system.getEffects().end());
+    for (EffectHandle handle : oldEffects) system.remove(handle);
+    system.getClock().reset();
+    setMasterSeed(header.masterSeed);
+
+    ReplayResult result;
+    EventReader events{data.subspan(sizeof(header))};
+    while (!events.atEnd()) {
+        switch (events.next()) {
+            case RecordedEvent::Settings:
+                applyRecord(system, events.read<SystemRecord>());
+                break;
+            case RecordedEvent::AddEmitter:
+                addFromRecord(system, events.read<EmitterRecord>());
+                break;
+            case RecordedEvent::AddEffect:
+                addFromRecord(system, events.read<EffectRecord>());
+                break;
+            case RecordedEvent::RemoveEmitter:
+                system.remove(at(system.getEmitters(), events.read<uint32_t>()));
+                break;
+            case RecordedEvent::RemoveEffect:
+                system.remove(at(system.getEffects(), events.read<uint32_t>()));
+                break;
+            case RecordedEvent::EditEmitter: {
+                const EmitterHandle handle = at(system.getEmitters(), events.read<uint32_t>());
+                // The random stream has moved on since the edit was recorded
+                applyRecord(system, handle, events.read<EmitterRecord>(), false);
+                break;
+            }
+            case RecordedEvent::EditEffect: {
+                const EffectHandle handle = at(system.getEffects(), events.read<uint32_t>());
+                applyRecord(system, handle, events.read<EffectRecord>());
+                break;
+            }
+            case RecordedEvent::Frame: {
+                const auto frame = events.read<FrameRecord>();
+                result.steps += static_cast<uint64_t>(system.update(frame.elapsed));
+                if (system.particles().size() != frame.particleCount ||
+                    checksum(system.particles()) != frame.checksum) {
+                    if (result.mismatches++ == 0) result.firstMismatch = result.frames;
+                }
+                result.frames++;
+                break;
+            }
+        }
+        // Events from a newer version are skipped
+        events.skip();
+    }
+
+    result.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,449 @@
+#include <particlesystem/scene.h>
+
+#include <particlesystem/random.h>
+#include <particlesystem/snapshot.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <variant>
+
+namespace particlesystem {
+
+namespace {
+
+// The names of the types in the order of DefaultRegistry
+constexpr std::array<std::string_view, 3> emitterTypes = {"uniform", "directional", "spinner"};
+constexpr std::array<std::string_view, 2> effectTypes = {"gravity_well", "wind"};
+static_assert(emitterTypes.size() == DefaultRegistry::Emitters::size);
+static_assert(effectTypes.size() == DefaultRegistry::Effects::size);
+
+enum class Section { None, System, Emitter, Effect };
+
+struct Value {
+    using Data = std::variant<double, std::string, bool, std::vector<double>>;
+    Data data;
+    bool integer = false;  // A number without fraction or exponent
+};
+
+struct Entry {
+    std::string key;
+    Value value;
+    size_t line;
+};
+
+bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && isBlank(s.front())) s.remove_prefix(1);
+    while (!s.empty() && isBlank(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+bool isBareKey(std::string_view key) {
+    return !key.empty() && std::ranges::all_of(key, [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+               c == '_' || c == '-';
+    });
+}
+
+template <size_t N>
+std::string listNames(const std::array<std::string_view, N>& names) {
+    std::string list;
+    for (size_t i = 0; i < N; ++i) {
+        list += fmt::format("{}'{}'", i == 0 ? "" : i + 1 == N ? " or " : ", ", names[i]);
+    }
+    return list;
+}
+
+class Parser {
+public:
+    Parser(std::string_view text, std::string_view file) : text{text}, file{file} {}
+
+    SceneDescription parse() {
+        while (!text.empty()) {
+            const size_t end = text.find('\n');
+            const std::string_view raw = text.substr(0, end);
+            text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+            line++;
+            parseLine(raw);
+        }
+        closeTable();
+        return scene;
+    }
+
+private:
+    [[noreturn]] void fail(size_t at, std::string_view message) const {
+        throw SceneError(file, at, message);
+    }
+
+    void parseLine(std::string_view raw) {
+        const std::string_view content = trim(stripComment(raw));
+        if (content.empty()) return;
+
+        if (content.starts_with("[[")) {
+            if (!content.ends_with("]]")) fail(line, "Expected ']]' at the end of the header");
+            openTable(trim(content.substr(2, content.size() - 4)), true);
+        } else if (content.starts_with('[')) {
+            if (!content.ends_with(']')) fail(line, "Expected ']' at the end of the header");
+            openTable(trim(content.substr(1, content.size() - 2)), false);
+        } else {
+            const size_t equals = content.find('=');
+            if (equals == std::string_view::npos) fail(line, "Expected 'key = value'");
+            const std::string_view key = trim(content.substr(0, equals));
+            if (!isBareKey(key)) fail(line, fmt::format("Invalid key '{}'", key));
+            if (section == Section::None) {
+                fail(line, fmt::format("'{}' is outside of any table", key));
+            }
+            if (std::ranges::find(entries, key, &Entry::key) != entries.end()) {
+                fail(line, fmt::format("Duplicate key '{}'", key));
+            }
+            Value value = parseValue(trim(content.substr(equals + 1)));
+            entries.push_back({std::string{key}, std::move(value), line});
+        }
+    }
+
+    // Removes a comment, unless the '#' is inside a string
+    static std::string_view stripComment(std::string_view raw) {
+        bool inString = false;
+        for (size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] == '"' && (i == 0 || raw[i - 1] != '\\')) inString = !inString;
+            if (raw[i] == '#' && !inString) return raw.substr(0, i);
+        }
+        return raw;
+    }
+
+    Value parseValue(std::string_view s) {
+        if (s.empty()) fail(line, "Missing value");
+        if (s.front() == '"') {
+            if (s.size() < 2 || s.back() != '"') fail(line, "Unterminated string");
+            std::string value;
+            for (size_t i = 1; i + 1 < s.size(); ++i) {
+                if (s[i] == '\\' && i + 2 < s.size()) ++i;
+                value += s[i];
+            }
+            return {value};
+        }
+        if (s == "true" || s == "false") {
+            return {Value::Data{std::in_place_type<bool>, s == "true"}};
+        }
+        if (s.front() == '[') {
+            if (s.back() != ']') fail(line, "Arrays must be closed on the same line");
+            std::vector<double> values;
+            std::string_view rest = trim(s.substr(1, s.size() - 2));
+            while (!rest.empty()) {
+                const size_t comma = rest.find(',');
+                values.push_back(parseNumber(trim(rest.substr(0, comma))).first);
+                if (comma == std::string_view::npos) break;
+                rest = trim(rest.substr(comma + 1));
+            }
+            return {values};
+        }
+        const auto [number, integer] = parseNumber(s);
+        return {number, integer};
+    }
+
+    // Returns the number and whether it is an integer
+    std::pair<double, bool> parseNumber(std::string_view s) const {
+        std::string digits;
+        for (char c : s) {
+            if (c != '_') digits += c;
+        }
+        if (!digits.empty() && digits.front() == '+') digits.erase(0, 1);
+        double number = 0.0;
+        const char* last = digits.data() + digits.size();
+        const auto [end, error] = std::from_chars(digits.data(), last, number);
+        // from_chars also accepts nan and inf, which no setting can take
+        if (digits.empty() || error != std::errc{} || end != last || !std::isfinite(number)) {
+            fail(line, fmt::format("Invalid value '{}'", s));
+        }
+        const bool integer = digits.find_first_of(".eE") == std::string::npos;
+        return {number, integer};
+    }
+
+    void openTable(std::string_view name, bool array) {
+        closeTable();
+        tableLine = line;
+        if (name == "system" && !array) {
+            if (seenSystem) fail(line, "Duplicate table [system]");
+            seenSystem = true;
+            section = Section::System;
+        } else if (name == "emitter" && array) {
+            section = Section::Emitter;
+        } else if (name == "effect" && array) {
+            section = Section::Effect;
+        } else {
+            fail(line, fmt::format("Unknown table '{}', expected [system], [[emitter]] or "
+                                   "[[effect]]",
+                                   name));
+        }
+    }
+
+    // Converts the entries of the table that just ended
+    void closeTable() {
+        switch (section) {
+            case Section::System: bindSystem(); break;
+            case Section::Emitter: bindEmitter(); break;
+            case Section::Effect: bindEffect(); break;
+            case Section::None: break;
+        }
+        entries.clear();
+    }
+
+    double number(const Entry& e) const {
+        if (const double* n = std::get_if<double>(&e.value.data)) return *n;
+        fail(e.line, fmt::format("'{}' must be a number", e.key));
+    }
+
+    float positive(const Entry& e) const {
+        const double n = number(e);
+        if (!(n > 0.0)) fail(e.line, fmt::format("'{}' must be larger than zero", e.key));
+        return static_cast<float>(n);
+    }
+
+    float nonNegative(const Entry& e) const {
+        const double n = number(e);
+        if (!(n >= 0.0)) fail(e.line, fmt::format("'{}' must not be negative", e.key));
+        return static_cast<float>(n);
+    }
+
+    uint64_t integer(const Entry& e, uint64_t min) const {
+        const double n = number(e);
+        if (!e.value.integer || n < static_cast<double>(min) || n >= 0x1p64) {
+            fail(e.line, fmt::format("'{}' must be an integer of at least {}", e.key, min));
+        }
+        return static_cast<uint64_t>(n);
+    }
+
+    const std::string& string(const Entry& e) const {
+        if (const std::string* s = std::get_if<std::string>(&e.value.data)) return *s;
+        fail(e.line, fmt::format("'{}' must be a string", e.key));
+    }
+
+    template <size_t N>
+    std::array<float, N> vector(const Entry& e) const {
+        const auto* values = std::get_if<std::vector<double>>(&e.value.data);
+        if (!values || values->size() != N) {
+            fail(e.line, fmt::format("'{}' must be an array of {} numbers", e.key, N));
+        }
+        std::array<float, N> out;
+        std::ranges::transform(*values, out.begin(),
+                               [](double v) { return static_cast<float>(v); });
+        return out;
+    }
+
+    glm::vec2 vec2(const Entry& e) const {
+        const auto v = vector<2>(e);
+        return {v[0], v[1]};
+    }
+
+    glm::vec4 vec4(const Entry& e) const {
+        const auto v = vector<4>(e);
+        return {v[0], v[1], v[2], v[3]};
+    }
+
+    [[noreturn]] void unknownKey(const Entry& e, std::string_view table) const {
+        fail(e.line, fmt::format("Unknown key '{}' in {}", e.key, table));
+    }
+
+    // Finds the type of an [[emitter]] or [[effect]] by its name
+    template <size_t N>
+    uint32_t typeIndex(const std::array<std::string_view, N>& names, std::string_view table) const {
+        const auto type = std::ranges::find(entries, "type", &Entry::key);
+        if (type == entries.end()) fail(tableLine, fmt::format("{} needs a type", table));
+        const std::string& name = string(*type);
+        const auto it = std::ranges::find(names, name);
+        if (it == names.end()) {
+            fail(type->line, fmt::format("Unknown type '{}', expected {}", name, listNames(names)));
+        }
+        return static_cast<uint32_t>(it - names.begin());
+    }
+
+    void bindSystem() {
+        ParticleSystem::Settings& settings = scene.settings;
+        for (const Entry& e : entries) {
+            if (e.key == "capacity") {
+                settings.capacity = static_cast<size_t>(integer(e, 1));
+            } else if (e.key == "overflow") {
+                const std::string& policy = string(e);
+                if (policy == "drop_newest") {
+                    settings.overflowPolicy = OverflowPolicy::DropNewest;
+                } else if (policy == "recycle_oldest") {
+                    settings.overflowPolicy = OverflowPolicy::RecycleOldest;
+                } else if (policy == "grow") {
+                    settings.overflowPolicy = OverflowPolicy::Grow;
+                } else {
+                    fail(e.line, fmt::format("Unknown overflow policy '{}', expected "
+                                             "'drop_newest', 'recycle_oldest' or 'grow'",
+                                             policy));
+                }
+            } else if (e.key == "max_lifetime") {
+                settings.maxLifetime = positive(e);
+            } else if (e.key == "seed") {
+                scene.seed = integer(e, 0);
+            } else if (e.key == "tick_rate") {
+                settings.tickRate = positive(e);
+            } else if (e.key == "max_substeps") {
+                const uint64_t substeps = integer(e, 1);
+                if (substeps > 1000) fail(e.line, "'max_substeps' must be at most 1000");
+                settings.maxSubsteps = static_cast<int>(substeps);
+            } else if (e.key == "threads") {
+                settings.threadCount = static_cast<size_t>(integer(e, 0));
+            } else if (e.key == "scheduler") {
+                const std::string& mode = string(e);
+                if (mode == "work_stealing") {
+                    settings.schedulerMode = Scheduler::Mode::WorkStealing;
+                } else if (mode == "deterministic") {
+                    settings.schedulerMode = Scheduler::Mode::Deterministic;
+                } else {
+                    fail(e.line, fmt::format("Unknown scheduler '{}', expected 'work_stealing' "
+                                             "or 'deterministic'",
+                                             mode));
+                }
+            } else if (e.key == "backend") {
+                const std::string& name = string(e);
+                if (name == toString(BackendType::Reference)) {
+                    settings.backend = BackendType::Reference;
+                } else if (name == toString(BackendType::Cpu)) {
+                    settings.backend = BackendType::Cpu;
+                } else if (name == toString(BackendType::GLCompute)) {
+                    settings.backend = BackendType::GLCompute;
+                } else {
+                    fail(e.line, fmt::format("Unknown backend '{}', expected 'reference', 'cpu' "
+                                             "or 'gl_compute'",
+                                             name));
+                }
+            } else if (e.key == "integrator") {
+                const std::string& name = string(e);
+                if (name == toString(Integrator::SemiImplicitEuler)) {
+                    settings.integrator = Integrator::SemiImplicitEuler;
+                } else if (name == toString(Integrator::VelocityVerlet)) {
+                    settings.integrator = Integrator::VelocityVerlet;
+                } else if (name == toString(Integrator::RungeKutta4)) {
+                    settings.integrator = Integrator::RungeKutta4;
+                } else {
+                    fail(e.line, fmt::format("Unknown integrator '{}', expected "
+                                             "'semi_implicit_euler', 'velocity_verlet' or 'rk4'",
+                                             name));
+                }
+            } else {
+                unknownKey(e, "[system]");
+            }
+        }
+    }
+
+    void bindEmitter() {
+        EmitterDescription emitter{};
+        emitter.type = typeIndex(emitterTypes, "[[emitter]]");
+        const std::string_view type = emitterTypes[emitter.type];
+        for (const Entry& e : entries) {
+            if (e.key == "type") {
+                continue;
+            } else if (e.key == "position") {
+                emitter.position = vec2(e);
+            } else if (e.key == "color") {
+                emitter.color = vec4(e);
+            } else if (e.key == "radius") {
+                emitter.radius = nonNegative(e);
+            } else if (e.key == "rate") {
+                emitter.rate = nonNegative(e);
+            } else if (e.key == "direction" && type != "uniform") {
+                emitter.direction = static_cast<float>(number(e));
+            } else if (e.key == "width" && type == "directional") {
+                emitter.width = static_cast<float>(number(e));
+            } else if (e.key == "spin_speed" && type == "spinner") {
+                emitter.spinSpeed = static_cast<float>(number(e));
+            } else {
+                unknownKey(e, fmt::format("a {} emitter", type));
+            }
+        }
+        scene.emitters.push_back(emitter);
+    }
+
+    void bindEffect() {
+        EffectDescription effect{};
+        effect.type = typeIndex(effectTypes, "[[effect]]");
+        for (const Entry& e : entries) {
+            if (e.key == "type") {
+                continue;
+            } else if (e.key == "position") {
+                effect.position = vec2(e);
+            } else if (e.key == "color") {
+                effect.color = vec4(e);
+            } else if (e.key == "radius") {
+                effect.radius = nonNegative(e);
+            } else if (e.key == "force") {
+                effect.force = static_cast<float>(number(e));
+            } else if (e.key == "range") {
+                effect.range = positive(e);
+            } else {
+                unknownKey(e, "[[effect]]");
+            }
+        }
+        scene.effects.push_back(effect);
+    }
+
+    std::string_view text;
+    std::string_view file;
+    size_t line = 0;
+
+    SceneDescription scene;
+    Section section = Section::None;
+    size_t tableLine = 0;
+    bool seenSystem = false;
+    // The entries of the current table
+    std::vector<Entry> entries;
+};
+
+}  // namespace
+
+SceneError::SceneError(std::string_view file, size_t line, std::string_view message)
+    : std::runtime_error(fmt::format("{}:{}: {}", file, line, message)), line{line} {}
+
+void SceneDescription::populate(ParticleSystem& system) const {
+    if (seed) setMasterSeed(*seed);
+
+    // Start from the defaults of the type and override what the scene sets
+    for (const EmitterDescription& description : emitters) {
+        const EmitterHandle handle = addEmitterOfType(system, description.type);
+        EmitterRecord record = toRecord(system, handle);
+        if (description.position) record.position = *description.position;
+        if (description.color) record.color = *description.color;
+        if (description.radius) record.radius = *description.radius;
+        if (description.rate) record.rate = *description.rate;
+        if (description.direction) record.direction = *description.direction;
+        if (description.width) record.width = *description.width;
+        if (description.spinSpeed) record.spinSpeed = *description.spinSpeed;
+        applyRecord(system, handle, record, false);
+    }
+
+    for (const EffectDescription& description : effects) {
+        const EffectHandle handle = addEffectOfType(system, description.type);
+        EffectRecord record = toRecord(system, handle);
+        if (description.position) record.position = *description.position;
+        if (description.color) record.color = *description.color;
+        if (description.radius) record.radius = *description.radius;
+        if (description.range) record.influenceRadius = *description.range;
+        if (description.force) record.force = *description.force;
+        applyRecord(system, handle, record);
+    }
+}
+
+SceneDescription parseScene(std::string_view text, std::string_view file) {
+    return Parser{text, file}.parse();
+}
+
+SceneDescription loadScene(const std::string& path) {
+    std::ifstream file{path, std::ios::binary};
+    if (!file) throw std::runtime_error(fmt::format("Unable to open scene '{}'", path));
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return parseScene(contents.str(), path);
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,158 @@
+#include <particlesystem/scheduler.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace particlesystem {
+
+namespace {
+
+constexpr uint64_t pack(uint32_t begin, uint32_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | end;
+}
+constexpr uint32_t rangeBegin(uint64_t range) { return static_cast<uint32_t>(range >> 32); }
+constexpr uint32_t rangeEnd(uint64_t range) { return static_cast<uint32_t>(range); }
+
+}  // namespace
+
+void Scheduler::Deque::assign(uint32_t begin, uint32_t end) {
+    range.store(pack(begin, end), std::memory_order_relaxed);
+}
+
+bool Scheduler::Deque::popFront(uint32_t& chunk) {
+    uint64_t current = range.load(std::memory_order_relaxed);
+    while (rangeBegin(current) < rangeEnd(current)) {
+        if (range.compare_exchange_weak(current, pack(rangeBegin(current) + 1, rangeEnd(current)),
+                                        std::memory_order_relaxed)) {
+            chunk = rangeBegin(current);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Scheduler::Deque::popBack(uint32_t& chunk) {
+    uint64_t current = range.load(std::memory_order_relaxed);
+    while (rangeBegin(current) < rangeEnd(current)) {
+        if (range.compare_exchange_weak(current, pack(rangeBegin(current), rangeEnd(current) - 1),
+                                        std::memory_order_relaxed)) {
+            chunk = rangeEnd(current) - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+Scheduler::Scheduler(size_t threadCount, Mode mode)
+    : threadCount{threadCount != 0 ? threadCount
+                                   : std::max<size_t>(1, std::thread::hardware_concurrency())}
+    , mode{mode}
+    , workers{std::make_unique<Deque[]>(this->threadCount)} {
+    // The calling thread acts as worker 0
+    threads.reserve(this->threadCount - 1);
+    for (size_t i = 1; i < this->threadCount; ++i) {
+        threads.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+size_t Scheduler::chunkSize(size_t count) const {
+    size_t size = DeterministicChunkSize;
+    if (mode == Mode::WorkStealing) {
+        // Aim for a few chunks per thread so that there is something left to steal, but keep
+        // them large enough that the scheduling overhead stays small
+        constexpr size_t chunksPerThread = 8;
+        constexpr size_t minChunkSize = 1024;
+        size = std::max(minChunkSize, count / (threadCount * chunksPerThread));
+    }
+    // The chunk index has to fit in 32 bits
+    size = std::max(size, count / std::numeric_limits<uint32_t>::max() + 1);
+    return (size + ChunkAlignment - 1) / ChunkAlignment * ChunkAlignment;
+}
+
+void Scheduler::run(size_t count, ChunkFunction fn, void* ctx) {
+    if (count == 0) return;
+
+    const size_t size = chunkSize(count);
+    const size_t chunks = (count + size - 1) / size;
+
+    if (threadCount == 1 || chunks == 1) {
+        // Not worth waking up the workers, but keep the chunk boundaries the same
+        for (size_t begin = 0; begin < count; begin += size) {
+            fn(ctx, begin, std::min(begin + size, count));
+        }
+        return;
+    }
+
+    // Give every thread a contiguous block of chunks
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers[i].assign(static_cast<uint32_t>(i * chunks / threadCount),
+                          static_cast<uint32_t>((i + 1) * chunks / threadCount));
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        jobFunction = fn;
+        jobContext = ctx;
+        jobCount = count;
+        jobChunkSize = size;
+        busyWorkers = threadCount - 1;
+        ++generation;
+    }
+    wake.notify_all();
+
+    runChunks(0);
+
+    // Wait until every worker has stopped touching the job before it goes out of scope
+    std::unique_lock lock(mutex);
+    done.wait(lock, [this]() { return busyWorkers == 0; });
+}
+
+void Scheduler::runChunks(size_t self) {
+    uint32_t chunk = 0;
+    while (true) {
+        bool found = workers[self].popFront(chunk);
+        for (size_t i = 1; i < threadCount && !found; ++i) {
+            found = workers[(self + i) % threadCount].popBack(chunk);
+        }
+        if (!found) return;
+
+        const size_t begin = chunk * jobChunkSize;
+        jobFunction(jobContext, begin, std::min(begin + jobChunkSize, jobCount));
+    }
+}
+
+void Scheduler::workerLoop(size_t self) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        runChunks(self);
+
+        bool last = false;
+        {
+            std::lock_guard lock(mutex);
+            last = --busyWorkers == 0;
+        }
+        if (last) {
+            done.notify_one();
+        }
+    }
+}
+
+}  // namespace particlesystem
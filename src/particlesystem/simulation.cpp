@@ -0,0 +1,142 @@
+#include <particlesystem/simulation.h>
+#include <particlesystem/kernels.h>
+#include <particlesystem/particlesystem.h>
+
+#include <algorithm>
+
+namespace particlesystem {
+
+void applyEffects(std::span<Effect* const> effects, ParticleStore& particles,
+                  Scheduler& scheduler) {
+    std::span<const glm::vec2> position = particles.getPosition();
+    std::span<glm::vec2> force = particles.getForce();
+    scheduler.parallelFor(particles.size(), [&](size_t begin, size_t end) {
+        std::ranges::fill(force.subspan(begin, end - begin), glm::vec2{0.0f, 0.0f});
+        for (Effect* effect : effects) {
+            effect->effectParticle(position.subspan(begin, end - begin),
+                                   force.subspan(begin, end - begin));
+        }
+    });
+}
+
+namespace {
+
+void evaluateForces(const EffectTable& effects, std::span<const glm::vec2> positions,
+                    std::span<glm::vec2> forces, Scheduler& scheduler, const SpatialGrid* grid) {
+    scheduler.parallelFor(positions.size(), [&](size_t begin, size_t end) {
+        const std::span<glm::vec2> chunk = forces.subspan(begin, end - begin);
+        std::ranges::fill(chunk, glm::vec2{0.0f, 0.0f});
+        effects.apply(positions.subspan(begin, end - begin), chunk);
+        if (!grid) effects.applyLocal(positions.subspan(begin, end - begin), chunk, nullptr);
+    });
+    if (!grid || !effects.hasLocal()) return;
+    // A grid query may return any particle, so the effects with a finite range are applied in a
+    // second pass where every task owns the particles of a range of grid buckets
+    scheduler.parallelFor(grid->getBucketCount(), [&](size_t begin, size_t end) {
+        effects.applyLocal(positions, forces, *grid, static_cast<uint32_t>(begin),
+                           static_cast<uint32_t>(end));
+    });
+}
+
+}  // namespace
+
+void applyEffects(const EffectTable& effects, ParticleStore& particles, Scheduler& scheduler) {
+    evaluateForces(effects, particles.getPosition(), particles.getForce(), scheduler, nullptr);
+}
+
+void applyEffects(const EffectTable& effects, ParticleStore& particles, Scheduler& scheduler,
+                  SpatialGrid& grid) {
+    evaluateForces(effects, particles.getPosition(), particles.getForce(), scheduler, grid);
+}
+
+void evaluateForces(const EffectTable& effects, std::span<const glm::vec2> positions,
+                    std::span<glm::vec2> forces, Scheduler& scheduler, SpatialGrid& grid) {
+    if (effects.hasLocal()) {
+        grid.build(positions);
+    }
+    evaluateForces(effects, positions, forces, scheduler, &grid);
+}
+
+void integrate(ParticleStore& particles, double dt, Scheduler& scheduler) {
+    scheduler.parallelFor(particles.size(), [&](size_t begin, size_t end) {
+        particles.updatePosition(dt, begin, end);
+    });
+}
+
+const char* toString(Integrator integrator) {
+    switch (integrator) {
+        case Integrator::SemiImplicitEuler:
+            return "semi_implicit_euler";
+        case Integrator::VelocityVerlet:
+            return "velocity_verlet";
+        case Integrator::RungeKutta4:
+            return "rk4";
+    }
+    return "unknown";
+}
+
+void integrate(ParticleStore& particles, double dt, Integrator integrator,
+               const ForceField& forces, IntegratorBuffers& buffers, Scheduler& scheduler) {
+    const auto h = static_cast<float>(dt);
+    const size_t size = particles.size();
+    std::span<glm::vec2> x = particles.getPosition();
+    std::span<glm::vec2> v = particles.getVelocity();
+    std::span<const glm::vec2> a = particles.getAcceleration();
+    std::span<glm::vec2> f = particles.getForce();
+    // Runs a kernel on every chunk, the kernels take the first particle and the particle count
+    auto parallel = [&](auto&& kernel) {
+        scheduler.parallelFor(size, [&](size_t begin, size_t end) { kernel(begin, end - begin); });
+    };
+
+    switch (integrator) {
+        case Integrator::SemiImplicitEuler:
+            parallel([&](size_t i, size_t n) {
+                kickDrift(x.subspan(i, n), v.subspan(i, n), a.subspan(i, n), f.subspan(i, n), h, h);
+            });
+            return;
+        case Integrator::VelocityVerlet:
+            // Half a kick with the current forces, a drift and half a kick with the new forces
+            parallel([&](size_t i, size_t n) {
+                kickDrift(x.subspan(i, n), v.subspan(i, n), a.subspan(i, n), f.subspan(i, n),
+                          0.5f * h, h);
+            });
+            forces(x, f);
+            parallel([&](size_t i, size_t n) {
+                kick(v.subspan(i, n), a.subspan(i, n), f.subspan(i, n), 0.5f * h);
+            });
+            return;
+        case Integrator::RungeKutta4: {
+            buffers.position.resize(size);
+            buffers.velocity.resize(size);
+            buffers.positionChange.resize(size);
+            buffers.velocityChange.resize(size);
+            std::span<glm::vec2> xs = buffers.position;
+            std::span<glm::vec2> vs = buffers.velocity;
+            std::span<glm::vec2> dx = buffers.positionChange;
+            std::span<glm::vec2> dv = buffers.velocityChange;
+
+            // The stages are weighted 1/6, 1/3, 1/3 and 1/6 and evaluated at 0, h/2, h/2 and h
+            parallel([&](size_t i, size_t n) {
+                rungeKuttaBegin(x.subspan(i, n), v.subspan(i, n), a.subspan(i, n),
+                                f.subspan(i, n), xs.subspan(i, n), vs.subspan(i, n),
+                                dx.subspan(i, n), dv.subspan(i, n), h / 6.0f, 0.5f * h);
+            });
+            for (const float step : {0.5f * h, h}) {
+                forces(xs, f);
+                parallel([&](size_t i, size_t n) {
+                    rungeKuttaStage(x.subspan(i, n), v.subspan(i, n), a.subspan(i, n),
+                                    f.subspan(i, n), xs.subspan(i, n), vs.subspan(i, n),
+                                    dx.subspan(i, n), dv.subspan(i, n), h / 3.0f, step);
+                });
+            }
+            forces(xs, f);
+            parallel([&](size_t i, size_t n) {
+                rungeKuttaEnd(x.subspan(i, n), v.subspan(i, n), a.subspan(i, n), f.subspan(i, n),
+                              vs.subspan(i, n), dx.subspan(i, n), dv.subspan(i, n), h / 6.0f);
+            });
+            return;
+        }
+    }
+}
+
+}  // namespace particlesystem
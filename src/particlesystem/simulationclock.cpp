@@ -0,0 +1,52 @@
+#include <particlesystem/simulationclock.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace particlesystem {
+
+SimulationClock::SimulationClock(double tickRate, int maxSubsteps)
+    : timestep{1.0 / DefaultTickRate}, maxSubsteps{1} {
+    setTickRate(tickRate);
+    setMaxSubsteps(maxSubsteps);
+}
+
+int SimulationClock::advance(double elapsed) {
+    if (elapsed > 0.0) {
+        accumulator += elapsed;
+    }
+
+    // Anything beyond the last allowed step is dropped, leaving the fraction of a step that would
+    // have been left over anyway so that the interpolation stays smooth
+    const double steps = std::floor(accumulator / timestep);
+    if (steps > static_cast<double>(maxSubsteps)) {
+        const double dropped = (steps - static_cast<double>(maxSubsteps)) * timestep;
+        accumulator -= dropped;
+        droppedTime += dropped;
+    }
+
+    const int count = std::min(static_cast<int>(std::floor(accumulator / timestep)), maxSubsteps);
+    accumulator = std::max(accumulator - count * timestep, 0.0);
+    tickCount += static_cast<uint64_t>(count);
+    return count;
+}
+
+float SimulationClock::getAlpha() const {
+    return std::clamp(static_cast<float>(accumulator / timestep), 0.0f, 1.0f);
+}
+
+void SimulationClock::setTickRate(double tickRate) {
+    if (tickRate > 0.0 && std::isfinite(tickRate)) {
+        timestep = 1.0 / tickRate;
+    }
+}
+
+void SimulationClock::setMaxSubsteps(int substeps) { maxSubsteps = std::max(substeps, 1); }
+
+void SimulationClock::reset() {
+    accumulator = 0.0;
+    droppedTime = 0.0;
+    tickCount = 0;
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,546 @@
+#include <particlesystem/snapshot.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace particlesystem {
+
+namespace {
+
+constexpr char Magic[8] = {'P', 'S', 'Y', 'S', 'S', 'N', 'A', 'P'};
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + SnapshotAlignment - 1) / SnapshotAlignment * SnapshotAlignment;
+}
+
+std::string chunkName(uint32_t id) {
+    std::string name(4, ' ');
+    for (size_t i = 0; i < 4; ++i) {
+        name[i] = static_cast<char>((id >> (8 * i)) & 0xff);
+    }
+    return name;
+}
+
+// Adds an object of the type with the given index in the registry
+template <typename... T>
+EmitterHandle addEmitterOfType(ParticleSystem& system, uint32_t type, TypeList<T...>) {
+    EmitterHandle handle;
+    uint32_t index = 0;
+    const bool added = ((index++ == type && (handle = system.addEmitter<T>(), true)) || ...);
+    if (!added) throw std::runtime_error(fmt::format("Unknown emitter type {}", type));
+    return handle;
+}
+
+template <typename... T>
+EffectHandle addEffectOfType(ParticleSystem& system, uint32_t type, TypeList<T...>) {
+    EffectHandle handle;
+    uint32_t index = 0;
+    const bool added = ((index++ == type && (handle = system.addEffect<T>(), true)) || ...);
+    if (!added) throw std::runtime_error(fmt::format("Unknown effect type {}", type));
+    return handle;
+}
+
+template <typename T>
+void copyAttribute(std::span<const T> from, std::span<T> to) {
+    std::memcpy(to.data(), from.data(), to.size_bytes());
+}
+
+// The particle attributes of a snapshot, all of the same length
+struct ParticleChunks {
+    std::span<const glm::vec2> position;
+    std::span<const glm::vec2> previousPosition;
+    std::span<const glm::vec2> velocity;
+    std::span<const glm::vec2> acceleration;
+    std::span<const float> lifetime;
+    std::span<const float> radius;
+    std::span<const glm::vec4> color;
+};
+
+// \throw std::runtime_error if a chunk is missing or the chunks differ in length
+ParticleChunks getParticleChunks(const Snapshot& snapshot) {
+    ParticleChunks attributes{};
+    attributes.position = snapshot.get<glm::vec2>(chunks::Position);
+    attributes.previousPosition = snapshot.get<glm::vec2>(chunks::PreviousPosition);
+    attributes.velocity = snapshot.get<glm::vec2>(chunks::Velocity);
+    attributes.acceleration = snapshot.get<glm::vec2>(chunks::Acceleration);
+    attributes.lifetime = snapshot.get<float>(chunks::Lifetime);
+    attributes.radius = snapshot.get<float>(chunks::Radius);
+    attributes.color = snapshot.get<glm::vec4>(chunks::Color);
+
+    const size_t count = attributes.position.size();
+    for (size_t size :
+         {attributes.previousPosition.size(), attributes.velocity.size(),
+          attributes.acceleration.size(), attributes.lifetime.size(), attributes.radius.size(),
+          attributes.color.size()}) {
+        if (size != count) {
+            throw std::runtime_error("The particle attributes in the snapshot differ in length");
+        }
+    }
+    return attributes;
+}
+
+// Copies from[indices[i]] to to[i]
+template <typename T>
+void gatherAttribute(std::span<const T> from, std::span<const size_t> indices, std::span<T> to) {
+    for (size_t i = 0; i < indices.size(); ++i) to[i] = from[indices[i]];
+}
+
+// Replaces the particles in the pool, returns the number of particles that fit
+size_t copyParticles(const ParticleChunks& attributes, ParticlePool& pool) {
+    pool.clear();
+    const size_t count = attributes.position.size();
+    const size_t first = pool.acquire(count);
+    const size_t added = pool.size() - first;
+    ParticleStore& store = pool.particles();
+    if (added < count && pool.getPolicy() == OverflowPolicy::RecycleOldest) {
+        // Keep the youngest particles, in the order of the snapshot, like recycling would
+        std::vector<size_t> kept(count);
+        std::iota(kept.begin(), kept.end(), size_t{0});
+        const auto lifetime = attributes.lifetime;
+        std::nth_element(kept.begin(), kept.begin() + static_cast<std::ptrdiff_t>(added),
+                         kept.end(), [&](size_t a, size_t b) { return lifetime[a] < lifetime[b]; });
+        kept.resize(added);
+        std::ranges::sort(kept);
+        gatherAttribute(attributes.position, kept, store.getPosition().subspan(first));
+        gatherAttribute(attributes.previousPosition, kept,
+                        store.getPreviousPosition().subspan(first));
+        gatherAttribute(attributes.velocity, kept, store.getVelocity().subspan(first));
+        gatherAttribute(attributes.acceleration, kept, store.getAcceleration().subspan(first));
+        gatherAttribute(attributes.lifetime, kept, store.getLifetime().subspan(first));
+        gatherAttribute(attributes.radius, kept, store.getRadius().subspan(first));
+        gatherAttribute(attributes.color, kept, store.getColor().subspan(first));
+        return added;
+    }
+    copyAttribute(attributes.position, store.getPosition().subspan(first));
+    copyAttribute(attributes.previousPosition, store.getPreviousPosition().subspan(first));
+    copyAttribute(attributes.velocity, store.getVelocity().subspan(first));
+    copyAttribute(attributes.acceleration, store.getAcceleration().subspan(first));
+    copyAttribute(attributes.lifetime, store.getLifetime().subspan(first));
+    copyAttribute(attributes.radius, store.getRadius().subspan(first));
+    copyAttribute(attributes.color, store.getColor().subspan(first));
+    return added;
+}
+
+}  // namespace
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        throw std::runtime_error(fmt::format("Unable to open '{}'", path));
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        throw std::runtime_error(fmt::format("Unable to map '{}'", path));
+    }
+    size = static_cast<size_t>(fileSize.QuadPart);
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) {
+        bytes = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!bytes) {
+        close();
+        throw std::runtime_error(fmt::format("Unable to map '{}'", path));
+    }
+}
+
+void MappedFile::close() {
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    bytes = nullptr;
+    size = 0;
+    mapping = nullptr;
+    file = nullptr;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : bytes{std::exchange(other.bytes, nullptr)}
+    , size{std::exchange(other.size, 0)}
+    , file{std::exchange(other.file, nullptr)}
+    , mapping{std::exchange(other.mapping, nullptr)} {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        bytes = std::exchange(other.bytes, nullptr);
+        size = std::exchange(other.size, 0);
+        file = std::exchange(other.file, nullptr);
+        mapping = std::exchange(other.mapping, nullptr);
+    }
+    return *this;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error(fmt::format("Unable to open '{}'", path));
+
+    struct stat info {};
+    void* address = MAP_FAILED;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+        size = static_cast<size_t>(info.st_size);
+        address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // Snapshots are read front to back, so ask for the whole file to be read ahead
+    if (address != MAP_FAILED) ::madvise(address, size, MADV_WILLNEED);
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        size = 0;
+        throw std::runtime_error(fmt::format("Unable to map '{}'", path));
+    }
+    bytes = static_cast<const std::byte*>(address);
+}
+
+void MappedFile::close() {
+    if (bytes) ::munmap(const_cast<std::byte*>(bytes), size);
+    bytes = nullptr;
+    size = 0;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : bytes{std::exchange(other.bytes, nullptr)}, size{std::exchange(other.size, 0)} {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        bytes = std::exchange(other.bytes, nullptr);
+        size = std::exchange(other.size, 0);
+    }
+    return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+SnapshotWriter::SnapshotWriter(const std::string& path)
+    : path{path}, file{path, std::ios::binary | std::ios::trunc} {
+    // The header is written by finish() once the table offset is known
+    const std::array<char, sizeof(SnapshotHeader)> placeholder{};
+    file.write(placeholder.data(), placeholder.size());
+    if (!file) throw std::runtime_error(fmt::format("Unable to create snapshot '{}'", path));
+    offset = placeholder.size();
+}
+
+void SnapshotWriter::writeChunk(uint32_t id, uint32_t elementSize, uint64_t count,
+                                std::span<const std::byte> data) {
+    if (!file.is_open()) {
+        throw std::runtime_error(fmt::format("Snapshot '{}' is already finished", path));
+    }
+    if (data.size() != elementSize * count) {
+        throw std::runtime_error(fmt::format("Chunk '{}' has {} bytes, expected {}", chunkName(id),
+                                             data.size(), elementSize * count));
+    }
+    table.push_back({id, elementSize, count, offset, data.size()});
+    file.write(reinterpret_cast<const char*>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    offset += data.size();
+    pad();
+    if (!file) throw std::runtime_error(fmt::format("Unable to write snapshot '{}'", path));
+}
+
+void SnapshotWriter::pad() {
+    const std::array<char, SnapshotAlignment> zeros{};
+    const uint64_t padding = alignUp(offset) - offset;
+    file.write(zeros.data(), static_cast<std::streamsize>(padding));
+    offset += padding;
+}
+
+void SnapshotWriter::finish() {
+    if (!file.is_open()) {
+        throw std::runtime_error(fmt::format("Snapshot '{}' is already finished", path));
+    }
+    const std::span<const std::byte> entries = std::as_bytes(std::span{table});
+    file.write(reinterpret_cast<const char*>(entries.data()),
+               static_cast<std::streamsize>(entries.size()));
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = SnapshotVersion;
+    header.chunkCount = static_cast<uint32_t>(table.size());
+    header.tableOffset = offset;
+    header.fileSize = offset + entries.size();
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    if (!file) throw std::runtime_error(fmt::format("Unable to write snapshot '{}'", path));
+}
+
+Snapshot::Snapshot(const std::string& path) : file{path} {
+    const std::span<const std::byte> data = file.data();
+    auto invalid = [&](std::string_view reason) {
+        return std::runtime_error(fmt::format("Invalid snapshot '{}': {}", path, reason));
+    };
+
+    if (data.size() < sizeof(SnapshotHeader)) throw invalid("too small");
+    const SnapshotHeader& h = header();
+    if (std::memcmp(h.magic, Magic, sizeof(Magic)) != 0) throw invalid("not a snapshot");
+    if (h.version != SnapshotVersion) {
+        throw invalid(fmt::format("version {} is not supported", h.version));
+    }
+    if (h.fileSize != data.size()) throw invalid("truncated");
+    if (h.tableOffset % alignof(SnapshotChunk) != 0 || h.tableOffset > data.size() ||
+        (data.size() - h.tableOffset) / sizeof(SnapshotChunk) < h.chunkCount) {
+        throw invalid("bad chunk table");
+    }
+
+    table = {reinterpret_cast<const SnapshotChunk*>(data.data() + h.tableOffset), h.chunkCount};
+    for (const SnapshotChunk& chunk : table) {
+        const bool inside = chunk.offset >= sizeof(SnapshotHeader) &&
+                            chunk.offset <= h.tableOffset &&
+                            chunk.size <= h.tableOffset - chunk.offset;
+        const bool consistent =
+            chunk.elementSize > 0 && chunk.size / chunk.elementSize == chunk.count &&
+            chunk.size % chunk.elementSize == 0;
+        if (!inside || !consistent || chunk.offset % SnapshotAlignment != 0) {
+            throw invalid(fmt::format("bad chunk '{}'", chunkName(chunk.id)));
+        }
+    }
+}
+
+const SnapshotChunk* Snapshot::find(uint32_t id) const {
+    const auto it = std::ranges::find(table, id, &SnapshotChunk::id);
+    return it == table.end() ? nullptr : &*it;
+}
+
+const SnapshotChunk& Snapshot::require(uint32_t id, size_t elementSize) const {
+    const SnapshotChunk* chunk = find(id);
+    if (!chunk) {
+        throw std::runtime_error(fmt::format("Snapshot has no chunk '{}'", chunkName(id)));
+    }
+    if (chunk->elementSize != elementSize) {
+        throw std::runtime_error(fmt::format("Chunk '{}' has elements of {} bytes, expected {}",
+                                             chunkName(id), chunk->elementSize, elementSize));
+    }
+    return *chunk;
+}
+
+SystemRecord toRecord(const ParticleSystem& system) {
+    const SimulationClock& clock = system.getClock();
+    SystemRecord record{};
+    record.tickRate = clock.getTickRate();
+    record.maxSubsteps = clock.getMaxSubsteps();
+    record.maxLifetime = system.getMaxLifetime();
+    record.integrator = static_cast<uint32_t>(system.getIntegrator());
+    return record;
+}
+
+void applyRecord(ParticleSystem& system, const SystemRecord& record) {
+    if (record.integrator > static_cast<uint32_t>(Integrator::RungeKutta4)) {
+        throw std::runtime_error(fmt::format("Unknown integrator {}", record.integrator));
+    }
+    SimulationClock& clock = system.getClock();
+    clock.setTickRate(record.tickRate);
+    clock.setMaxSubsteps(record.maxSubsteps);
+    system.setMaxLifetime(record.maxLifetime);
+    system.setIntegrator(static_cast<Integrator>(record.integrator));
+}
+
+EmitterRecord toRecord(const ParticleSystem& system, EmitterHandle handle) {
+    EmitterRecord record{};
+    record.type = static_cast<uint32_t>(handle.index());
+    std::visit(
+        [&]<typename T>(Handle<T> h) {
+            const T& emitter = *system.get(h);
+            record.radius = emitter.radius;
+            record.position = emitter.position;
+            record.color = emitter.color;
+            record.rate = emitter.rate;
+            record.pending = emitter.getPending();
+            if constexpr (requires { emitter.direction; }) record.direction = emitter.direction;
+            if constexpr (requires { emitter.width; }) record.width = emitter.width;
+            if constexpr (requires { emitter.spinSpeed; }) record.spinSpeed = emitter.spinSpeed;
+            record.randomSeed = emitter.random.getSeed();
+            record.randomStream = emitter.random.getStream();
+            record.randomPosition = emitter.random.getPosition();
+        },
+        handle);
+    return record;
+}
+
+EffectRecord toRecord(const ParticleSystem& system, EffectHandle handle) {
+    EffectRecord record{};
+    record.type = static_cast<uint32_t>(handle.index());
+    std::visit(
+        [&]<typename T>(Handle<T> h) {
+            const T& effect = *system.get(h);
+            record.radius = effect.radius;
+            record.position = effect.position;
+            record.color = effect.color;
+            record.influenceRadius = effect.influenceRadius;
+            if constexpr (requires { effect.force; }) record.force = effect.force;
+        },
+        handle);
+    return record;
+}
+
+void applyRecord(ParticleSystem& system, EmitterHandle handle, const EmitterRecord& record,
+                 bool restoreState) {
+    if (record.type != handle.index()) {
+        throw std::runtime_error(fmt::format("Emitter record of type {} does not match type {}",
+                                             record.type, handle.index()));
+    }
+    std::visit(
+        [&]<typename T>(Handle<T> h) {
+            T& emitter = *system.get(h);
+            emitter.radius = record.radius;
+            emitter.position = record.position;
+            emitter.color = record.color;
+            emitter.rate = record.rate;
+            if constexpr (requires { emitter.direction; }) emitter.direction = record.direction;
+            if constexpr (requires { emitter.width; }) emitter.width = record.width;
+            if constexpr (requires { emitter.spinSpeed; }) emitter.spinSpeed = record.spinSpeed;
+            if (restoreState) {
+                emitter.setPending(record.pending);
+                emitter.random = RandomStream(record.randomSeed, record.randomStream);
+                emitter.random.seek(record.randomPosition);
+            }
+        },
+        handle);
+}
+
+void applyRecord(ParticleSystem& system, EffectHandle handle, const EffectRecord& record) {
+    if (record.type != handle.index()) {
+        throw std::runtime_error(fmt::format("Effect record of type {} does not match type {}",
+                                             record.type, handle.index()));
+    }
+    std::visit(
+        [&]<typename T>(Handle<T> h) {
+            T& effect = *system.get(h);
+            effect.radius = record.radius;
+            effect.position = record.position;
+            effect.color = record.color;
+            effect.influenceRadius = record.influenceRadius;
+            if constexpr (requires { effect.force; }) effect.force = record.force;
+        },
+        handle);
+}
+
+EmitterHandle addFromRecord(ParticleSystem& system, const EmitterRecord& record) {
+    const EmitterHandle handle = addEmitterOfType(system, record.type);
+    applyRecord(system, handle, record);
+    return handle;
+}
+
+EffectHandle addFromRecord(ParticleSystem& system, const EffectRecord& record) {
+    const EffectHandle handle = addEffectOfType(system, record.type);
+    applyRecord(system, handle, record);
+    return handle;
+}
+
+EmitterHandle addEmitterOfType(ParticleSystem& system, uint32_t type) {
+    return addEmitterOfType(system, type, ParticleSystem::Emitters{});
+}
+
+EffectHandle addEffectOfType(ParticleSystem& system, uint32_t type) {
+    return addEffectOfType(system, type, ParticleSystem::Effects{});
+}
+
+void writeParticles(SnapshotWriter& writer, const ParticleStore& particles) {
+    writer.write(chunks::Position, particles.getPosition());
+    writer.write(chunks::PreviousPosition, particles.getPreviousPosition());
+    writer.write(chunks::Velocity, particles.getVelocity());
+    writer.write(chunks::Acceleration, particles.getAcceleration());
+    writer.write(chunks::Lifetime, particles.getLifetime());
+    writer.write(chunks::Radius, particles.getRadius());
+    writer.write(chunks::Color, particles.getColor());
+}
+
+size_t readParticles(const Snapshot& snapshot, ParticlePool& pool) {
+    return copyParticles(getParticleChunks(snapshot), pool);
+}
+
+void saveSnapshot(const ParticleSystem& system, const std::string& path) {
+    SnapshotWriter writer{path};
+
+    const SystemRecord settings = toRecord(system);
+    writer.write(chunks::System, std::span{&settings, 1});
+
+    std::vector<EmitterRecord> emitters;
+    for (EmitterHandle handle : system.getEmitters()) {
+        emitters.push_back(toRecord(system, handle));
+    }
+    writer.write(chunks::Emitters, std::span<const EmitterRecord>{emitters});
+
+    std::vector<EffectRecord> effects;
+    for (EffectHandle handle : system.getEffects()) {
+        effects.push_back(toRecord(system, handle));
+    }
+    writer.write(chunks::Effects, std::span<const EffectRecord>{effects});
+
+    writeParticles(writer, system.particles());
+    writer.finish();
+}
+
+void loadSnapshot(ParticleSystem& system, const Snapshot& snapshot) {
+    const std::span<const SystemRecord> settings = snapshot.get<SystemRecord>(chunks::System);
+    if (settings.size() != 1) throw std::runtime_error("The snapshot has no system settings");
+    const auto emitters = snapshot.get<EmitterRecord>(chunks::Emitters);
+    const auto effects = snapshot.get<EffectRecord>(chunks::Effects);
+    const ParticleChunks particles = getParticleChunks(snapshot);
+
+    // Validate everything before the system is changed, so that a bad snapshot leaves it intact
+    if (settings[0].integrator > static_cast<uint32_t>(Integrator::RungeKutta4)) {
+        throw std::runtime_error(fmt::format("Unknown integrator {}", settings[0].integrator));
+    }
+    for (const EmitterRecord& record : emitters) {
+        if (record.type >= ParticleSystem::Emitters::size) {
+            throw std::runtime_error(fmt::format("Unknown emitter type {}", record.type));
+        }
+    }
+    for (const EffectRecord& record : effects) {
+        if (record.type >= ParticleSystem::Effects::size) {
+            throw std::runtime_error(fmt::format("Unknown effect type {}", record.type));
+        }
+    }
+
+    applyRecord(system, settings[0]);
+    system.getClock().reset();
+
+    const std::vector<EmitterHandle> oldEmitters(system.getEmitters().begin(),
+                                                 system.getEmitters().end());
+    for (EmitterHandle handle : oldEmitters) system.remove(handle);
+    const std::vector<EffectHandle> oldEffects(system.getEffects().begin(),
+                                               system.getEffects().end());
+    for (EffectHandle handle : oldEffects) system.remove(handle);
+
+    for (const EmitterRecord& record : emitters) addFromRecord(system, record);
+    for (const EffectRecord& record : effects) addFromRecord(system, record);
+
+    copyParticles(particles, system.getPool());
+}
+
+void loadSnapshot(ParticleSystem& system, const std::string& path) {
+    loadSnapshot(system, Snapshot{path});
+}
+
+}  // namespace particlesystem
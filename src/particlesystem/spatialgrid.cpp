@@ -0,0 +1,50 @@
+#include <particlesystem/spatialgrid.h>
+
+#include <algorithm>
+#include <bit>
+
+namespace particlesystem {
+
+SpatialGrid::SpatialGrid(float cellSize)
+    : cellSize{cellSize}, invCellSize{1.0f / cellSize}, bucketMask{0} {}
+
+void SpatialGrid::setCellSize(float size) {
+    cellSize = size;
+    invCellSize = 1.0f / size;
+}
+
+void SpatialGrid::build(std::span<const glm::vec2> positions) {
+    const auto count = static_cast<uint32_t>(positions.size());
+
+    // Twice as many buckets as particles keeps the number of collisions low
+    constexpr uint32_t minBuckets = 1024;
+    const uint32_t buckets = std::bit_ceil(std::max(minBuckets, 2 * count));
+    bucketMask = buckets - 1;
+    bucketStart.assign(buckets + 1, 0);
+    sortedIndices.resize(count);
+    particleBucket.resize(count);
+
+    // Counting sort: count the particles per bucket, turn the counts into the end of every
+    // bucket and then fill the buckets from the back
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t bucket = bucketOf(cellOf(positions[i]));
+        particleBucket[i] = bucket;
+        bucketStart[bucket]++;
+    }
+    uint32_t sum = 0;
+    for (uint32_t b = 0; b < buckets; ++b) {
+        sum += bucketStart[b];
+        bucketStart[b] = sum;
+    }
+    bucketStart[buckets] = count;
+    for (uint32_t i = count; i-- > 0;) {
+        sortedIndices[--bucketStart[particleBucket[i]]] = i;
+    }
+}
+
+void SpatialGrid::query(std::span<const glm::vec2> positions, glm::vec2 center, float radius,
+                        std::vector<uint32_t>& result) const {
+    forEachNeighbour(positions, center, radius, [&](uint32_t index) { result.push_back(index); });
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,7 @@
+#include <particlesystem/system.h>
+
+namespace particlesystem {
+
+template class BasicParticleSystem<DefaultRegistry>;
+
+}  // namespace particlesystem
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <rendering/window.h>
+#include <rendering/pointbatcher.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace rendering {
+
+// How the colors passed to WindowBackend::drawAttributes are stored
+enum class ColorFormat { Float, PackedRGBA8 };
+
+/**
+ * The part of a Window that depends on where the frames end up. Window records the points and
+ * keeps the statistics, the backend draws them and provides the user interface. The user
+ * interface functions do nothing by default, for backends that have no user interface.
+ */
+class WindowBackend {
+public:
+    virtual ~WindowBackend() = default;
+
+    virtual void setTitle(std::string_view title) = 0;
+    virtual double time() const = 0;
+    virtual bool shouldClose() const = 0;
+    virtual glm::vec2 size() const = 0;
+
+    virtual void beginFrame() = 0;
+    // Called after all points of the frame have been submitted
+    virtual void endFrame() = 0;
+    virtual void clear(glm::vec4 color) = 0;
+
+    // Draws and clears the recorded points, adds the draw calls and uploaded bytes to 'stats'
+    virtual void submit(PointBatcher& batcher, DrawStats& stats) = 0;
+
+    // Draws points from separate attribute arrays, see Window::drawPoints
+    virtual void drawAttributes(std::span<const glm::vec2> pos, std::span<const float> radius,
+                                const void* color, ColorFormat colorFormat,
+                                ChangedAttributes changed, DrawStats& stats) = 0;
+
+    // Returns the current frame including the submitted points
+    virtual Image readPixels() = 0;
+
+    virtual void beginGuiWindow(std::string_view) {}
+    virtual void endGuiWindow() {}
+    virtual void text(std::string_view) {}
+    virtual void text(std::string_view, glm::vec4) {}
+    virtual bool sliderFloat(std::string_view, float&, float, float) { return false; }
+    virtual bool sliderVec2(std::string_view, glm::vec2&, float, float) { return false; }
+    virtual bool sliderInt(std::string_view, int&, int, int) { return false; }
+    virtual bool colorPicker(std::string_view, glm::vec4&) { return false; }
+    virtual bool button(std::string_view) { return false; }
+    virtual bool checkbox(std::string_view, bool&) { return false; }
+    virtual void separator() {}
+};
+
+// Opens a GLFW window with an OpenGL 3.3 core context and ImGui for the user interface
+std::unique_ptr<WindowBackend> createOpenGLBackend(std::string_view title, int width, int height,
+                                                   const RenderSettings& settings);
+
+// Renders into memory on the CPU, without a window or user interface
+std::unique_ptr<WindowBackend> createSoftwareBackend(int width, int height,
+                                                     const RenderSettings& settings);
+
+}  // namespace rendering
@@ -0,0 +1,580 @@
+#include "backend.h"
+#include "streamingbuffer.h"
+
+#include <array>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <imgui.h>
+#include <imgui_impl_glfw.h>
+#include <imgui_impl_opengl3.h>
+#include <fmt/format.h>
+
+#include <glm/common.hpp>
+
+// Dear students;
+// if you have found your way here, rest assured that understanding the rest of this file
+// is *not* required to complete the lab. This file contains a lot of implementation for
+// the rendering helper functionalities. Just have a look at the corresponding header file
+// "rendering.h" and look at the structs and functions that are exposed there. They are
+// all documented so that looking at the source code should not be necessary.
+// Having said that, if you are interested in anything, of course continue browsing here
+
+// Copy string_views into a zero terminated stack based string which is compatible with
+// ImGui and other libraries that expect zero terminated strings
+struct CStr {
+    static constexpr size_t BufferSize = 128;
+
+    CStr(const std::string_view sv) {
+        if (sv.size() < BufferSize - 1) {
+            std::memcpy(stack.data(), sv.data(), sv.size());
+            stack[sv.size()] = 0;
+            heap = nullptr;
+        } else {
+            heap = std::make_unique<char[]>(sv.size() + 1);
+            std::memcpy(heap.get(), sv.data(), sv.size());
+            heap[sv.size()] = 0;
+        }
+    }
+
+    const char* c_str() const { return heap ? heap.get() : stack.data(); }
+    operator const char*() const { return heap ? heap.get() : stack.data(); }
+
+private:
+    std::array<char, BufferSize> stack;  // Do not initialize!
+    std::unique_ptr<char[]> heap;
+};
+
+namespace {
+
+/**
+ * Checks the compilation status of the shader passed into it and prints out a message in
+ * case the shader was not compiled successfully. If the shader is successfully compiled,
+ * no message is printed. This function does **not** compile the shader.
+ * This function only performs a check if it is compiled in Debug mode. In release builds
+ * these checks will be omitted.
+ *
+ * \param shader The GL object of the shader object that should be checked
+ * \param name The human-readable name of the shader object used in the printing
+ *
+ * \throw std::runtime_error An exception is raised if the compilation of the shader
+ *        failed
+ * \pre \p shader must be a valid GL shader object
+ * \pre \p name must not be empty
+ * \post Only the compile status of \p shader might be modified
+ */
+static bool checkShader([[maybe_unused]] GLuint shader, [[maybe_unused]] std::string_view name) {
+    assert(shader != 0);
+    assert(!name.empty());
+
+    GLint status = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status == GL_FALSE) {
+        GLint logLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+        std::vector<char> buf;
+        buf.resize(static_cast<size_t>(logLength));
+        glGetShaderInfoLog(shader, logLength, NULL, buf.data());
+
+        fmt::print("Error compiling shader: {}\n{}", name, buf.data());
+    }
+
+    return status == GL_TRUE;
+}
+
+/**
+ * Checks the linking status of the passed shader program passed into it and prints out a
+ * message in case the program was not linked successfully. If the program was linked
+ * successfully, no message is printed. This function does **not** link the program.
+ * This function only performs a check if it is compiled in Debug mode. In release builds
+ * these checks will be omitted.
+ *
+ * \param program The shader program that is to be checked
+ * \param name The human-readable name of the shader program used in the printing
+ *
+ * \throw std::runtime_error An exception is raised if the linking of the program failed
+ *
+ * \pre \p program must be a valid GL program object
+ * \pre \p name must not be empty
+ * \post Only the link status of \p program might be modified
+ */
+static bool checkProgram([[maybe_unused]] GLuint program, [[maybe_unused]] std::string_view name) {
+    assert(program != 0);
+    assert(!name.empty());
+
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE) {
+        GLint logLength = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+        std::vector<char> buf;
+        buf.resize(static_cast<size_t>(logLength));
+        glGetProgramInfoLog(program, logLength, NULL, buf.data());
+
+        fmt::print("Error linking program: {}\n{}", name, buf.data());
+    }
+
+    return status == GL_TRUE;
+}
+
+/**
+ * Checks whether any of the GL functions called since the last call to this function have
+ * raised any errors. If there were multiple errors, only the first error will be printed.
+ * If there haven't been any errors, no message is printed.
+ *
+ * \param name The human-readable name that is used in the logging
+ *
+ * \throw std::runtime_error An exception is raised if there was an OpenGL error
+ *
+ * \pre \p name must not be empty
+ * \post The OpenGL error will be GL_NO_ERROR
+ */
+static void checkOpenGLError([[maybe_unused]] std::string_view name) {
+    GLenum e = glGetError();
+    if (e != GL_NO_ERROR) {
+        throw std::runtime_error(fmt::format("OpenGL error occurred ({}) {}", name, e));
+    }
+}
+
+/*
+* // Not used currently
+static void debugCallbackGL(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                            const GLchar* message, const void* userParam) {
+    fmt::print("OpenGL debug: {}\n", message);
+    if (severity >= GL_DEBUG_SEVERITY_MEDIUM) {
+        throw std::runtime_error("A severe OpenGL error occurred");
+    }
+}
+*/
+
+// Creates the shader program for points.
+static GLuint createPointProgram() {
+    constexpr const char* vsSrc[1] = {R"(
+        #version 330
+        layout(location = 0) in vec2  in_position;
+        layout(location = 1) in float in_scale;
+        layout(location = 2) in vec4  in_color;
+
+        out vec4 vs_color;
+
+        void main() {
+            vs_color = in_color;
+            gl_PointSize = in_scale;
+            gl_Position = vec4(in_position, 0.0, 1.0);
+        }
+    )"};
+
+    constexpr const char* fsSrc[1] = {R"(
+        #version 330
+        in vec4 vs_color;
+        out vec4 out_color;
+
+        void main() {
+            out_color = vec4(vs_color);
+        }
+    )"};
+
+    GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex, 1, vsSrc, nullptr);
+    glCompileShader(vertex);
+
+    GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment, 1, fsSrc, nullptr);
+    glCompileShader(fragment);
+
+    GLuint program = 0;
+    if (checkShader(vertex, "point-vertex") && checkShader(fragment, "point-fragment")) {
+        program = glCreateProgram();
+
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+
+        glLinkProgram(program);
+        checkProgram(program, "point-program");
+
+        glDetachShader(program, vertex);
+        glDetachShader(program, fragment);
+    }
+
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    return program;
+}
+
+}  // namespace
+
+namespace rendering {
+
+namespace {
+
+class OpenGLBackend : public WindowBackend {
+public:
+    OpenGLBackend(std::string_view title, int width, int height, const RenderSettings& settings);
+    ~OpenGLBackend() override;
+
+    void setTitle(std::string_view title) override { glfwSetWindowTitle(window, CStr(title)); }
+    double time() const override { return glfwGetTime(); }
+    bool shouldClose() const override { return glfwWindowShouldClose(window); }
+    glm::vec2 size() const override;
+
+    void beginFrame() override;
+    void endFrame() override;
+    void clear(glm::vec4 color) override;
+
+    void submit(PointBatcher& batcher, DrawStats& stats) override;
+    void drawAttributes(std::span<const glm::vec2> pos, std::span<const float> radius,
+                        const void* color, ColorFormat colorFormat, ChangedAttributes changed,
+                        DrawStats& stats) override;
+    Image readPixels() override;
+
+    void beginGuiWindow(std::string_view label) override;
+    void endGuiWindow() override;
+    void text(std::string_view text) override;
+    void text(std::string_view text, glm::vec4 color) override;
+    bool sliderFloat(std::string_view label, float& value, float min, float max) override;
+    bool sliderVec2(std::string_view label, glm::vec2& value, float min, float max) override;
+    bool sliderInt(std::string_view label, int& value, int min, int max) override;
+    bool colorPicker(std::string_view label, glm::vec4& color) override;
+    bool button(std::string_view label) override;
+    bool checkbox(std::string_view label, bool& value) override;
+    void separator() override;
+
+private:
+    // A GPU buffer holding one attribute of the points drawn from separate arrays
+    struct AttributeBuffer {
+        GLuint buffer = 0;
+        size_t capacity = 0;  // In bytes
+        size_t size = 0;      // In bytes, of the last upload
+    };
+
+    // Replaces the contents of the attribute buffer unless it is unchanged
+    void upload(AttributeBuffer& attribute, const void* data, size_t bytes, bool changed,
+                DrawStats& stats);
+
+    GLFWwindow* window;
+
+    GLuint program;
+    GLuint vao;
+    std::unique_ptr<StreamingBuffer> points;
+    size_t chunkSize;
+
+    GLuint attributeVao;
+    std::array<AttributeBuffer, 3> attributes;  // Position, radius and color
+    GLenum attributeColorType;
+};
+
+OpenGLBackend::OpenGLBackend(std::string_view title, int width, int height,
+                             const RenderSettings& settings)
+    : window{nullptr}
+    , program{0}
+    , vao{0}
+    , chunkSize{std::max<size_t>(settings.chunkSize, 1)}
+    , attributeVao{0}
+    , attributeColorType{GL_FLOAT} {
+
+    // Initialize GLFW for window handling
+    if (glfwInit() != GLFW_TRUE) {
+        throw std::runtime_error("Unable to initialize GLFW");
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    window = glfwCreateWindow(width, height, CStr(title), nullptr, nullptr);
+    if (!window) {
+        glfwTerminate();
+        throw std::runtime_error("Unable to create a window with an OpenGL 3.3 context");
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+
+    // Initialize the GLAD OpenGL wrapper
+    gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+
+    // Initialize ImGui UI library
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui::StyleColorsDark();
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGuiIO& io = ImGui::GetIO();
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+    ImGui_ImplOpenGL3_Init();
+    ImGuiStyle& style = ImGui::GetStyle();
+    style.WindowRounding = 0.f;
+    style.WindowTitleAlign.x = 0.5f;
+    style.WindowMenuButtonPosition = 0;
+
+    // Create GL objects
+    program = createPointProgram();
+    glGenVertexArrays(1, &vao);
+
+    // Allocate vertex buffer memory, each frame can draw up to streamCapacity points without
+    // waiting for the GPU
+    const size_t capacity = std::max<size_t>(settings.streamCapacity, 1);
+    points = std::make_unique<StreamingBuffer>(GL_ARRAY_BUFFER, capacity * sizeof(PointVertex));
+
+    // Setup vertex attribute pointers for Points
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, points->id());
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(PointVertex),
+                          reinterpret_cast<const void*>(offsetof(PointVertex, position)));
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(PointVertex),
+                          reinterpret_cast<const void*>(offsetof(PointVertex, scale)));
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PointVertex),
+                          reinterpret_cast<const void*>(offsetof(PointVertex, color_packed)));
+
+    // The points drawn from separate arrays read every attribute from its own buffer. The color
+    // pointer is set when drawing since it depends on whether the colors are packed.
+    glGenVertexArrays(1, &attributeVao);
+    glBindVertexArray(attributeVao);
+    for (AttributeBuffer& attribute : attributes) {
+        glGenBuffers(1, &attribute.buffer);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, attributes[0].buffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), nullptr);
+    glBindBuffer(GL_ARRAY_BUFFER, attributes[1].buffer);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(float), nullptr);
+    glBindBuffer(GL_ARRAY_BUFFER, attributes[2].buffer);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), nullptr);
+
+    glBindVertexArray(0);
+
+    checkOpenGLError("postInit");
+}
+
+OpenGLBackend::~OpenGLBackend() {
+    glDeleteProgram(program);
+    glDeleteVertexArrays(1, &vao);
+    points.reset();
+    glDeleteVertexArrays(1, &attributeVao);
+    for (AttributeBuffer& attribute : attributes) {
+        glDeleteBuffers(1, &attribute.buffer);
+    }
+
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+
+    glfwDestroyWindow(window);
+
+    // @NOTE: This is should be performed outside the lifetime of a single window
+    glfwTerminate();
+}
+
+glm::vec2 OpenGLBackend::size() const {
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+    return {static_cast<float>(width), static_cast<float>(height)};
+}
+
+void OpenGLBackend::beginFrame() {
+    checkOpenGLError("beginFrame");
+
+    // Query the events from the operating system, such as input from mouse or keyboards
+    glfwPollEvents();
+
+    // Set the default OpenGL state
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+
+    // Update render window
+    glViewport(0, 0, width, height);
+
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+}
+
+void OpenGLBackend::clear(glm::vec4 color) {
+    // Clear the rendering buffer with the selected background color
+    glClearColor(color.r, color.g, color.b, color.a);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void OpenGLBackend::submit(PointBatcher& batcher, DrawStats& stats) {
+    // Upload the recorded points to the GPU. They are appended to the part of the streaming
+    // buffer that belongs to this frame, so this never waits for earlier draws unless the frame
+    // draws more than the buffer's capacity.
+    struct StreamingSink : PointSink {
+        OpenGLBackend& backend;
+        DrawStats& stats;
+        StreamingBuffer::Allocation allocation{};
+        size_t count = 0;
+
+        StreamingSink(OpenGLBackend& backend, DrawStats& stats) : backend{backend}, stats{stats} {}
+
+        std::span<PointVertex> map(size_t n) override {
+            allocation = backend.points->allocate(n * sizeof(PointVertex), sizeof(PointVertex));
+            count = n;
+            return {static_cast<PointVertex*>(allocation.data), n};
+        }
+
+        void draw() override {
+            backend.points->commit(allocation);
+            glDrawArrays(GL_POINTS, static_cast<GLint>(allocation.offset / sizeof(PointVertex)),
+                         static_cast<GLsizei>(count));
+            stats.bytesUploaded += count * sizeof(PointVertex);
+        }
+    };
+
+    glBindVertexArray(vao);
+    glUseProgram(program);
+    StreamingSink sink{*this, stats};
+    const size_t capacity = points->getRegionSize() / sizeof(PointVertex);
+    stats.glDrawCalls += batcher.submit(sink, std::min(chunkSize, capacity));
+    glUseProgram(0);
+    glBindVertexArray(0);
+
+    checkOpenGLError("submit");
+}
+
+void OpenGLBackend::upload(AttributeBuffer& attribute, const void* data, size_t bytes,
+                           bool changed, DrawStats& stats) {
+    if (!changed && bytes == attribute.size) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, attribute.buffer);
+    if (bytes > attribute.capacity) {
+        attribute.capacity = std::max(bytes, 2 * attribute.capacity);
+    }
+    // Orphan the old storage so that the copy does not have to wait for draws still using it
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(attribute.capacity), nullptr,
+                 GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(bytes), data);
+    attribute.size = bytes;
+    stats.bytesUploaded += bytes;
+}
+
+void OpenGLBackend::drawAttributes(std::span<const glm::vec2> pos, std::span<const float> radius,
+                                   const void* color, ColorFormat colorFormat,
+                                   ChangedAttributes changed, DrawStats& stats) {
+    const GLenum colorType = colorFormat == ColorFormat::PackedRGBA8 ? GL_UNSIGNED_BYTE : GL_FLOAT;
+    const size_t colorBytes =
+        pos.size() * (colorType == GL_UNSIGNED_BYTE ? sizeof(uint32_t) : sizeof(glm::vec4));
+
+    glBindVertexArray(attributeVao);
+    upload(attributes[0], pos.data(), pos.size_bytes(), changed.position, stats);
+    upload(attributes[1], radius.data(), radius.size_bytes(), changed.radius, stats);
+    const bool colorTypeChanged = colorType != attributeColorType;
+    upload(attributes[2], color, colorBytes, changed.color || colorTypeChanged, stats);
+    if (colorTypeChanged) {
+        attributeColorType = colorType;
+        glBindBuffer(GL_ARRAY_BUFFER, attributes[2].buffer);
+        if (colorType == GL_UNSIGNED_BYTE) {
+            glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(uint32_t), nullptr);
+        } else {
+            glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), nullptr);
+        }
+    }
+
+    glUseProgram(program);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(pos.size()));
+    glUseProgram(0);
+    glBindVertexArray(0);
+    stats.glDrawCalls++;
+
+    checkOpenGLError("drawAttributes");
+}
+
+Image OpenGLBackend::readPixels() {
+    Image image;
+    glfwGetFramebufferSize(window, &image.width, &image.height);
+    const auto w = static_cast<size_t>(image.width);
+    const auto h = static_cast<size_t>(image.height);
+    std::vector<uint32_t>& pixels = image.pixels;
+    pixels.resize(w * h);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    // OpenGL stores the bottom row first
+    for (size_t y = 0; y < h / 2; ++y) {
+        std::swap_ranges(pixels.begin() + static_cast<std::ptrdiff_t>(y * w),
+                         pixels.begin() + static_cast<std::ptrdiff_t>((y + 1) * w),
+                         pixels.begin() + static_cast<std::ptrdiff_t>((h - 1 - y) * w));
+    }
+    checkOpenGLError("readPixels");
+    return image;
+}
+
+void OpenGLBackend::endFrame() {
+    ImGui::Render();
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+    // All point draws of the frame have been issued
+    points->endFrame();
+
+    // Swapping the front and back buffer. Since we are doing v-sync is enabled, this
+    // call will block until its our turn to swap the buffers (usually every 16.6 ms
+    // on a 60 Hz monitor
+    glfwSwapBuffers(window);
+
+    checkOpenGLError("endFrame");
+}
+
+void OpenGLBackend::beginGuiWindow(std::string_view label) { ImGui::Begin(CStr(label)); }
+
+void OpenGLBackend::endGuiWindow() { ImGui::End(); }
+
+void OpenGLBackend::text(std::string_view text) { ImGui::Text("%s", CStr{text}.c_str()); }
+
+void OpenGLBackend::text(std::string_view text, glm::vec4 color) {
+    ImGui::TextColored({color.r, color.g, color.b, 1.0f}, "%s", CStr{text}.c_str());
+}
+
+bool OpenGLBackend::sliderFloat(std::string_view label, float& value, float minValue,
+                                float maxValue) {
+    return ImGui::SliderFloat(CStr(label), &value, minValue, maxValue);
+}
+
+bool OpenGLBackend::sliderInt(std::string_view label, int& value, int minValue, int maxValue) {
+    return ImGui::SliderInt(CStr(label), &value, minValue, maxValue);
+}
+
+bool OpenGLBackend::sliderVec2(std::string_view label, glm::vec2& value, float minValue,
+                               float maxValue) {
+    const float speed = (maxValue - minValue) / 2000.f;
+    return ImGui::DragFloat2(CStr(label), &value.x, speed, minValue, maxValue);
+}
+
+bool OpenGLBackend::colorPicker(std::string_view label, glm::vec4& color) {
+    return ImGui::ColorEdit3(CStr(label), &color.r);
+}
+
+bool OpenGLBackend::button(std::string_view label) { return ImGui::Button(CStr(label)); }
+
+bool OpenGLBackend::checkbox(std::string_view label, bool& value) {
+    return ImGui::Checkbox(CStr(label), &value);
+}
+
+void OpenGLBackend::separator() { ImGui::Separator(); }
+
+}  // namespace
+
+std::unique_ptr<WindowBackend> createOpenGLBackend(std::string_view title, int width, int height,
+                                                   const RenderSettings& settings) {
+    return std::make_unique<OpenGLBackend>(title, width, height, settings);
+}
+
+}  // namespace rendering
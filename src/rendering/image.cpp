@@ -0,0 +1,133 @@
+#include "image.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+uint32_t adler32(const std::vector<uint8_t>& data) {
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : data) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+void appendChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data) {
+    appendBigEndian(png, static_cast<uint32_t>(data.size()));
+    const size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    appendBigEndian(png, crc32(png.data() + start, png.size() - start));
+}
+
+// The image data is stored in uncompressed deflate blocks, which every PNG reader supports
+std::vector<uint8_t> encodePng(const rendering::Image& image) {
+    const auto width = static_cast<size_t>(image.width);
+    const auto height = static_cast<size_t>(image.height);
+
+    // Every row starts with the filter type, 0 for none
+    std::vector<uint8_t> raw;
+    raw.reserve(height * (1 + 4 * width));
+    for (size_t y = 0; y < height; ++y) {
+        raw.push_back(0);
+        for (size_t x = 0; x < width; ++x) {
+            const uint32_t p = image.pixels[y * width + x];
+            raw.push_back(static_cast<uint8_t>(p));
+            raw.push_back(static_cast<uint8_t>(p >> 8));
+            raw.push_back(static_cast<uint8_t>(p >> 16));
+            raw.push_back(static_cast<uint8_t>(p >> 24));
+        }
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    constexpr size_t maxBlock = 65535;
+    for (size_t pos = 0; pos < raw.size() || pos == 0; pos += maxBlock) {
+        const size_t size = std::min(maxBlock, raw.size() - pos);
+        const bool last = pos + size >= raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(size));
+        zlib.push_back(static_cast<uint8_t>(size >> 8));
+        zlib.push_back(static_cast<uint8_t>(~size));
+        zlib.push_back(static_cast<uint8_t>(~size >> 8));
+        zlib.insert(zlib.end(), raw.begin() + static_cast<std::ptrdiff_t>(pos),
+                    raw.begin() + static_cast<std::ptrdiff_t>(pos + size));
+        if (last) break;
+    }
+    appendBigEndian(zlib, adler32(raw));
+
+    std::vector<uint8_t> header;
+    appendBigEndian(header, static_cast<uint32_t>(width));
+    appendBigEndian(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), {8, 6, 0, 0, 0});  // 8 bit RGBA, no interlacing
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+    return png;
+}
+
+std::vector<uint8_t> encodePpm(const rendering::Image& image) {
+    const std::string header = fmt::format("P6\n{} {}\n255\n", image.width, image.height);
+    std::vector<uint8_t> ppm(header.begin(), header.end());
+    ppm.reserve(header.size() + 3 * image.pixels.size());
+    for (uint32_t p : image.pixels) {
+        ppm.push_back(static_cast<uint8_t>(p));
+        ppm.push_back(static_cast<uint8_t>(p >> 8));
+        ppm.push_back(static_cast<uint8_t>(p >> 16));
+    }
+    return ppm;
+}
+
+}  // namespace
+
+namespace rendering {
+
+void writeImage(std::string_view path, const Image& image) {
+    const std::vector<uint8_t> data = path.ends_with(".png") ? encodePng(image) : encodePpm(image);
+
+    std::ofstream file{std::string{path}, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        throw std::runtime_error(fmt::format("Unable to write image '{}'", path));
+    }
+}
+
+}  // namespace rendering
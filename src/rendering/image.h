@@ -0,0 +1,16 @@
+#pragma once
+
+#include <rendering/window.h>
+
+#include <string_view>
+
+namespace rendering {
+
+/**
+ * Writes the image to a file. The format is chosen from the extension: ".png" writes an RGBA PNG
+ * (uncompressed, so no external library is needed) and anything else a binary RGB PPM.
+ * \throw std::runtime_error if the file could not be written
+ */
+void writeImage(std::string_view path, const Image& image);
+
+}  // namespace rendering
@@ -0,0 +1,50 @@
+#include <rendering/pointbatcher.h>
+
+#include <glm/packing.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace rendering {
+
+void PointBatcher::add(const glm::vec2* pos, const float* radius, const glm::vec4* color,
+                       size_t count, size_t stride_in_bytes) {
+    const size_t first = batch.size();
+    batch.resize(first + count);
+    PointVertex* out = batch.data() + first;
+
+    if (stride_in_bytes == 0) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = {pos[i], radius[i], glm::packUnorm4x8(color[i])};
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            const glm::vec2* p = reinterpret_cast<const glm::vec2*>(
+                reinterpret_cast<const char*>(pos) + i * stride_in_bytes);
+            const float* r = reinterpret_cast<const float*>(
+                reinterpret_cast<const char*>(radius) + i * stride_in_bytes);
+            const glm::vec4* c = reinterpret_cast<const glm::vec4*>(
+                reinterpret_cast<const char*>(color) + i * stride_in_bytes);
+            out[i] = {*p, *r, glm::packUnorm4x8(*c)};
+        }
+    }
+}
+
+size_t PointBatcher::submit(PointSink& sink, size_t chunkSize) {
+    assert(chunkSize > 0);
+
+    size_t chunks = 0;
+    for (size_t first = 0; first < batch.size(); first += chunkSize) {
+        const size_t count = std::min(chunkSize, batch.size() - first);
+        const std::span<PointVertex> out = sink.map(count);
+        assert(out.size() == count);
+        std::memcpy(out.data(), batch.data() + first, count * sizeof(PointVertex));
+        sink.draw();
+        chunks++;
+    }
+    batch.clear();
+    return chunks;
+}
+
+}  // namespace rendering
@@ -0,0 +1,292 @@
+#include "backend.h"
+
+#include <glm/packing.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rendering {
+
+namespace {
+
+/**
+ * Rasterizes the points on the CPU into an RGBA8 framebuffer, with the same result as the OpenGL
+ * backend: square points of gl_PointSize pixels blended with GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA.
+ *
+ * The submitted points are kept until the frame is needed and are then binned into screen tiles.
+ * The tiles are independent of each other, so they are rasterized in parallel by a pool of worker
+ * threads that lives as long as the backend, and within a tile the points are blended in the order
+ * they were submitted.
+ */
+class SoftwareBackend : public WindowBackend {
+public:
+    SoftwareBackend(int width, int height, const RenderSettings& settings);
+    ~SoftwareBackend() override;
+
+    void setTitle(std::string_view) override {}
+    double time() const override;
+    bool shouldClose() const override { return false; }
+    glm::vec2 size() const override {
+        return {static_cast<float>(width), static_cast<float>(height)};
+    }
+
+    void beginFrame() override {}
+    void endFrame() override { rasterize(); }
+    void clear(glm::vec4 color) override;
+
+    void submit(PointBatcher& batcher, DrawStats& stats) override;
+    void drawAttributes(std::span<const glm::vec2> pos, std::span<const float> radius,
+                        const void* color, ColorFormat colorFormat, ChangedAttributes changed,
+                        DrawStats& stats) override;
+    Image readPixels() override;
+
+private:
+    static constexpr int TileSize = 64;
+
+    // The pixels covered by a point, [x0, x1) x [y0, y1)
+    struct Rect {
+        int x0, y0, x1, y1;
+    };
+
+    // Draws all pending points into the framebuffer
+    void rasterize();
+    // Takes tiles from nextTile until there are none left
+    void rasterizeTiles();
+    void rasterizeTile(size_t tile);
+    void workerLoop(size_t index);
+
+    int width;
+    int height;
+    int tilesX;
+    int tilesY;
+    size_t threadCount;
+    size_t chunkSize;
+    std::chrono::steady_clock::time_point start;
+
+    std::vector<uint32_t> framebuffer;  // Packed like glm::packUnorm4x8, top row first
+    std::vector<PointVertex> pending;   // Submitted but not yet rasterized
+    std::vector<Rect> rects;
+    std::vector<std::vector<uint32_t>> bins;  // Indices of the points overlapping each tile
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation = 0;   // Incremented for every frame that uses the workers
+    size_t activeWorkers = 0;  // The workers taking part in the current frame
+    size_t runningWorkers = 0;
+    bool stopping = false;
+    std::atomic<size_t> nextTile{0};
+};
+
+SoftwareBackend::SoftwareBackend(int width, int height, const RenderSettings& settings)
+    : width{std::max(width, 1)}
+    , height{std::max(height, 1)}
+    , tilesX{(this->width + TileSize - 1) / TileSize}
+    , tilesY{(this->height + TileSize - 1) / TileSize}
+    , threadCount{settings.threadCount > 0 ? settings.threadCount
+                                           : std::max(1u, std::thread::hardware_concurrency())}
+    , chunkSize{std::max<size_t>(settings.chunkSize, 1)}
+    , start{std::chrono::steady_clock::now()}
+    , framebuffer(static_cast<size_t>(this->width) * static_cast<size_t>(this->height), 0)
+    , bins(static_cast<size_t>(tilesX) * static_cast<size_t>(tilesY)) {
+    // The calling thread rasterizes as well
+    for (size_t i = 1; i < threadCount; ++i) {
+        workers.emplace_back([this, i] { workerLoop(i - 1); });
+    }
+}
+
+SoftwareBackend::~SoftwareBackend() {
+    {
+        std::scoped_lock lock{mutex};
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void SoftwareBackend::workerLoop(size_t index) {
+    uint64_t seen = 0;
+    std::unique_lock lock{mutex};
+    while (true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+        if (index >= activeWorkers) continue;
+
+        lock.unlock();
+        rasterizeTiles();
+        lock.lock();
+        if (--runningWorkers == 0) done.notify_one();
+    }
+}
+
+double SoftwareBackend::time() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SoftwareBackend::clear(glm::vec4 color) {
+    // Anything still pending would be covered by the clear
+    pending.clear();
+    std::ranges::fill(framebuffer, glm::packUnorm4x8(color));
+}
+
+void SoftwareBackend::submit(PointBatcher& batcher, DrawStats& stats) {
+    struct PendingSink : PointSink {
+        std::vector<PointVertex>& pending;
+        explicit PendingSink(std::vector<PointVertex>& pending) : pending{pending} {}
+
+        std::span<PointVertex> map(size_t count) override {
+            const size_t first = pending.size();
+            pending.resize(first + count);
+            return std::span(pending).subspan(first);
+        }
+        void draw() override {}
+    };
+
+    stats.bytesUploaded += batcher.size() * sizeof(PointVertex);
+    PendingSink sink{pending};
+    stats.glDrawCalls += batcher.submit(sink, chunkSize);
+}
+
+void SoftwareBackend::drawAttributes(std::span<const glm::vec2> pos, std::span<const float> radius,
+                                     const void* color, ColorFormat colorFormat,
+                                     ChangedAttributes, DrawStats& stats) {
+    // The rasterizer needs every attribute each frame, so unchanged attributes are copied anyway
+    const size_t first = pending.size();
+    pending.resize(first + pos.size());
+    PointVertex* out = pending.data() + first;
+    if (colorFormat == ColorFormat::PackedRGBA8) {
+        const uint32_t* packed = static_cast<const uint32_t*>(color);
+        for (size_t i = 0; i < pos.size(); ++i) {
+            out[i] = {pos[i], radius[i], packed[i]};
+        }
+    } else {
+        const glm::vec4* colors = static_cast<const glm::vec4*>(color);
+        for (size_t i = 0; i < pos.size(); ++i) {
+            out[i] = {pos[i], radius[i], glm::packUnorm4x8(colors[i])};
+        }
+    }
+    stats.bytesUploaded += pos.size() * sizeof(PointVertex);
+    stats.glDrawCalls++;
+}
+
+Image SoftwareBackend::readPixels() {
+    rasterize();
+    return {width, height, framebuffer};
+}
+
+void SoftwareBackend::rasterize() {
+    if (pending.empty()) return;
+
+    // Bin the points into the tiles they overlap. The point size is clamped to one pixel like
+    // OpenGL does, and the covered pixels are the ones whose centers are inside the square.
+    rects.resize(pending.size());
+    for (auto& bin : bins) bin.clear();
+    const auto w = static_cast<float>(width);
+    const auto h = static_cast<float>(height);
+    for (size_t i = 0; i < pending.size(); ++i) {
+        const PointVertex& p = pending[i];
+        const float cx = (p.position.x * 0.5f + 0.5f) * w;
+        const float cy = (0.5f - p.position.y * 0.5f) * h;
+        const float half = 0.5f * std::max(p.scale, 1.0f);
+        if (!(cx + half > 0.0f && cx - half < w && cy + half > 0.0f && cy - half < h)) {
+            continue;  // Outside the framebuffer, or not a number
+        }
+        Rect r{static_cast<int>(std::ceil(cx - half - 0.5f)),
+               static_cast<int>(std::ceil(cy - half - 0.5f)),
+               static_cast<int>(std::ceil(cx + half - 0.5f)),
+               static_cast<int>(std::ceil(cy + half - 0.5f))};
+        r = {std::max(r.x0, 0), std::max(r.y0, 0), std::min(r.x1, width), std::min(r.y1, height)};
+        if (r.x0 >= r.x1 || r.y0 >= r.y1) continue;
+        rects[i] = r;
+
+        for (int ty = r.y0 / TileSize; ty <= (r.y1 - 1) / TileSize; ++ty) {
+            for (int tx = r.x0 / TileSize; tx <= (r.x1 - 1) / TileSize; ++tx) {
+                bins[static_cast<size_t>(ty * tilesX + tx)].push_back(static_cast<uint32_t>(i));
+            }
+        }
+    }
+
+    // Hand out the tiles to the threads one at a time, small frames are not worth waking the
+    // workers for
+    constexpr size_t minPointsPerThread = 4096;
+    nextTile = 0;
+    const size_t threads =
+        std::min({threadCount, bins.size(), 1 + pending.size() / minPointsPerThread});
+    if (threads > 1) {
+        {
+            std::scoped_lock lock{mutex};
+            activeWorkers = threads - 1;
+            runningWorkers = threads - 1;
+            generation++;
+        }
+        wake.notify_all();
+    }
+    rasterizeTiles();
+    if (threads > 1) {
+        std::unique_lock lock{mutex};
+        done.wait(lock, [&] { return runningWorkers == 0; });
+    }
+
+    pending.clear();
+}
+
+void SoftwareBackend::rasterizeTiles() {
+    for (size_t tile = nextTile++; tile < bins.size(); tile = nextTile++) {
+        rasterizeTile(tile);
+    }
+}
+
+void SoftwareBackend::rasterizeTile(size_t tile) {
+    const int tx = static_cast<int>(tile) % tilesX;
+    const int ty = static_cast<int>(tile) / tilesX;
+    const int left = tx * TileSize;
+    const int top = ty * TileSize;
+    const int right = std::min(left + TileSize, width);
+    const int bottom = std::min(top + TileSize, height);
+
+    for (uint32_t index : bins[tile]) {
+        const Rect& r = rects[index];
+        const uint32_t src = pending[index].color_packed;
+        const uint32_t alpha = src >> 24;
+        if (alpha == 0) continue;
+
+        for (int y = std::max(r.y0, top); y < std::min(r.y1, bottom); ++y) {
+            uint32_t* row =
+                framebuffer.data() + static_cast<size_t>(y) * static_cast<size_t>(width);
+            for (int x = std::max(r.x0, left); x < std::min(r.x1, right); ++x) {
+                if (alpha == 255) {
+                    row[x] = src;
+                    continue;
+                }
+                // dst = src * alpha + dst * (1 - alpha) for every channel, including alpha
+                const uint32_t dst = row[x];
+                uint32_t result = 0;
+                for (int shift = 0; shift < 32; shift += 8) {
+                    const uint32_t s = (src >> shift) & 0xFF;
+                    const uint32_t d = (dst >> shift) & 0xFF;
+                    result |= ((s * alpha + d * (255 - alpha) + 127) / 255) << shift;
+                }
+                row[x] = result;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+std::unique_ptr<WindowBackend> createSoftwareBackend(int width, int height,
+                                                     const RenderSettings& settings) {
+    return std::make_unique<SoftwareBackend>(width, height, settings);
+}
+
+}  // namespace rendering
@@ -0,0 +1,136 @@
+#include "streamingbuffer.h"
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+// Persistent mapping needs glBufferStorage, which is only available if GLAD was generated with
+// GL 4.4 or the extension and the driver provides it
+bool bufferStorageSupported() {
+#if defined(GL_VERSION_4_4)
+    if (GLAD_GL_VERSION_4_4) return true;
+#endif
+#if defined(GL_ARB_buffer_storage)
+    if (GLAD_GL_ARB_buffer_storage) return true;
+#endif
+    return false;
+}
+
+size_t alignUp(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Blocks until the GPU has passed the fence and deletes it
+void waitAndDelete(GLsync& fence) {
+    if (!fence) return;
+    constexpr GLuint64 timeout = 1'000'000;  // 1 ms
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (result == GL_TIMEOUT_EXPIRED) {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+}  // namespace
+
+namespace rendering {
+
+StreamingBuffer::StreamingBuffer(GLenum target, size_t regionSize, bool allowPersistent)
+    : target{target}
+    , buffer{0}
+    , regionSize{regionSize}
+    , mapped{nullptr}
+    , region{0}
+    , head{0}
+    , fences{} {
+    const auto capacity = static_cast<GLsizeiptr>(RegionCount * regionSize);
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+
+#if defined(GL_VERSION_4_4) || defined(GL_ARB_buffer_storage)
+    if (allowPersistent && bufferStorageSupported()) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, capacity, nullptr, flags);
+        mapped = static_cast<std::byte*>(glMapBufferRange(target, 0, capacity, flags));
+        if (!mapped) {
+            throw std::runtime_error("Failed to persistently map the streaming buffer");
+        }
+        return;
+    }
+#else
+    (void)allowPersistent;
+#endif
+
+    glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+}
+
+StreamingBuffer::~StreamingBuffer() {
+    for (GLsync& fence : fences) {
+        if (fence) glDeleteSync(fence);
+    }
+    if (mapped) {
+        glBindBuffer(target, buffer);
+        glUnmapBuffer(target);
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+StreamingBuffer::Allocation StreamingBuffer::allocate(size_t size, size_t alignment) {
+    assert(size <= regionSize);
+
+    size_t offset = alignUp(head, alignment);
+    if (mapped) {
+        // Move on to the next region if the allocation does not fit in the current one. This
+        // only waits if the GPU is still reading the region from RegionCount frames ago.
+        if (offset + size > (region + 1) * regionSize) {
+            advanceRegion();
+            offset = alignUp(head, alignment);
+        }
+        head = offset + size;
+        return {mapped + offset, offset, size};
+    }
+
+    // Orphaning path: append to the buffer until it is full and then let the driver replace its
+    // storage, the old storage stays alive until the GPU is done with it
+    glBindBuffer(target, buffer);
+    const size_t capacity = RegionCount * regionSize;
+    if (offset + size > capacity) {
+        glBufferData(target, static_cast<GLsizeiptr>(capacity), nullptr, GL_STREAM_DRAW);
+        offset = 0;
+    }
+    // Unsynchronized since nothing that is still in flight uses this range
+    void* data = glMapBufferRange(
+        target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!data) {
+        throw std::runtime_error("Failed to map buffer");
+    }
+    head = offset + size;
+    return {data, offset, size};
+}
+
+void StreamingBuffer::commit(const Allocation&) {
+    // Coherent persistent mappings are visible to the GPU without any further calls
+    if (!mapped) {
+        glBindBuffer(target, buffer);
+        glUnmapBuffer(target);
+    }
+}
+
+void StreamingBuffer::endFrame() {
+    if (mapped) {
+        advanceRegion();
+    }
+}
+
+void StreamingBuffer::advanceRegion() {
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region = (region + 1) % RegionCount;
+    waitAndDelete(fences[region]);
+    head = region * regionSize;
+}
+
+}  // namespace rendering
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+
+namespace rendering {
+
+/**
+ * A GL buffer that the CPU writes new data into every frame. The buffer is split into
+ * RegionCount regions that are used round robin, one per frame, so the CPU writes one region
+ * while the GPU may still be reading the previous ones. Every region is protected by a fence
+ * that is only waited for when the ring wraps around to it again. Within a region, draws
+ * sub-allocate consecutive ranges, so any number of draws per frame append without stalling.
+ *
+ * If the context supports GL_ARB_buffer_storage (core in GL 4.4) the whole buffer is mapped once
+ * with persistent coherent mapping. Otherwise every allocation maps its range unsynchronized and
+ * the buffer is orphaned when it is full, which lets the driver hand out fresh memory instead of
+ * waiting for the GPU.
+ */
+class StreamingBuffer {
+public:
+    static constexpr size_t RegionCount = 3;
+
+    struct Allocation {
+        void* data;     // Writable memory until commit is called
+        size_t offset;  // Offset in bytes from the start of the buffer
+        size_t size;
+    };
+
+    /**
+     * Creates the buffer, it is left bound to 'target'
+     * @param target The binding point used for mapping, e.g. GL_ARRAY_BUFFER
+     * @param regionSize The size in bytes of each of the RegionCount regions
+     * @param allowPersistent Map the buffer persistently when the context supports it, false
+     * forces the orphaning path
+     */
+    StreamingBuffer(GLenum target, size_t regionSize, bool allowPersistent = true);
+    StreamingBuffer(const StreamingBuffer&) = delete;
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+    ~StreamingBuffer();
+
+    GLuint id() const { return buffer; }
+    bool isPersistent() const { return mapped != nullptr; }
+    size_t getRegionSize() const { return regionSize; }
+
+    /**
+     * Reserves 'size' bytes for writing. The returned offset is a multiple of 'alignment' so that
+     * it can be turned into a first vertex index.
+     * @pre size <= getRegionSize()
+     * @throw std::runtime_error if the memory could not be mapped
+     */
+    Allocation allocate(size_t size, size_t alignment);
+
+    // Makes the written data available to draw calls, must be called before drawing from it
+    void commit(const Allocation& allocation);
+
+    // Fences the current region after the frame's draws and moves on to the next region, waiting
+    // for the GPU to finish reading it if it is still in use
+    void endFrame();
+
+private:
+    // Fences the current region and makes the next one current
+    void advanceRegion();
+
+    GLenum target;
+    GLuint buffer;
+    size_t regionSize;
+    std::byte* mapped;  // The persistent mapping, nullptr for the orphaning path
+
+    size_t region;  // The region currently written to
+    size_t head;    // Offset of the first free byte in the buffer
+    std::array<GLsync, RegionCount> fences;
+};
+
+}  // namespace rendering
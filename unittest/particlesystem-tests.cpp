@@ -1,7 +1,34 @@
 #include <catch2/catch_all.hpp>
 #include <glm/glm.hpp>
+#include <fmt/format.h>
 
 #include <particlesystem/particlesystem.h>
+#include <particlesystem/particlestore.h>
+#include <particlesystem/particlepool.h>
+#include <particlesystem/scheduler.h>
+#include <particlesystem/simulation.h>
+#include <particlesystem/kernels.h>
+#include <particlesystem/effecttable.h>
+#include <particlesystem/spatialgrid.h>
+#include <particlesystem/random.h>
+#include <particlesystem/simulationclock.h>
+#include <particlesystem/pipeline.h>
+#include <particlesystem/slotmap.h>
+#include <particlesystem/system.h>
+#include <particlesystem/profiler.h>
+#include <particlesystem/snapshot.h>
+#include <particlesystem/recorder.h>
+#include <particlesystem/scene.h>
+#include <particlesystem/backend.h>
+
+#include <allocationcounter/allocationcounter.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <cstdlib>
+#include <numbers>
 
 /* Unit tests using the catch2 framework
  * Homepage: https://github.com/catchorg/Catch2
@@ -9,3 +36,1657 @@
  * Docs: https://github.com/catchorg/Catch2/blob/devel/docs/Readme.md
  */
 
+TEST_CASE("Empty store", "[ParticleStore]") {
+    particlesystem::ParticleStore store;
+
+    REQUIRE(store.empty());
+    REQUIRE(store.getPosition().size() == 0);
+    REQUIRE(store.getRadius().size() == 0);
+    REQUIRE(store.getColor().size() == 0);
+}
+
+SCENARIO("Particles in a store", "[ParticleStore]") {
+    GIVEN("A store with 10 particles") {
+        particlesystem::ParticleStore store;
+        for (int i = 0; i < 10; ++i) {
+            store.push(Particle(glm::vec2{static_cast<float>(i), 0.0f}));
+        }
+
+        THEN("Every attribute array should have one element per particle") {
+            REQUIRE(store.size() == 10);
+            REQUIRE(store.getPosition().size() == 10);
+            REQUIRE(store.getVelocity().size() == 10);
+            REQUIRE(store.getAcceleration().size() == 10);
+            REQUIRE(store.getLifetime().size() == 10);
+            REQUIRE(store.getRadius().size() == 10);
+            REQUIRE(store.getColor().size() == 10);
+        }
+
+        WHEN("A particle is erased") {
+            store.erase(3);
+
+            THEN("The remaining particles keep their order") {
+                REQUIRE(store.size() == 9);
+                REQUIRE(store.getPosition()[2].x == 2.0f);
+                REQUIRE(store.getPosition()[3].x == 4.0f);
+            }
+        }
+
+        WHEN("The store is updated") {
+            std::vector<glm::vec2> initialPositions(store.getPosition().begin(),
+                                                    store.getPosition().end());
+            store.updateLifetime(0.5);
+            store.updatePosition(0.5);
+
+            THEN("The particles should have aged and moved") {
+                REQUIRE(std::ranges::all_of(store.getLifetime(),
+                                            [](float age) { return age == 0.5f; }));
+                REQUIRE(!std::ranges::equal(store.getPosition(), initialPositions));
+            }
+        }
+    }
+}
+
+TEST_CASE("Retiring expired particles", "[ParticleStore]") {
+    const auto order = GENERATE(particlesystem::RetireOrder::Unordered,
+                                particlesystem::RetireOrder::Stable);
+
+    // Particle i is identified by its x position. Expired particles are placed in runs of
+    // different lengths, including the first and the last slot, to cover the case where the
+    // particle moved into a freed slot has also expired.
+    const std::vector<bool> expired = {true,  true,  false, true,  false, false, true,
+                                       true,  true,  false, false, true,  false, true,
+                                       true,  false, true,  true,  true,  true};
+    particlesystem::ParticleStore store;
+    for (size_t i = 0; i < expired.size(); ++i) {
+        store.push(Particle(glm::vec2{static_cast<float>(i), 0.0f}));
+        store.getLifetime()[i] = expired[i] ? 5.0f : 1.0f;
+    }
+    const auto expiredCount = static_cast<size_t>(std::ranges::count(expired, true));
+
+    const size_t removed = store.retireExpired(4.0f, order);
+
+    REQUIRE(removed == expiredCount);
+    REQUIRE(store.size() == expired.size() - expiredCount);
+    REQUIRE(store.getLifetime().size() == store.size());
+    REQUIRE(store.getColor().size() == store.size());
+    REQUIRE(std::ranges::all_of(store.getLifetime(), [](float age) { return age <= 4.0f; }));
+
+    // Every surviving particle should be present exactly once
+    std::vector<size_t> seen(expired.size(), 0);
+    for (const glm::vec2& p : store.getPosition()) {
+        seen[static_cast<size_t>(p.x)]++;
+    }
+    for (size_t i = 0; i < expired.size(); ++i) {
+        REQUIRE(seen[i] == (expired[i] ? 0 : 1));
+    }
+
+    if (order == particlesystem::RetireOrder::Stable) {
+        REQUIRE(std::ranges::is_sorted(store.getPosition(),
+                                       [](glm::vec2 a, glm::vec2 b) { return a.x < b.x; }));
+    }
+
+    SECTION("Retiring again should not remove anything") {
+        REQUIRE(store.retireExpired(4.0f, order) == 0);
+        REQUIRE(store.size() == expired.size() - expiredCount);
+    }
+}
+
+TEST_CASE("Retiring a fully expired store", "[ParticleStore]") {
+    particlesystem::ParticleStore store;
+    for (int i = 0; i < 1000; ++i) {
+        store.push(Particle(glm::vec2{0.0f, 0.0f}));
+    }
+    store.updateLifetime(5.0);
+
+    REQUIRE(store.retireExpired(4.0f) == 1000);
+    REQUIRE(store.empty());
+    REQUIRE(store.capacity() >= 1000);
+}
+
+SCENARIO("Particle pool overflow", "[ParticlePool]") {
+    GIVEN("A full pool with a capacity of 100 particles") {
+        const auto policy = GENERATE(particlesystem::OverflowPolicy::DropNewest,
+                                     particlesystem::OverflowPolicy::RecycleOldest,
+                                     particlesystem::OverflowPolicy::Grow);
+        particlesystem::ParticlePool pool{100, policy};
+
+        // The particle spawned i:th is identified by its x position and is the oldest
+        // when i is small
+        for (int i = 0; i < 100; ++i) {
+            REQUIRE(pool.spawn(Particle(glm::vec2{static_cast<float>(i), 0.0f})));
+            pool.particles().updateLifetime(1.0);
+        }
+        REQUIRE(pool.size() == 100);
+
+        WHEN("10 more particles are spawned") {
+            for (int i = 100; i < 110; ++i) {
+                pool.spawn(Particle(glm::vec2{static_cast<float>(i), 0.0f}));
+            }
+            auto ids = pool.particles().getPosition();
+            auto hasId = [&](float id) {
+                return std::ranges::any_of(ids, [&](glm::vec2 p) { return p.x == id; });
+            };
+
+            THEN("The policy decides which particles are kept") {
+                switch (policy) {
+                    case particlesystem::OverflowPolicy::DropNewest:
+                        REQUIRE(pool.size() == 100);
+                        REQUIRE(pool.capacity() == 100);
+                        REQUIRE(pool.getOverflowCount() == 10);
+                        REQUIRE(!hasId(105.0f));
+                        REQUIRE(hasId(0.0f));
+                        break;
+                    case particlesystem::OverflowPolicy::RecycleOldest:
+                        REQUIRE(pool.size() == 100);
+                        REQUIRE(pool.capacity() == 100);
+                        REQUIRE(pool.getOverflowCount() == 10);
+                        for (int i = 0; i < 10; ++i) {
+                            REQUIRE(!hasId(static_cast<float>(i)));
+                        }
+                        for (int i = 10; i < 110; ++i) {
+                            REQUIRE(hasId(static_cast<float>(i)));
+                        }
+                        break;
+                    case particlesystem::OverflowPolicy::Grow:
+                        REQUIRE(pool.size() == 110);
+                        REQUIRE(pool.capacity() >= 110);
+                        REQUIRE(pool.getOverflowCount() == 0);
+                        break;
+                }
+            }
+        }
+
+        WHEN("More particles than the capacity are acquired at once") {
+            const size_t first = pool.acquire(250);
+
+            THEN("The pool never exceeds its capacity unless it may grow") {
+                if (policy == particlesystem::OverflowPolicy::Grow) {
+                    REQUIRE(pool.size() == 350);
+                } else {
+                    REQUIRE(pool.size() == 100);
+                }
+                if (policy == particlesystem::OverflowPolicy::RecycleOldest) {
+                    REQUIRE(first == 0);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Particle pool does not allocate in steady state", "[ParticlePool]") {
+    const auto policy = GENERATE(particlesystem::OverflowPolicy::DropNewest,
+                                 particlesystem::OverflowPolicy::RecycleOldest);
+
+    // Emits 20 particles per frame that live for 4 seconds at 60 frames per second, which is
+    // more than the pool can hold
+    particlesystem::ParticlePool pool{2'000, policy};
+    Uniform uniform;
+    Directional directional;
+    GravityWell well;
+    Wind wind;
+    std::vector<Effect*> effects = {&well, &wind};
+    particlesystem::Scheduler scheduler{4};
+    const double dt = 1.0 / 60.0;
+
+    auto simulateFrame = [&]() {
+        for (int i = 0; i < 10; ++i) {
+            pool.spawn(uniform.createParticle());
+            pool.spawn(directional.createParticle());
+        }
+        particlesystem::ParticleStore& particles = pool.particles();
+        particlesystem::applyEffects(effects, particles, scheduler);
+        particles.updateLifetime(dt);
+        pool.retireExpired(4.0f);
+        particlesystem::integrate(particles, dt, scheduler);
+    };
+
+    const size_t before = allocationcounter::getCount();
+    for (int frame = 0; frame < 10'000; ++frame) {
+        simulateFrame();
+    }
+    const size_t allocations = allocationcounter::getCount() - before;
+
+    REQUIRE(allocations == 0);
+    REQUIRE(pool.size() <= pool.capacity());
+    REQUIRE(pool.getOverflowCount() > 0);
+}
+
+TEST_CASE("Scheduler covers every element exactly once", "[Scheduler]") {
+    const size_t threads = GENERATE(1, 2, 3, 8);
+    const auto mode = GENERATE(particlesystem::Scheduler::Mode::WorkStealing,
+                               particlesystem::Scheduler::Mode::Deterministic);
+    const size_t count = GENERATE(0, 1, 17, 4096, 100'003);
+    particlesystem::Scheduler scheduler{threads, mode};
+    REQUIRE(scheduler.getThreadCount() == threads);
+
+    std::vector<std::atomic<int>> visits(count);
+    std::atomic<bool> alignedChunks = true;
+    scheduler.parallelFor(count, [&](size_t begin, size_t end) {
+        if (begin % particlesystem::Scheduler::ChunkAlignment != 0) alignedChunks = false;
+        for (size_t i = begin; i < end; ++i) {
+            visits[i]++;
+        }
+    });
+
+    REQUIRE(alignedChunks);
+    REQUIRE(std::ranges::all_of(visits, [](const std::atomic<int>& v) { return v == 1; }));
+}
+
+TEST_CASE("Deterministic scheduling is independent of the thread count", "[Scheduler]") {
+    auto simulate = [](size_t threads) {
+        particlesystem::Scheduler scheduler{threads,
+                                            particlesystem::Scheduler::Mode::Deterministic};
+        particlesystem::ParticleStore particles;
+        for (int i = 0; i < 20'000; ++i) {
+            const float x = static_cast<float>(i % 200) / 100.0f - 1.0f;
+            const float y = static_cast<float>(i / 200) / 50.0f - 1.0f;
+            particles.push(Particle(glm::vec2{x, y}, 0.0f, 0.0f));
+        }
+        GravityWell well;
+        Wind wind;
+        wind.position = {-0.5f, 0.3f};
+        std::vector<Effect*> effects = {&well, &wind};
+        for (int frame = 0; frame < 10; ++frame) {
+            particlesystem::applyEffects(effects, particles, scheduler);
+            particlesystem::integrate(particles, 1.0 / 60.0, scheduler);
+        }
+        return std::vector<glm::vec2>(particles.getPosition().begin(),
+                                      particles.getPosition().end());
+    };
+
+    const std::vector<glm::vec2> reference = simulate(1);
+    for (size_t threads : {2, 3, 16}) {
+        REQUIRE(std::ranges::equal(simulate(threads), reference));
+    }
+}
+
+TEST_CASE("Radial force kernels", "[Kernels]") {
+    const particlesystem::SimdLevel detected = particlesystem::detectSimdLevel();
+    const auto level = GENERATE(particlesystem::SimdLevel::Scalar, particlesystem::SimdLevel::SSE2,
+                                particlesystem::SimdLevel::AVX2);
+    // Levels that the CPU does not support would silently fall back to a lower one
+    if (level > detected) return;
+
+    // An odd number of particles so that the scalar tail of the SIMD kernels is exercised
+    std::vector<glm::vec2> positions;
+    for (int i = 0; i < 1001; ++i) {
+        const float t = static_cast<float>(i);
+        positions.push_back({std::cos(t) * (0.1f + t / 1000.0f), std::sin(t) * 0.7f});
+    }
+    std::vector<glm::vec2> accelerations(positions.size(), glm::vec2{0.5f, -0.25f});
+    std::vector<glm::vec2> expected = accelerations;
+
+    const glm::vec2 center = {0.2f, 0.1f};
+    const float force = 0.05f;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        // The original GravityWell formulation
+        const float dx = center.x - positions[i].x;
+        const float dy = center.y - positions[i].y;
+        const float length = std::sqrt(std::pow(dx, 2.0f) + std::pow(dy, 2.0f));
+        const float strength = force / (length * 5);
+        expected[i].x += strength * dx / length;
+        expected[i].y += strength * dy / length;
+    }
+
+    particlesystem::setSimdLevel(level);
+    REQUIRE(particlesystem::getSimdLevel() == level);
+    particlesystem::accumulateRadialForce(positions, accelerations, center, force / 5.0f);
+    particlesystem::setSimdLevel(detected);
+
+    using Catch::Matchers::WithinRel;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        REQUIRE_THAT(accelerations[i].x, WithinRel(expected[i].x, 1e-5f));
+        REQUIRE_THAT(accelerations[i].y, WithinRel(expected[i].y, 1e-5f));
+    }
+}
+
+TEST_CASE("Integration kernels", "[Kernels]") {
+    const particlesystem::SimdLevel detected = particlesystem::detectSimdLevel();
+    const auto level = GENERATE(particlesystem::SimdLevel::SSE2, particlesystem::SimdLevel::AVX2);
+    if (level > detected) return;
+
+    // Runs a Runge-Kutta step and a Verlet step at the given level, an odd number of particles
+    // exercises the scalar tail
+    auto run = [](particlesystem::SimdLevel simd) {
+        std::vector<std::vector<glm::vec2>> arrays(8, std::vector<glm::vec2>(37));
+        for (size_t i = 0; i < 37; ++i) {
+            for (size_t k = 0; k < 4; ++k) {
+                const float t = static_cast<float>(i * 4 + k);
+                arrays[k][i] = {std::sin(t), std::cos(0.7f * t)};
+            }
+        }
+        std::vector<glm::vec2>& x = arrays[0];
+        std::vector<glm::vec2>& v = arrays[1];
+        const std::vector<glm::vec2>& a = arrays[2];
+        const std::vector<glm::vec2>& f = arrays[3];
+        std::vector<glm::vec2>& xs = arrays[4];
+        std::vector<glm::vec2>& vs = arrays[5];
+        std::vector<glm::vec2>& dx = arrays[6];
+        std::vector<glm::vec2>& dv = arrays[7];
+        particlesystem::setSimdLevel(simd);
+        particlesystem::rungeKuttaBegin(x, v, a, f, xs, vs, dx, dv, 0.1f, 0.2f);
+        particlesystem::rungeKuttaStage(x, v, a, f, xs, vs, dx, dv, 0.3f, 0.4f);
+        particlesystem::rungeKuttaEnd(x, v, a, f, vs, dx, dv, 0.5f);
+        particlesystem::kickDrift(x, v, a, f, 0.25f, 0.5f);
+        particlesystem::kick(v, a, f, 0.25f);
+        return arrays;
+    };
+
+    const auto expected = run(particlesystem::SimdLevel::Scalar);
+    const auto actual = run(level);
+    particlesystem::setSimdLevel(detected);
+    using Catch::Matchers::WithinAbs;
+    for (size_t k = 0; k < expected.size(); ++k) {
+        for (size_t i = 0; i < expected[k].size(); ++i) {
+            REQUIRE_THAT(actual[k][i].x, WithinAbs(expected[k][i].x, 1e-6));
+            REQUIRE_THAT(actual[k][i].y, WithinAbs(expected[k][i].y, 1e-6));
+        }
+    }
+}
+
+// Compare the kernel implementations, run using: ./unittest "[benchmark]"
+TEST_CASE("Benchmark radial force kernels", "[.benchmark]") {
+    std::vector<glm::vec2> positions(1'000'000, glm::vec2{0.3f, 0.4f});
+    std::vector<glm::vec2> accelerations(positions.size());
+    const particlesystem::SimdLevel detected = particlesystem::detectSimdLevel();
+
+    for (auto level : {particlesystem::SimdLevel::Scalar, particlesystem::SimdLevel::SSE2,
+                       particlesystem::SimdLevel::AVX2}) {
+        if (level > detected) continue;
+        particlesystem::setSimdLevel(level);
+        BENCHMARK(fmt::format("1'000'000 particles {}", particlesystem::toString(level))) {
+            particlesystem::accumulateRadialForce(positions, accelerations, {0.0f, 0.0f}, 0.01f);
+        };
+    }
+    particlesystem::setSimdLevel(detected);
+}
+
+namespace {
+// An effect that only supports being applied through effectParticle
+class ConstantPush : public Effect {
+public:
+    void effectParticle(std::span<const glm::vec2> positions,
+                        std::span<glm::vec2> accelerations) override {
+        for (size_t i = 0; i < positions.size(); ++i) {
+            accelerations[i].y -= 0.1f;
+        }
+    }
+};
+}  // namespace
+
+TEST_CASE("Fused effect evaluation", "[EffectTable]") {
+    std::vector<GravityWell> wells(20);
+    std::vector<Wind> winds(10);
+    ConstantPush push;
+    std::vector<Effect*> effects;
+    for (size_t i = 0; i < 20; ++i) {
+        wells[i].position = {std::cos(static_cast<float>(i)), std::sin(static_cast<float>(i))};
+        effects.push_back(&wells[i]);
+        if (i < winds.size()) {
+            winds[i].position = {0.5f * std::sin(static_cast<float>(i)), 0.3f};
+            effects.push_back(&winds[i]);
+        }
+    }
+    effects.push_back(&push);
+
+    particlesystem::EffectTable table;
+    table.build(effects);
+    REQUIRE(table.getRadial().size() == 30);
+
+    particlesystem::ParticleStore separate;
+    for (int i = 0; i < 1000; ++i) {
+        const float t = static_cast<float>(i) * 0.01f;
+        separate.push(Particle(glm::vec2{std::cos(t) * t, 0.8f * std::sin(t)}, 0.0f, 0.0f));
+    }
+    particlesystem::ParticleStore fused = separate;
+
+    particlesystem::Scheduler scheduler{2};
+    particlesystem::applyEffects(effects, separate, scheduler);
+    particlesystem::applyEffects(table, fused, scheduler);
+
+    using Catch::Matchers::WithinAbs;
+    for (size_t i = 0; i < separate.size(); ++i) {
+        const glm::vec2 expected = separate.getForce()[i];
+        REQUIRE_THAT(fused.getForce()[i].x, WithinAbs(expected.x, 1e-4));
+        REQUIRE_THAT(fused.getForce()[i].y, WithinAbs(expected.y, 1e-4));
+    }
+
+    SECTION("Rebuilding replaces the previous contents") {
+        table.build(std::span<Effect* const>(effects).first(3));
+        REQUIRE(table.getRadial().size() == 3);
+        table.build({});
+        REQUIRE(table.empty());
+    }
+}
+
+TEST_CASE("Spatial grid neighbour queries", "[SpatialGrid]") {
+    // Points spread over an area much larger than the cells, including negative coordinates
+    std::vector<glm::vec2> positions;
+    for (int i = 0; i < 5000; ++i) {
+        const float t = static_cast<float>(i);
+        positions.push_back({3.0f * std::sin(t * 1.3f), 2.0f * std::cos(t * 0.7f) - 0.5f});
+    }
+    particlesystem::SpatialGrid grid{0.1f};
+    grid.build(positions);
+    REQUIRE(grid.size() == positions.size());
+
+    const float radius = GENERATE(0.0f, 0.05f, 0.3f, 1.0f, 100.0f);
+    for (glm::vec2 center : {glm::vec2{0.0f, 0.0f}, glm::vec2{-2.5f, 1.0f}, positions[42]}) {
+        std::vector<uint32_t> found;
+        grid.query(positions, center, radius, found);
+        std::ranges::sort(found);
+
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < positions.size(); ++i) {
+            const glm::vec2 d = positions[i] - center;
+            if (d.x * d.x + d.y * d.y <= radius * radius) expected.push_back(i);
+        }
+
+        REQUIRE(found == expected);
+
+        // Disjoint bucket ranges report every particle exactly once
+        std::vector<uint32_t> split;
+        const uint32_t step = grid.getBucketCount() / 3 + 1;
+        for (uint32_t begin = 0; begin < grid.getBucketCount(); begin += step) {
+            const uint32_t end = std::min(begin + step, grid.getBucketCount());
+            grid.forEachNeighbour(positions, center, radius, begin, end,
+                                  [&](uint32_t index) { split.push_back(index); });
+        }
+        std::ranges::sort(split);
+        REQUIRE(split == expected);
+    }
+}
+
+TEST_CASE("Effects with a limited range", "[SpatialGrid]") {
+    GravityWell well;
+    well.position = {0.1f, 0.2f};
+    well.influenceRadius = 0.4f;
+    Wind wind;
+    wind.position = {-0.3f, 0.0f};
+    wind.influenceRadius = 0.25f;
+    GravityWell unlimited;
+    std::vector<Effect*> effects = {&well, &wind, &unlimited};
+
+    particlesystem::ParticleStore viaGrid;
+    for (int i = 0; i < 2000; ++i) {
+        const float t = static_cast<float>(i) * 0.37f;
+        viaGrid.push(Particle(glm::vec2{std::sin(t), 0.9f * std::cos(1.1f * t)}, 0.0f, 0.0f));
+    }
+    particlesystem::ParticleStore viaEffects = viaGrid;
+
+    particlesystem::EffectTable table;
+    table.build(effects);
+    REQUIRE(table.hasLocal());
+    particlesystem::Scheduler scheduler{2};
+    particlesystem::SpatialGrid grid;
+    particlesystem::applyEffects(table, viaGrid, scheduler, grid);
+    particlesystem::applyEffects(effects, viaEffects, scheduler);
+
+    using Catch::Matchers::WithinAbs;
+    size_t outside = 0;
+    for (size_t i = 0; i < viaGrid.size(); ++i) {
+        const glm::vec2 expected = viaEffects.getForce()[i];
+        REQUIRE_THAT(viaGrid.getForce()[i].x, WithinAbs(expected.x, 1e-4));
+        REQUIRE_THAT(viaGrid.getForce()[i].y, WithinAbs(expected.y, 1e-4));
+        if (glm::distance(viaGrid.getPosition()[i], well.position) > well.influenceRadius) {
+            outside++;
+        }
+    }
+    REQUIRE(outside > 0);
+}
+
+TEST_CASE("Emission rate is independent of the frame rate", "[Emitter]") {
+    const float dt = GENERATE(0.001f, 0.25f, 1.0f / 60.0f);
+    Uniform uniform;
+    uniform.rate = 40.0f;
+    particlesystem::ParticleStore particles;
+
+    float time = 0.0f;
+    while (time + dt <= 10.0f) {
+        uniform.emit(dt, particles);
+        time += dt;
+    }
+
+    // The fractional remainder is carried over, so at most one particle may still be pending
+    REQUIRE(particles.size() >= static_cast<size_t>(uniform.rate * time) - 1);
+    REQUIRE(particles.size() <= static_cast<size_t>(uniform.rate * time) + 1);
+}
+
+SCENARIO("Batched emission", "[Emitter]") {
+    GIVEN("An empty store") {
+        particlesystem::ParticleStore particles;
+
+        WHEN("A directional emitter emits a batch") {
+            Directional directional;
+            directional.position = {0.3f, -0.2f};
+            directional.changeDirValues({1.0f, 0.5f});
+            directional.rate = 10'000.0f;
+            directional.emit(1.0f, particles);
+
+            THEN("Every particle is emitted from the emitter within its direction") {
+                REQUIRE(particles.size() == 10'000);
+                REQUIRE(std::ranges::all_of(particles.getPosition(), [&](glm::vec2 p) {
+                    return p == directional.position;
+                }));
+                REQUIRE(std::ranges::all_of(particles.getLifetime(),
+                                            [](float age) { return age == 0.0f; }));
+                REQUIRE(std::ranges::all_of(particles.getAcceleration(), [](glm::vec2 a) {
+                    const float theta = std::atan2(a.y, a.x);
+                    return theta >= 1.0f - 1e-4f && theta <= 1.5f + 1e-4f;
+                }));
+            }
+        }
+
+        WHEN("A uniform emitter emits a batch") {
+            Uniform uniform;
+            uniform.rate = 1000.0f;
+            uniform.emit(1.0f, particles);
+
+            THEN("The particles have the same attributes as single created particles") {
+                const Particle reference = uniform.createParticle();
+                REQUIRE(particles.size() == 1000);
+                REQUIRE(std::ranges::all_of(particles.getRadius(),
+                                            [&](float r) { return r == reference.radius; }));
+                REQUIRE(std::ranges::all_of(particles.getColor(),
+                                            [&](glm::vec4 c) { return c == reference.color; }));
+                REQUIRE(std::ranges::all_of(particles.getAcceleration(), [](glm::vec2 a) {
+                    return std::abs(glm::length(a) - 1.0f) < 1e-5f;
+                }));
+            }
+        }
+
+        WHEN("A spinner emits two batches") {
+            Spinner spinner;
+            spinner.rate = 100.0f;
+            spinner.spinSpeed = 1.0f;
+            spinner.emit(0.5f, particles);
+            spinner.emit(0.5f, particles);
+
+            THEN("The emission direction rotates with the emitted particles") {
+                REQUIRE(particles.size() == 100);
+                REQUIRE_THAT(spinner.direction, Catch::Matchers::WithinAbs(1.0f, 1e-4));
+                const auto acc = particles.getAcceleration();
+                for (size_t i = 1; i < acc.size(); ++i) {
+                    REQUIRE(std::atan2(acc[i].y, acc[i].x) >
+                            std::atan2(acc[i - 1].y, acc[i - 1].x));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Emitting into a full pool", "[Emitter]") {
+    particlesystem::ParticlePool pool{500};
+    Uniform uniform;
+    uniform.rate = 2000.0f;
+
+    REQUIRE(pool.emit(uniform, 0.1f) == 200);
+    REQUIRE(pool.emit(uniform, 0.5f) == 300);
+    REQUIRE(pool.size() == 500);
+    REQUIRE(pool.getOverflowCount() == 700);
+}
+
+TEST_CASE("Emitting from several emitters into a full pool", "[Emitter]") {
+    particlesystem::ParticleSystem::Settings settings;
+    settings.capacity = 100;
+    settings.overflowPolicy = particlesystem::OverflowPolicy::RecycleOldest;
+    particlesystem::ParticleSystem system{settings};
+    // Each emitter emits 75 particles per step, far enough apart to tell their particles apart
+    Uniform left;
+    left.rate = 4500.0f;
+    left.position = {-10.0f, 0.0f};
+    Uniform right = left;
+    right.position = {10.0f, 0.0f};
+    system.addEmitter(left);
+    system.addEmitter(right);
+    const double dt = 1.0 / 60.0;
+
+    for (int i = 0; i < 3; ++i) {
+        system.step(dt);
+        // Only the newest particles of the step are kept, like for a single emitter
+        const auto positions = system.particles().getPosition();
+        REQUIRE(positions.size() == 100);
+        REQUIRE(std::ranges::count_if(positions, [](glm::vec2 p) { return p.x < 0.0f; }) == 25);
+        REQUIRE(std::ranges::all_of(system.particles().getLifetime(),
+                                    [&](float age) { return age < 1.5 * dt; }));
+    }
+    REQUIRE(system.getPool().getOverflowCount() > 0);
+}
+
+TEST_CASE("Philox matches the reference implementation", "[Random]") {
+    // Known answer tests from the Random123 library
+    using particlesystem::philox4x32;
+    REQUIRE(philox4x32({0, 0, 0, 0}, {0, 0}) ==
+            std::array<uint32_t, 4>{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8});
+    REQUIRE(philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                       {0xffffffff, 0xffffffff}) ==
+            std::array<uint32_t, 4>{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd});
+    REQUIRE(philox4x32({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+                       {0xa4093822, 0x299f31d0}) ==
+            std::array<uint32_t, 4>{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1});
+}
+
+SCENARIO("Random streams", "[Random]") {
+    GIVEN("Two streams with the same seed and id") {
+        particlesystem::RandomStream a{1234, 7};
+        particlesystem::RandomStream b{1234, 7};
+
+        WHEN("One is drawn from value by value and the other in uneven batches") {
+            std::vector<float> single(1000);
+            for (float& value : single) {
+                value = a.uniform(-2.0f, 3.0f);
+            }
+            std::vector<float> batched(1000);
+            const size_t splits[] = {0, 3, 4, 17, 400, 401, 1000};
+            for (size_t i = 0; i + 1 < std::size(splits); ++i) {
+                b.fillUniform(std::span(batched).subspan(splits[i], splits[i + 1] - splits[i]),
+                              -2.0f, 3.0f);
+            }
+
+            THEN("They produce the same sequence") {
+                REQUIRE(single == batched);
+                REQUIRE(a.getPosition() == 1000);
+                REQUIRE(b.getPosition() == 1000);
+                REQUIRE(std::ranges::all_of(single,
+                                            [](float v) { return v >= -2.0f && v <= 3.0f; }));
+            }
+        }
+    }
+
+    GIVEN("A stream that seeks to a position") {
+        particlesystem::RandomStream drawn{1234, 3};
+        particlesystem::RandomStream seeking{1234, 3};
+
+        THEN("It continues like a stream that drew up to that position") {
+            for (uint64_t position : {uint64_t{0}, uint64_t{5}, uint64_t{8}, uint64_t{1003}}) {
+                drawn.reset();
+                for (uint64_t i = 0; i < position; ++i) drawn.nextUInt();
+                seeking.seek(position);
+                REQUIRE(seeking.getPosition() == position);
+                for (int i = 0; i < 10; ++i) {
+                    REQUIRE(seeking.nextUInt() == drawn.nextUInt());
+                }
+            }
+        }
+    }
+
+    GIVEN("Streams with different ids") {
+        particlesystem::RandomStream a{1234, 0};
+        particlesystem::RandomStream b{1234, 1};
+
+        THEN("They produce different sequences") {
+            size_t equal = 0;
+            for (int i = 0; i < 1000; ++i) {
+                equal += a.nextUInt() == b.nextUInt();
+            }
+            REQUIRE(equal < 3);
+        }
+    }
+
+    GIVEN("A stream of uniform floats") {
+        particlesystem::RandomStream stream{42};
+        std::vector<float> values(100'000);
+        stream.fillUniform(values, 0.0f, 1.0f);
+
+        THEN("The values are evenly spread over [0, 1)") {
+            std::array<size_t, 10> histogram{};
+            double sum = 0.0;
+            for (float v : values) {
+                REQUIRE(v >= 0.0f);
+                REQUIRE(v < 1.0f);
+                histogram[static_cast<size_t>(v * 10.0f)]++;
+                sum += v;
+            }
+            REQUIRE_THAT(sum / static_cast<double>(values.size()),
+                         Catch::Matchers::WithinAbs(0.5, 0.01));
+            for (size_t count : histogram) {
+                REQUIRE(count > 9'500);
+                REQUIRE(count < 10'500);
+            }
+        }
+    }
+}
+
+TEST_CASE("Emitters are reproducible from the master seed", "[Random]") {
+    auto emitAll = [](uint64_t seed) {
+        particlesystem::setMasterSeed(seed);
+        Uniform first;
+        Directional second;
+        second.changeDirValues({0.0f, 3.0f});
+        particlesystem::ParticleStore particles;
+        for (int frame = 0; frame < 10; ++frame) {
+            first.emit(0.1f, particles);
+            second.emit(0.1f, particles);
+        }
+        const auto acc = particles.getAcceleration();
+        return std::vector<glm::vec2>(acc.begin(), acc.end());
+    };
+
+    const std::vector<glm::vec2> run = emitAll(99);
+    REQUIRE(run.size() == 1000);
+    REQUIRE(emitAll(99) == run);
+    REQUIRE(emitAll(100) != run);
+
+    particlesystem::setMasterSeed(particlesystem::DefaultMasterSeed);
+}
+
+TEST_CASE("Thread streams are disjoint", "[Random]") {
+    particlesystem::setMasterSeed(5);
+    const uint32_t mainValue = particlesystem::threadStream().nextUInt();
+    uint32_t otherValue = 0;
+    uint64_t otherStream = 0;
+    std::thread other([&] {
+        otherValue = particlesystem::threadStream().nextUInt();
+        otherStream = particlesystem::threadStream().getStream();
+    });
+    other.join();
+
+    REQUIRE(otherStream != particlesystem::threadStream().getStream());
+    REQUIRE(otherValue != mainValue);
+    REQUIRE(particlesystem::threadStream().getSeed() == 5);
+
+    particlesystem::setMasterSeed(particlesystem::DefaultMasterSeed);
+}
+
+SCENARIO("Fixed timestep simulation clock", "[SimulationClock]") {
+    GIVEN("A clock running at 64 steps per second with at most 4 steps per frame") {
+        particlesystem::SimulationClock clock(64.0, 4);
+        const double step = 1.0 / 64.0;
+
+        THEN("Frames shorter than a step do not simulate anything") {
+            REQUIRE(clock.advance(0.25 * step) == 0);
+            REQUIRE(clock.advance(0.25 * step) == 0);
+            REQUIRE(clock.getAlpha() == 0.5f);
+            REQUIRE(clock.advance(0.5 * step) == 1);
+            REQUIRE(clock.getAlpha() == 0.0f);
+        }
+
+        THEN("The number of steps does not depend on how the time is split into frames") {
+            particlesystem::SimulationClock other(64.0, 8);
+            int steps = 0;
+            for (int i = 0; i < 100; ++i) {
+                steps += clock.advance(0.01);
+            }
+            for (int i = 0; i < 10; ++i) {
+                other.advance(0.1);
+            }
+            REQUIRE(steps == 64);
+            REQUIRE(clock.getTickCount() == 64);
+            REQUIRE(other.getTickCount() == 64);
+            REQUIRE_THAT(clock.getAlpha(), Catch::Matchers::WithinAbs(other.getAlpha(), 1e-4));
+        }
+
+        WHEN("A frame takes much longer than the step limit") {
+            const int steps = clock.advance(10.5 * step);
+
+            THEN("The steps are capped and the excess time is dropped") {
+                REQUIRE(steps == 4);
+                REQUIRE_THAT(clock.getDroppedTime(), Catch::Matchers::WithinAbs(6.0 * step, 1e-9));
+                REQUIRE_THAT(clock.getAlpha(), Catch::Matchers::WithinAbs(0.5, 1e-4));
+                REQUIRE(clock.advance(0.0) == 0);
+            }
+        }
+
+        THEN("Negative time is ignored") {
+            REQUIRE(clock.advance(-1.0) == 0);
+            REQUIRE(clock.getAlpha() == 0.0f);
+        }
+    }
+}
+
+TEST_CASE("Interpolating particle positions", "[ParticleStore]") {
+    particlesystem::ParticlePool pool(16);
+    particlesystem::ParticleStore& store = pool.particles();
+    for (int i = 0; i < 4; ++i) {
+        Particle particle(glm::vec2{static_cast<float>(i), 0.0f});
+        particle.velocity = {0.0f, 1.0f};
+        particle.acceleration = {0.0f, 0.0f};
+        particle.lifetime = static_cast<float>(i);
+        store.push(particle);
+    }
+
+    store.storePreviousPosition();
+    store.updatePosition(1.0);
+    // Particle 0 is the oldest and gets replaced, the previous position moves along with it
+    pool.retireExpired(2.5f);
+
+    std::vector<glm::vec2> position(store.size());
+    store.interpolatePosition(0.25f, position);
+    REQUIRE(store.size() == 3);
+    for (size_t i = 0; i < store.size(); ++i) {
+        const glm::vec2 current = store.getPosition()[i];
+        REQUIRE(store.getPreviousPosition()[i] == current - glm::vec2{0.0f, 1.0f});
+        REQUIRE(position[i] == current - glm::vec2{0.0f, 0.75f});
+    }
+
+    SECTION("New particles start at their emitted position") {
+        Uniform emitter;
+        emitter.position = {0.5f, 0.5f};
+        pool.emit(emitter, 1.0f);
+        position.resize(store.size());
+        store.interpolatePosition(0.5f, position);
+        REQUIRE(store.size() > 3);
+        REQUIRE(position.back() == emitter.position);
+    }
+}
+
+TEST_CASE("Pipelined simulation matches serial simulation", "[Pipeline]") {
+    // Runs a few frames and returns the positions drawn in each of them
+    auto run = [](particlesystem::SimulationPipeline::Mode mode) {
+        particlesystem::ParticlePool pool(10'000);
+        particlesystem::Scheduler scheduler(2);
+        particlesystem::setMasterSeed(7);
+        Uniform emitter;
+        particlesystem::SimulationPipeline pipeline(
+            [&](particlesystem::ParticleSnapshot& snapshot) {
+                pool.particles().storePreviousPosition();
+                pool.emit(emitter, 0.01f);
+                particlesystem::integrate(pool.particles(), 0.01, scheduler);
+                snapshot.capture(pool.particles(), 0.5f);
+            },
+            mode);
+
+        std::vector<std::vector<glm::vec2>> frames;
+        for (uint64_t frame = 0; frame < 10; ++frame) {
+            const particlesystem::ParticleSnapshot& snapshot = pipeline.sync();
+            REQUIRE(snapshot.frame == frame);
+            // The emitter belongs to this thread between sync and launch
+            emitter.position.x += 0.01f;
+            pipeline.launch();
+
+            std::vector<glm::vec2> position(snapshot.size());
+            snapshot.interpolatePosition(position);
+            frames.push_back(std::move(position));
+        }
+        return frames;
+    };
+
+    const auto serial = run(particlesystem::SimulationPipeline::Mode::Serial);
+    const auto pipelined = run(particlesystem::SimulationPipeline::Mode::Pipelined);
+    REQUIRE(serial.size() == 10);
+    REQUIRE(serial.back().size() > 0);
+    REQUIRE(serial == pipelined);
+}
+
+TEST_CASE("Errors in a pipelined step", "[Pipeline]") {
+    const auto mode = GENERATE(particlesystem::SimulationPipeline::Mode::Serial,
+                               particlesystem::SimulationPipeline::Mode::Pipelined);
+    int calls = 0;
+    particlesystem::SimulationPipeline pipeline(
+        [&](particlesystem::ParticleSnapshot&) {
+            if (++calls == 2) throw std::runtime_error("step failed");
+        },
+        mode);
+
+    pipeline.launch();
+    REQUIRE(pipeline.sync().frame == 1);
+    pipeline.launch();
+    REQUIRE_THROWS_AS(pipeline.sync(), std::runtime_error);
+    REQUIRE(pipeline.front().frame == 1);
+    pipeline.launch();
+    REQUIRE(pipeline.sync().frame == 3);
+}
+
+SCENARIO("Slot map handles", "[SlotMap]") {
+    GIVEN("A slot map with three values") {
+        particlesystem::SlotMap<int> map;
+        const auto a = map.insert(1);
+        const auto b = map.insert(2);
+        const auto c = map.insert(3);
+
+        WHEN("A value in the middle is removed") {
+            REQUIRE(map.erase(a));
+
+            THEN("The other handles still refer to their values and the storage stays dense") {
+                REQUIRE(map.size() == 2);
+                REQUIRE(*map.get(b) == 2);
+                REQUIRE(*map.get(c) == 3);
+                REQUIRE(map.get(a) == nullptr);
+                REQUIRE(std::ranges::is_permutation(map.values(), std::vector{2, 3}));
+            }
+
+            THEN("The old handle does not refer to a value added in its slot") {
+                const auto d = map.insert(4);
+                REQUIRE(d.index == a.index);
+                REQUIRE_FALSE(map.contains(a));
+                REQUIRE_FALSE(map.erase(a));
+                REQUIRE(*map.get(d) == 4);
+            }
+
+            THEN("The handles can be found from the dense storage") {
+                for (size_t i = 0; i < map.size(); ++i) {
+                    REQUIRE(*map.get(map.handleAt(i)) == map.values()[i]);
+                }
+            }
+        }
+
+        WHEN("The map is cleared") {
+            map.clear();
+
+            THEN("No handle is valid") {
+                REQUIRE(map.empty());
+                REQUIRE_FALSE(map.contains(a));
+                REQUIRE_FALSE(map.contains(b));
+                REQUIRE_FALSE(map.contains(c));
+            }
+        }
+    }
+}
+
+SCENARIO("Particle system", "[ParticleSystem]") {
+    GIVEN("A system with emitters and effects of different types") {
+        particlesystem::ParticleSystem::Settings settings;
+        settings.capacity = 10'000;
+        settings.threadCount = 2;
+        particlesystem::ParticleSystem system{settings};
+
+        const auto uniform = system.addEmitter<Uniform>();
+        Directional directionalEmitter;
+        directionalEmitter.position = {0.5f, 0.0f};
+        const auto directional = system.addEmitter(directionalEmitter);
+        const auto spinner = system.addEmitter<Spinner>();
+        const auto well = system.addEffect<GravityWell>();
+        system.addEffect<Wind>();
+
+        THEN("They are listed in the order they were added") {
+            REQUIRE(system.getEmitters().size() == 3);
+            REQUIRE(system.getEffects().size() == 2);
+            REQUIRE(system.getEmitters()[1] == particlesystem::EmitterHandle{directional});
+            REQUIRE(system.get(system.getEmitters()[1])->position == directionalEmitter.position);
+            REQUIRE(system.get(system.getEffects()[0]) == system.get(well));
+        }
+
+        WHEN("The system is stepped") {
+            for (int i = 0; i < 10; ++i) {
+                system.step(0.01);
+            }
+
+            THEN("Every emitter has emitted particles") {
+                REQUIRE(system.particles().size() == 3 * 10 * 5);
+            }
+        }
+
+        WHEN("An emitter is removed") {
+            REQUIRE(system.remove(particlesystem::EmitterHandle{uniform}));
+
+            THEN("Only its handle becomes invalid") {
+                REQUIRE(system.get(uniform) == nullptr);
+                REQUIRE_FALSE(system.remove(particlesystem::EmitterHandle{uniform}));
+                REQUIRE(system.get(directional)->position == directionalEmitter.position);
+                REQUIRE(system.get(spinner) != nullptr);
+                REQUIRE(system.getEmitters().size() == 2);
+                REQUIRE(system.all<Uniform>().empty());
+            }
+        }
+
+        WHEN("The system is updated with wall clock time") {
+            const int steps = system.update(5.5 / settings.tickRate);
+
+            THEN("Only whole fixed steps are run") {
+                REQUIRE(steps == 5);
+                REQUIRE(system.getClock().getTickCount() == 5);
+            }
+        }
+    }
+}
+
+namespace {
+
+// An effect that cannot be packed into the effect table
+class Drag : public Effect {
+public:
+    float strength = 0.5f;
+
+    void effectParticle(std::span<const glm::vec2>,
+                        std::span<glm::vec2> accelerations) override {
+        for (glm::vec2& acceleration : accelerations) {
+            acceleration *= 1.0f - strength;
+        }
+    }
+};
+
+// An emitter whose particles all start at rest in the emitter's position
+class Fountain : public Emitter {
+public:
+    Particle createParticle() override { return Particle(position, 0.0f); }
+    void generate(particlesystem::ParticleStore& out, size_t first, size_t count) override {
+        for (size_t i = first; i < first + count; ++i) {
+            out.set(i, createParticle());
+        }
+    }
+};
+
+// Counts the particles touched through the statically dispatched kernel
+size_t dragKernelCalls = 0;
+
+}  // namespace
+
+template <>
+struct particlesystem::EffectKernel<Drag> {
+    static bool pack(const Drag&, EffectTable&) { return false; }
+    static void apply(Drag& effect, std::span<const glm::vec2> positions,
+                      std::span<glm::vec2> accelerations) {
+        dragKernelCalls += positions.size();
+        effect.Drag::effectParticle(positions, accelerations);
+    }
+};
+
+TEST_CASE("Registering additional emitter and effect types", "[ParticleSystem]") {
+    using Registry = particlesystem::ExtendRegistry<particlesystem::DefaultRegistry,
+                                                    particlesystem::TypeList<Fountain>,
+                                                    particlesystem::TypeList<Drag>>;
+    static_assert(Registry::Emitters::size == 4 && Registry::Effects::size == 3);
+
+    particlesystem::BasicParticleSystem<Registry>::Settings settings;
+    settings.threadCount = 1;
+    particlesystem::BasicParticleSystem<Registry> system{settings};
+    system.addEmitter<Fountain>();
+    const auto drag = system.addEffect<Drag>();
+    system.addEffect<GravityWell>();
+
+    dragKernelCalls = 0;
+    system.step(0.01);
+    REQUIRE(system.particles().size() == 5);
+    REQUIRE(dragKernelCalls == 5);
+
+    // The unpacked effect runs after the packed ones, the same as through the effect table
+    particlesystem::ParticleStore expected;
+    for (int i = 0; i < 5; ++i) {
+        Particle particle({0.0f, 0.0f}, 0.0f);
+        expected.push(particle);
+    }
+    GravityWell well;
+    std::vector<Effect*> effects = {&well, system.get(drag)};
+    particlesystem::EffectTable table;
+    table.build(effects);
+    particlesystem::Scheduler scheduler(1);
+    particlesystem::applyEffects(table, expected, scheduler);
+    particlesystem::integrate(expected, 0.01, scheduler);
+    REQUIRE(std::ranges::equal(system.particles().getPosition(), expected.getPosition()));
+}
+
+TEST_CASE("Profiling zones", "[Profiler]") {
+    namespace profiling = particlesystem::profiling;
+    profiling::reset();
+
+    const profiling::ZoneId zone = profiling::registerZone("test zone");
+    REQUIRE(profiling::registerZone("test zone") == zone);
+
+    // Three frames of 1, 2 and 3 ms, the second one split over two threads
+    profiling::record(zone, std::chrono::milliseconds{1});
+    profiling::endFrame();
+    std::thread other([&] { profiling::record(zone, std::chrono::milliseconds{1}); });
+    profiling::record(zone, std::chrono::milliseconds{1});
+    other.join();
+    profiling::endFrame();
+    {
+        PARTICLESYSTEM_PROFILE_ZONE("test zone");
+        profiling::record(zone, std::chrono::milliseconds{3});
+    }
+    profiling::endFrame();
+
+    const std::vector<profiling::ZoneStats> stats = profiling::getStats();
+    const auto it = std::ranges::find(stats, "test zone", &profiling::ZoneStats::name);
+    REQUIRE(it != stats.end());
+    REQUIRE_THAT(it->mean, Catch::Matchers::WithinAbs(2.0, 0.1));
+    REQUIRE_THAT(it->min, Catch::Matchers::WithinAbs(1.0, 1e-6));
+    REQUIRE(it->last >= 3.0);
+    REQUIRE(it->max == it->last);
+    REQUIRE(profiling::sparkline("test zone", 5).size() == 5);
+    REQUIRE(profiling::sparkline("test zone", 5).back() == '@');
+
+    SECTION("Report") {
+        profiling::writeReport("profiler-test.csv");
+        std::ifstream file{"profiler-test.csv"};
+        std::string header, first;
+        std::getline(file, header);
+        std::getline(file, first);
+        file.close();
+        std::remove("profiler-test.csv");
+
+        REQUIRE(header.starts_with("frame,"));
+        REQUIRE(header.find("test zone") != std::string::npos);
+        REQUIRE(first.starts_with("0,"));
+    }
+}
+
+TEST_CASE("Snapshots", "[Snapshot]") {
+    const std::string path = "snapshot-test.psnap";
+    particlesystem::ParticleSystem::Settings settings;
+    settings.capacity = 10'000;
+    settings.maxLifetime = 0.5f;
+    settings.tickRate = 30.0;
+    particlesystem::ParticleSystem system{settings};
+
+    Directional directional;
+    directional.changeDirValues({1.0f, 0.5f});
+    directional.position = {0.2f, -0.1f};
+    system.addEmitter(Uniform{});
+    system.addEmitter(directional);
+    system.addEmitter(Spinner{});
+    GravityWell well;
+    well.force = 0.2f;
+    well.influenceRadius = 0.8f;
+    system.addEffect(well);
+    system.addEffect(Wind{});
+    for (int i = 0; i < 40; ++i) system.step(1.0 / 60.0);
+    REQUIRE(system.particles().size() > 0);
+
+    particlesystem::saveSnapshot(system, path);
+
+    SECTION("The chunks are aligned and map the saved attributes") {
+        const particlesystem::Snapshot snapshot{path};
+        REQUIRE(snapshot.getVersion() == particlesystem::SnapshotVersion);
+        for (const particlesystem::SnapshotChunk& chunk : snapshot.getChunks()) {
+            REQUIRE(chunk.offset % particlesystem::SnapshotAlignment == 0);
+        }
+        const auto position = snapshot.get<glm::vec2>(particlesystem::chunks::Position);
+        REQUIRE(reinterpret_cast<uintptr_t>(position.data()) % 64 == 0);
+        REQUIRE(std::ranges::equal(position, system.particles().getPosition()));
+        REQUIRE(snapshot.get<particlesystem::EmitterRecord>(particlesystem::chunks::Emitters)
+                    .size() == 3);
+        REQUIRE_THROWS_AS(snapshot.get<float>(particlesystem::chunks::Position),
+                          std::runtime_error);
+        REQUIRE_THROWS_AS(snapshot.get<float>(particlesystem::chunkId("NONE")), std::runtime_error);
+    }
+
+    SECTION("A restored system continues exactly like the saved one") {
+        particlesystem::ParticleSystem restored;
+        restored.addEmitter(Uniform{});
+        particlesystem::loadSnapshot(restored, path);
+        REQUIRE(restored.getEmitters().size() == 3);
+        REQUIRE(restored.getEffects().size() == 2);
+        REQUIRE(restored.getMaxLifetime() == 0.5f);
+        REQUIRE_THAT(restored.getClock().getTickRate(), Catch::Matchers::WithinAbs(30.0, 1e-9));
+        REQUIRE(restored.particles().size() == system.particles().size());
+
+        for (int i = 0; i < 40; ++i) {
+            system.step(1.0 / 60.0);
+            restored.step(1.0 / 60.0);
+        }
+        REQUIRE(std::ranges::equal(restored.particles().getPosition(),
+                                   system.particles().getPosition()));
+        REQUIRE(std::ranges::equal(restored.particles().getVelocity(),
+                                   system.particles().getVelocity()));
+        REQUIRE(std::ranges::equal(restored.particles().getLifetime(),
+                                   system.particles().getLifetime()));
+    }
+
+    SECTION("A small pool keeps the particles its policy asks for") {
+        const particlesystem::Snapshot snapshot{path};
+        const auto lifetime = snapshot.get<float>(particlesystem::chunks::Lifetime);
+        std::vector<float> youngest(lifetime.begin(), lifetime.end());
+        std::ranges::sort(youngest);
+        youngest.resize(10);
+
+        particlesystem::ParticlePool recycling{10, particlesystem::OverflowPolicy::RecycleOldest};
+        REQUIRE(particlesystem::readParticles(snapshot, recycling) == 10);
+        std::vector<float> kept(recycling.particles().getLifetime().begin(),
+                                recycling.particles().getLifetime().end());
+        std::ranges::sort(kept);
+        REQUIRE(kept == youngest);
+
+        particlesystem::ParticlePool dropping{10, particlesystem::OverflowPolicy::DropNewest};
+        REQUIRE(particlesystem::readParticles(snapshot, dropping) == 10);
+        REQUIRE(std::ranges::equal(dropping.particles().getLifetime(), lifetime.first(10)));
+    }
+
+    SECTION("Incomplete snapshots leave the system unchanged") {
+        {
+            const particlesystem::SystemRecord record = particlesystem::toRecord(system);
+            particlesystem::SnapshotWriter writer{path};
+            writer.write(particlesystem::chunks::System, std::span{&record, 1});
+            writer.write(particlesystem::chunks::Emitters,
+                         std::span<const particlesystem::EmitterRecord>{});
+            writer.write(particlesystem::chunks::Effects,
+                         std::span<const particlesystem::EffectRecord>{});
+            writer.finish();
+        }
+        const size_t particles = system.particles().size();
+        REQUIRE_THROWS_AS(particlesystem::loadSnapshot(system, path), std::runtime_error);
+        REQUIRE(system.getEmitters().size() == 3);
+        REQUIRE(system.getEffects().size() == 2);
+        REQUIRE(system.particles().size() == particles);
+    }
+
+    SECTION("Damaged files are rejected") {
+        std::string bytes;
+        {
+            std::ifstream file{path, std::ios::binary};
+            bytes.assign(std::istreambuf_iterator<char>{file}, {});
+        }
+        {
+            std::ofstream file{path, std::ios::binary | std::ios::trunc};
+            file.write(bytes.data(), static_cast<std::streamsize>(bytes.size() / 2));
+        }
+        REQUIRE_THROWS_AS(particlesystem::Snapshot{path}, std::runtime_error);
+        bytes[0] = 'X';
+        {
+            std::ofstream file{path, std::ios::binary | std::ios::trunc};
+            file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+        REQUIRE_THROWS_AS(particlesystem::Snapshot{path}, std::runtime_error);
+    }
+
+    std::remove(path.c_str());
+    REQUIRE_THROWS_AS(particlesystem::Snapshot{path}, std::runtime_error);
+}
+
+TEST_CASE("Recording and replaying a session", "[Recorder]") {
+    const std::string path = "recorder-test.psrec";
+    particlesystem::setMasterSeed(7);
+    std::vector<glm::vec2> recordedPositions;
+    uint64_t recordedSteps = 0;
+    // A small pool that overflows, so the replay has to recycle the same particles
+    particlesystem::ParticleSystem::Settings settings;
+    settings.capacity = 300;
+    settings.overflowPolicy = particlesystem::OverflowPolicy::RecycleOldest;
+    {
+        particlesystem::ParticleSystem system{settings};
+        system.addEmitter(Uniform{});
+        particlesystem::Recorder recorder;
+        recorder.start(path, system);
+        REQUIRE(recorder.isRecording());
+
+        // Uneven frame times and edits between the frames, like in the application
+        for (int frame = 0; frame < 120; ++frame) {
+            if (frame == 10) recorder.recordAdd(system, system.addEmitter<Directional>());
+            if (frame == 20) recorder.recordAdd(system, system.addEffect<GravityWell>());
+            if (frame == 30) {
+                const particlesystem::EmitterHandle handle = system.getEmitters()[1];
+                system.get(handle)->position = {0.5f, 0.5f};
+                recorder.recordEdit(system, handle);
+            }
+            if (frame == 40) {
+                system.getClock().setTickRate(90.0);
+                recorder.recordSettings(system);
+            }
+            if (frame == 60) {
+                recorder.recordRemove(system, system.getEmitters()[0]);
+                system.remove(system.getEmitters()[0]);
+            }
+            const double elapsed = 1.0 / 60.0 + 0.004 * std::sin(frame);
+            recordedSteps += static_cast<uint64_t>(system.update(elapsed));
+            recorder.recordFrame(elapsed, system.particles());
+        }
+        REQUIRE(recorder.getFrameCount() == 120);
+        REQUIRE(system.getPool().getOverflowCount() > 0);
+        recorder.stop();
+        const auto position = system.particles().getPosition();
+        recordedPositions.assign(position.begin(), position.end());
+    }
+    REQUIRE(recordedPositions.size() > 0);
+
+    SECTION("A replay reproduces every frame") {
+        const particlesystem::RecordingHeader header = particlesystem::readRecordingHeader(path);
+        REQUIRE(header.capacity == settings.capacity);
+        REQUIRE(header.overflowPolicy ==
+                static_cast<uint32_t>(particlesystem::OverflowPolicy::RecycleOldest));
+        particlesystem::setMasterSeed(123);
+        particlesystem::ParticleSystem system{settings};
+        system.addEffect(Wind{});
+        const particlesystem::ReplayResult result = particlesystem::replay(path, system);
+        REQUIRE(result.frames == 120);
+        REQUIRE(result.steps == recordedSteps);
+        REQUIRE(result.mismatches == 0);
+        REQUIRE(system.getEmitters().size() == 1);
+        REQUIRE(system.getEffects().size() == 1);
+        REQUIRE(std::ranges::equal(system.particles().getPosition(), recordedPositions));
+    }
+
+    SECTION("A replay from a different state is detected") {
+        particlesystem::ParticleSystem system;
+        system.addEmitter(Spinner{});
+        system.step(0.1);
+        const particlesystem::ReplayResult result = particlesystem::replay(path, system);
+        REQUIRE(result.mismatches > 0);
+        REQUIRE(result.firstMismatch == 0);
+    }
+
+    std::remove(path.c_str());
+    particlesystem::setMasterSeed(particlesystem::DefaultMasterSeed);
+}
+
+TEST_CASE("Scene files", "[Scene]") {
+    const std::string_view text = R"(# A test scene
+[system]
+capacity = 20_000
+overflow = "recycle_oldest"
+max_lifetime = 2.5
+seed = 42   # reproducible
+scheduler = "deterministic"
+integrator = "velocity_verlet"
+
+[[emitter]]
+type = "directional"
+position = [0.25, -0.5]
+rate = 1e3
+direction = 1.5
+width = 0.25
+
+[[emitter]]
+color = [0, 0, 1, 1]
+type = "spinner"
+
+[[effect]]
+type = "wind"
+force = -0.1
+range = 0.5
+)";
+
+    const particlesystem::SceneDescription scene = particlesystem::parseScene(text);
+    REQUIRE(scene.settings.capacity == 20'000);
+    REQUIRE(scene.settings.overflowPolicy == particlesystem::OverflowPolicy::RecycleOldest);
+    REQUIRE(scene.settings.maxLifetime == 2.5f);
+    REQUIRE(scene.settings.schedulerMode == particlesystem::Scheduler::Mode::Deterministic);
+    REQUIRE(scene.settings.integrator == particlesystem::Integrator::VelocityVerlet);
+    REQUIRE(scene.seed == 42u);
+    REQUIRE(scene.emitters.size() == 2);
+    REQUIRE(scene.effects.size() == 1);
+
+    particlesystem::ParticleSystem system{scene.settings};
+    scene.populate(system);
+    REQUIRE(system.getEmitters().size() == 2);
+    const auto* directional =
+        std::get_if<particlesystem::Handle<Directional>>(&system.getEmitters()[0]);
+    REQUIRE(directional);
+    REQUIRE(system.get(*directional)->position == glm::vec2{0.25f, -0.5f});
+    REQUIRE(system.get(*directional)->rate == 1000.0f);
+    REQUIRE(system.get(*directional)->width == 0.25f);
+    REQUIRE(system.get(system.getEmitters()[1])->color == glm::vec4{0, 0, 1, 1});
+    const auto* wind = std::get_if<particlesystem::Handle<Wind>>(&system.getEffects()[0]);
+    REQUIRE(wind);
+    REQUIRE(system.get(*wind)->force == -0.1f);
+    REQUIRE(system.get(*wind)->influenceRadius == 0.5f);
+    // Unset values keep the defaults of the objects
+    REQUIRE(system.get(*wind)->radius == Wind{}.radius);
+
+    // The same scene produces the same particles
+    auto run = [&] {
+        particlesystem::ParticleSystem other{scene.settings};
+        scene.populate(other);
+        for (int i = 0; i < 10; ++i) other.step(1.0 / 60.0);
+        const auto position = other.particles().getPosition();
+        return std::vector<glm::vec2>(position.begin(), position.end());
+    };
+    REQUIRE(run() == run());
+
+    SECTION("Unknown types") {
+        particlesystem::EmitterDescription emitter{};
+        emitter.type = 1000;
+        particlesystem::SceneDescription unknown;
+        unknown.emitters.push_back(emitter);
+        REQUIRE_THROWS_AS(unknown.populate(system), std::runtime_error);
+    }
+
+    SECTION("Errors point to the line") {
+        auto errorLine = [](std::string_view text) -> size_t {
+            try {
+                particlesystem::parseScene(text, "test.toml");
+            } catch (const particlesystem::SceneError& e) {
+                REQUIRE(std::string_view{e.what()}.starts_with(
+                    fmt::format("test.toml:{}: ", e.getLine())));
+                return e.getLine();
+            }
+            return 0;
+        };
+        REQUIRE(errorLine("[system]\ncapacity = 10\nspeed = 2\n") == 3);
+        REQUIRE(errorLine("[system]\n\ncapacity = -1\n") == 3);
+        REQUIRE(errorLine("[system]\ncapacity = 1.5\n") == 2);
+        REQUIRE(errorLine("[system]\nmax_lifetime = \"long\"\n") == 2);
+        REQUIRE(errorLine("rate = 5\n") == 1);
+        REQUIRE(errorLine("[[emitter]]\nrate = 5\n\n[[effect]]\ntype = \"wind\"\n") == 1);
+        REQUIRE(errorLine("[[emitter]]\ntype = \"fountain\"\n") == 2);
+        REQUIRE(errorLine("[[emitter]]\ntype = \"uniform\"\nwidth = 1\n") == 3);
+        REQUIRE(errorLine("[[effect]]\ntype = \"wind\"\nposition = [1, 2, 3]\n") == 3);
+        REQUIRE(errorLine("[[effect]]\ntype = \"wind\"\nforce = 1\nforce = 2\n") == 4);
+        REQUIRE(errorLine("[[effect]]\ntype = \"wind\"\nforce = 0.1.2\n") == 3);
+        REQUIRE(errorLine("[[effect]]\ntype = \"wind\"\nforce = nan\n") == 3);
+        REQUIRE(errorLine("[[effect]]\ntype = \"wind\"\n\nposition = [inf, 0]\n") == 4);
+        REQUIRE(errorLine("[system]\nmax_lifetime = -infinity\n") == 2);
+        REQUIRE(errorLine("[effects]\n") == 1);
+        REQUIRE(errorLine("[system]\nintegrator = \"leapfrog\"\n") == 2);
+        REQUIRE(errorLine("[system]\ncapacity 5\n") == 2);
+    }
+}
+
+TEST_CASE("Velocity Verlet reuses the forces of the previous step", "[Integrator]") {
+    // Counts the particles whose forces are evaluated
+    class CountingBackend : public particlesystem::ReferenceBackend {
+    public:
+        explicit CountingBackend(size_t& evaluated) : evaluated{evaluated} {}
+        void evaluateForces(const particlesystem::EffectTable& effects,
+                            std::span<const glm::vec2> positions,
+                            std::span<glm::vec2> forces) override {
+            evaluated += positions.size();
+            ReferenceBackend::evaluateForces(effects, positions, forces);
+        }
+
+    private:
+        size_t& evaluated;
+    };
+    size_t evaluated = 0;
+    particlesystem::registerBackend(particlesystem::BackendType::GLCompute,
+                                    [&](particlesystem::Scheduler&) {
+                                        return std::make_unique<CountingBackend>(evaluated);
+                                    });
+
+    // Returns the final positions and the number of evaluated forces per step. Fetching the pool
+    // makes the system evaluate every force again.
+    auto run = [&](bool reuse, bool moveWell) {
+        particlesystem::setMasterSeed(3);
+        particlesystem::ParticleSystem::Settings settings;
+        settings.backend = particlesystem::BackendType::GLCompute;
+        settings.integrator = particlesystem::Integrator::VelocityVerlet;
+        particlesystem::ParticleSystem system{settings};
+        system.addEmitter<Uniform>();
+        const auto well = system.addEffect<GravityWell>();
+        evaluated = 0;
+        size_t particles = 0;
+        for (int i = 0; i < 60; ++i) {
+            if (!reuse) system.getPool();
+            if (moveWell) system.get(well)->position.x = 0.01f * static_cast<float>(i);
+            system.step(1.0 / 60.0);
+            particles += system.particles().size();
+        }
+        const auto position = system.particles().getPosition();
+        return std::pair{std::vector<glm::vec2>(position.begin(), position.end()),
+                         static_cast<double>(evaluated) / static_cast<double>(particles)};
+    };
+    const auto [reused, reusedEvaluations] = run(true, false);
+    const auto [full, fullEvaluations] = run(false, false);
+    const auto [moved, movedEvaluations] = run(true, true);
+    particlesystem::registerBackend(particlesystem::BackendType::GLCompute, {});
+
+    // Only the new particles need their forces at the start of a step
+    REQUIRE(reusedEvaluations < 1.1);
+    REQUIRE(fullEvaluations > 1.9);
+    // Moving an effect makes the old forces invalid
+    REQUIRE(movedEvaluations > 1.9);
+    REQUIRE(reused.size() == full.size());
+    for (size_t i = 0; i < reused.size(); ++i) {
+        REQUIRE_THAT(reused[i].x, Catch::Matchers::WithinAbs(full[i].x, 1e-6));
+        REQUIRE_THAT(reused[i].y, Catch::Matchers::WithinAbs(full[i].y, 1e-6));
+    }
+}
+
+TEST_CASE("Cleared particles do not leave their forces behind", "[Integrator]") {
+    particlesystem::ParticleSystem::Settings settings;
+    settings.threadCount = 1;
+    settings.integrator = particlesystem::Integrator::VelocityVerlet;
+    particlesystem::ParticleSystem system{settings};
+    const auto emitter = system.addEmitter<Uniform>();
+    GravityWell well;
+    well.position = {0.3f, 0.2f};
+    system.addEffect(well);
+    for (int i = 0; i < 30; ++i) system.step(1.0 / 60.0);
+    system.clearParticles();
+
+    // A fresh system with the same emitter state must emit and move the same particles
+    particlesystem::ParticleSystem fresh{settings};
+    particlesystem::addFromRecord(fresh, particlesystem::toRecord(system, emitter));
+    fresh.addEffect(well);
+    for (int i = 0; i < 10; ++i) {
+        system.step(1.0 / 60.0);
+        fresh.step(1.0 / 60.0);
+    }
+    REQUIRE(system.particles().size() > 0);
+    REQUIRE(std::ranges::equal(system.particles().getPosition(), fresh.particles().getPosition()));
+    REQUIRE(std::ranges::equal(system.particles().getVelocity(), fresh.particles().getVelocity()));
+}
+
+TEST_CASE("Simulation backends agree with the reference backend", "[Backend]") {
+    // Stands in for a GPU backend, which can only be registered by the application
+    class PluggedBackend : public particlesystem::ReferenceBackend {
+    public:
+        const char* getName() const override { return "plugged"; }
+    };
+    REQUIRE_FALSE(particlesystem::isBackendAvailable(particlesystem::BackendType::GLCompute));
+    particlesystem::ParticleSystem::Settings unavailable;
+    unavailable.backend = particlesystem::BackendType::GLCompute;
+    REQUIRE_THROWS_AS(particlesystem::ParticleSystem{unavailable}, std::runtime_error);
+    particlesystem::registerBackend(particlesystem::BackendType::GLCompute,
+                                    [](particlesystem::Scheduler&) {
+                                        return std::make_unique<PluggedBackend>();
+                                    });
+
+    const auto integrator = GENERATE(particlesystem::Integrator::SemiImplicitEuler,
+                                     particlesystem::Integrator::VelocityVerlet,
+                                     particlesystem::Integrator::RungeKutta4);
+
+    // Runs a scene with packed, unpacked and local effects and returns the final positions
+    constexpr int steps = 120;
+    auto run = [&](particlesystem::BackendType type) {
+        particlesystem::setMasterSeed(11);
+        particlesystem::ParticleSystem::Settings settings;
+        settings.capacity = 20'000;
+        settings.threadCount = 3;
+        settings.backend = type;
+        settings.integrator = integrator;
+        particlesystem::ParticleSystem system{settings};
+        REQUIRE(std::string_view{system.getBackend().getName()} ==
+                (type == particlesystem::BackendType::GLCompute ? "plugged"
+                                                                : particlesystem::toString(type)));
+
+        Uniform uniform;
+        uniform.position = {-0.3f, 0.0f};
+        uniform.rate = 4000.0f;
+        system.addEmitter(uniform);
+        Directional directional;
+        directional.position = {0.3f, -0.2f};
+        directional.rate = 4000.0f;
+        system.addEmitter(directional);
+        GravityWell well;
+        well.position = {0.0f, 0.6f};
+        well.force = 0.02f;
+        system.addEffect(well);
+        Wind wind;
+        wind.position = {0.5f, 0.5f};
+        wind.force = 0.05f;
+        wind.influenceRadius = 0.4f;
+        system.addEffect(wind);
+
+        for (int i = 0; i < steps; ++i) system.step(1.0 / 60.0);
+        const auto position = system.particles().getPosition();
+        return std::vector<glm::vec2>(position.begin(), position.end());
+    };
+
+    const std::vector<glm::vec2> reference = run(particlesystem::BackendType::Reference);
+    REQUIRE(reference.size() > 1000);
+    for (auto type : {particlesystem::BackendType::Cpu, particlesystem::BackendType::GLCompute}) {
+        INFO(particlesystem::toString(type) << " " << particlesystem::toString(integrator));
+        REQUIRE(particlesystem::isBackendAvailable(type));
+        const std::vector<glm::vec2> positions = run(type);
+        REQUIRE(positions.size() == reference.size());
+        float maxError = 0.0f;
+        for (size_t i = 0; i < positions.size(); ++i) {
+            maxError = std::max(maxError, glm::length(positions[i] - reference[i]));
+        }
+        REQUIRE(maxError < 1e-4f);
+    }
+
+    SECTION("Switching backends keeps the particles") {
+        particlesystem::ParticleSystem system;
+        system.addEmitter(Uniform{});
+        system.step(0.1);
+        const size_t count = system.particles().size();
+        system.setBackend(particlesystem::BackendType::Reference);
+        REQUIRE(std::string_view{system.getBackend().getName()} == "reference");
+        REQUIRE(system.particles().size() == count);
+        system.step(0.1);
+        REQUIRE(system.particles().size() > count);
+    }
+
+    particlesystem::registerBackend(particlesystem::BackendType::GLCompute, nullptr);
+    REQUIRE_FALSE(particlesystem::isBackendAvailable(particlesystem::BackendType::GLCompute));
+}
+
+TEST_CASE("Integrators", "[Integrator]") {
+    // A particle on a circular orbit around a radial force field, whose force k / r balances the
+    // centripetal acceleration v^2 / r at the speed sqrt(k) for every radius
+    particlesystem::EffectTable table;
+    table.addRadial({0.0f, 0.0f}, 1.0f);
+    constexpr float radius = 0.5f;
+    const double period = 2.0 * std::numbers::pi * radius;
+    constexpr int steps = 40;
+
+    // Returns the distance from the starting point after one orbit
+    auto orbit = [&](particlesystem::SimulationBackend& backend,
+                     particlesystem::Integrator integrator) {
+        particlesystem::ParticleStore store;
+        store.append(1);
+        store.getPosition()[0] = {radius, 0.0f};
+        store.getVelocity()[0] = {0.0f, 1.0f};
+        particlesystem::ForceField forces = [&](std::span<const glm::vec2> positions,
+                                                std::span<glm::vec2> out) {
+            backend.evaluateForces(table, positions, out);
+        };
+        for (int i = 0; i < steps; ++i) {
+            forces(store.getPosition(), store.getForce());
+            backend.integrate(store, period / steps, integrator, forces);
+        }
+        return glm::distance(store.getPosition()[0], glm::vec2{radius, 0.0f});
+    };
+
+    particlesystem::Scheduler scheduler{1};
+    particlesystem::ReferenceBackend reference;
+    particlesystem::CpuBackend cpu{scheduler};
+    for (particlesystem::SimulationBackend* backend :
+         {static_cast<particlesystem::SimulationBackend*>(&reference),
+          static_cast<particlesystem::SimulationBackend*>(&cpu)}) {
+        INFO(backend->getName());
+        const float euler = orbit(*backend, particlesystem::Integrator::SemiImplicitEuler);
+        const float verlet = orbit(*backend, particlesystem::Integrator::VelocityVerlet);
+        const float rk4 = orbit(*backend, particlesystem::Integrator::RungeKutta4);
+        REQUIRE(verlet < euler / 4.0f);
+        REQUIRE(rk4 < verlet / 4.0f);
+        REQUIRE(rk4 < 1e-3f);
+    }
+}
+
+TEST_CASE("Forces are evaluated again every step", "[Integrator]") {
+    particlesystem::ParticleSystem::Settings settings;
+    settings.threadCount = 1;
+    particlesystem::ParticleSystem system{settings};
+    system.addEmitter<Uniform>();
+    const auto well = system.addEffect<GravityWell>();
+    system.step(0.1);
+    system.step(0.1);
+    const auto& particles = system.particles();
+    REQUIRE(particles.size() > 0);
+    auto isZero = [](glm::vec2 f) { return f == glm::vec2{0.0f, 0.0f}; };
+    REQUIRE_FALSE(std::ranges::all_of(particles.getForce(), isZero));
+
+    // Without effects only the acceleration given by the emitter is left
+    system.remove(well);
+    const std::vector<glm::vec2> velocity(particles.getVelocity().begin(),
+                                          particles.getVelocity().end());
+    system.step(0.1);
+    REQUIRE(std::ranges::all_of(particles.getForce(), isZero));
+    for (size_t i = 0; i < velocity.size(); ++i) {
+        const glm::vec2 expected = velocity[i] + particles.getAcceleration()[i] * 0.1f;
+        REQUIRE_THAT(particles.getVelocity()[i].x, Catch::Matchers::WithinAbs(expected.x, 1e-6));
+        REQUIRE_THAT(particles.getVelocity()[i].y, Catch::Matchers::WithinAbs(expected.y, 1e-6));
+    }
+}
@@ -0,0 +1,271 @@
+#include <catch2/catch_all.hpp>
+#include <glm/glm.hpp>
+#include <glm/packing.hpp>
+
+#include <rendering/pointbatcher.h>
+#include <rendering/window.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+/* Unit tests using the catch2 framework
+ * Homepage: https://github.com/catchorg/Catch2
+ * Tutorial: https://github.com/catchorg/Catch2/blob/devel/docs/tutorial.md
+ * Docs: https://github.com/catchorg/Catch2/blob/devel/docs/Readme.md
+ */
+
+namespace {
+
+// Stands in for the GL vertex buffer, checks every drawn point against the expected sequence
+// instead of keeping them
+struct MockSink : rendering::PointSink {
+    explicit MockSink(size_t capacity) : buffer(capacity) {}
+
+    std::span<rendering::PointVertex> map(size_t count) override {
+        REQUIRE(count <= buffer.size());
+        mapped = count;
+        return std::span(buffer).first(count);
+    }
+
+    void draw() override {
+        drawSizes.push_back(mapped);
+        for (size_t i = 0; i < mapped; ++i) {
+            if (buffer[i].position.x != static_cast<float>(drawn % pattern)) mismatches++;
+            drawn++;
+        }
+    }
+
+    std::vector<rendering::PointVertex> buffer;
+    size_t mapped = 0;
+    size_t pattern = 1;
+    size_t drawn = 0;
+    size_t mismatches = 0;
+    std::vector<size_t> drawSizes;
+};
+
+}  // namespace
+
+TEST_CASE("Empty batch", "[PointBatcher]") {
+    rendering::PointBatcher batcher;
+    MockSink sink{16};
+
+    REQUIRE(batcher.empty());
+    REQUIRE(batcher.submit(sink, 16) == 0);
+    REQUIRE(sink.drawSizes.empty());
+}
+
+SCENARIO("Packing points", "[PointBatcher]") {
+    GIVEN("A batcher") {
+        rendering::PointBatcher batcher;
+        const glm::vec4 red{1.0f, 0.0f, 0.0f, 1.0f};
+
+        WHEN("Points are added from separate arrays") {
+            const std::vector<glm::vec2> pos = {{0.0f, 1.0f}, {2.0f, 3.0f}};
+            const std::vector<float> radius = {4.0f, 5.0f};
+            const std::vector<glm::vec4> color = {red, red};
+            batcher.add(pos.data(), radius.data(), color.data(), pos.size());
+
+            THEN("The points are packed in order") {
+                REQUIRE(batcher.size() == 2);
+                REQUIRE(batcher.points()[1].position == glm::vec2{2.0f, 3.0f});
+                REQUIRE(batcher.points()[1].scale == 5.0f);
+                REQUIRE(batcher.points()[1].color_packed == glm::packUnorm4x8(red));
+            }
+        }
+
+        WHEN("Points are added from an array of structures") {
+            struct Particle {
+                glm::vec4 color;
+                glm::vec2 position;
+                float radius;
+            };
+            const std::vector<Particle> particles = {{red, {1.0f, 2.0f}, 3.0f},
+                                                     {red, {4.0f, 5.0f}, 6.0f}};
+            batcher.add(&particles[0].position, &particles[0].radius, &particles[0].color,
+                        particles.size(), sizeof(Particle));
+
+            THEN("The fields are read with the stride") {
+                REQUIRE(batcher.size() == 2);
+                REQUIRE(batcher.points()[1].position == glm::vec2{4.0f, 5.0f});
+                REQUIRE(batcher.points()[1].scale == 6.0f);
+                REQUIRE(batcher.points()[1].color_packed == glm::packUnorm4x8(red));
+            }
+        }
+    }
+}
+
+TEST_CASE("Submitting more points than fit in one draw", "[PointBatcher]") {
+    constexpr size_t perCall = 100'000;
+    constexpr size_t calls = 50;
+    constexpr size_t chunkSize = 1024 * 1024;
+
+    std::vector<glm::vec2> pos(perCall);
+    for (size_t i = 0; i < perCall; ++i) {
+        pos[i] = {static_cast<float>(i), 0.0f};
+    }
+    const std::vector<float> radius(perCall, 2.0f);
+    const std::vector<glm::vec4> color(perCall, glm::vec4{1.0f});
+
+    rendering::PointBatcher batcher;
+    for (size_t call = 0; call < calls; ++call) {
+        batcher.add(pos.data(), radius.data(), color.data(), perCall);
+    }
+    REQUIRE(batcher.size() == 5'000'000);
+
+    MockSink sink{chunkSize};
+    sink.pattern = perCall;
+    const size_t chunks = batcher.submit(sink, chunkSize);
+
+    // 4 full chunks and the remainder, all points drawn once in the order they were added
+    REQUIRE(chunks == 5);
+    const size_t remainder = 5'000'000 - 4 * chunkSize;
+    REQUIRE(sink.drawSizes ==
+            std::vector<size_t>{chunkSize, chunkSize, chunkSize, chunkSize, remainder});
+    REQUIRE(sink.drawn == 5'000'000);
+    REQUIRE(sink.mismatches == 0);
+    REQUIRE(batcher.empty());
+}
+
+namespace {
+
+rendering::Window headlessWindow(int width, int height, size_t threads = 1) {
+    rendering::RenderSettings settings;
+    settings.backend = rendering::RenderBackend::Software;
+    settings.threadCount = threads;
+    return rendering::Window("Test", width, height, settings);
+}
+
+}  // namespace
+
+SCENARIO("Software rendering", "[SoftwareBackend]") {
+    GIVEN("A cleared 64x64 headless window") {
+        rendering::RenderSettings settings;
+        settings.backend = rendering::RenderBackend::Software;
+        settings.threadCount = 1;
+        rendering::Window window("Test", 64, 64, settings);
+        const glm::vec4 black{0.0f, 0.0f, 0.0f, 1.0f};
+        const glm::vec4 red{1.0f, 0.0f, 0.0f, 1.0f};
+        window.beginFrame();
+        window.clear(black);
+
+        THEN("Every pixel has the clear color") {
+            const rendering::Image image = window.readPixels();
+            REQUIRE(image.width == 64);
+            REQUIRE(image.height == 64);
+            REQUIRE(image.pixels == std::vector<uint32_t>(64 * 64, glm::packUnorm4x8(black)));
+        }
+
+        WHEN("An opaque point is drawn in the center") {
+            window.drawPoint({0.0f, 0.0f}, 4.0f, red);
+            const rendering::Image image = window.readPixels();
+
+            THEN("It covers a square of its size") {
+                size_t covered = 0;
+                for (int y = 0; y < 64; ++y) {
+                    for (int x = 0; x < 64; ++x) {
+                        const bool inside = x >= 30 && x < 34 && y >= 30 && y < 34;
+                        const uint32_t expected = glm::packUnorm4x8(inside ? red : black);
+                        covered += image.pixels[static_cast<size_t>(y * 64 + x)] == expected;
+                    }
+                }
+                REQUIRE(covered == 64 * 64);
+            }
+        }
+
+        WHEN("A half transparent point is drawn") {
+            window.drawPoint({0.0f, 0.0f}, 2.0f, {1.0f, 1.0f, 1.0f, 0.5f});
+            const glm::vec4 color = glm::unpackUnorm4x8(window.readPixels().pixels[32 * 64 + 32]);
+
+            THEN("It is blended with the background") {
+                REQUIRE_THAT(color.r, Catch::Matchers::WithinAbs(0.5, 0.01));
+                REQUIRE_THAT(color.g, Catch::Matchers::WithinAbs(0.5, 0.01));
+            }
+        }
+
+        WHEN("Overlapping points are drawn with different calls") {
+            const std::vector<glm::vec2> pos = {{0.0f, 0.0f}};
+            const std::vector<float> radius = {8.0f};
+            const std::vector<uint32_t> green = {glm::packUnorm4x8({0.0f, 1.0f, 0.0f, 1.0f})};
+            window.drawPoint({0.0f, 0.0f}, 8.0f, red);
+            window.drawPoints(pos, radius, green);
+
+            THEN("The last one ends up on top") {
+                REQUIRE(window.readPixels().pixels[32 * 64 + 32] == green[0]);
+            }
+        }
+
+        WHEN("The user interface is used") {
+            float value = 1.0f;
+            window.beginGuiWindow("Window");
+            const bool changed = window.sliderFloat("Value", value, 0.0f, 2.0f);
+            const bool pressed = window.button("Button");
+            window.endGuiWindow();
+
+            THEN("Nothing happens") {
+                REQUIRE_FALSE(changed);
+                REQUIRE_FALSE(pressed);
+                REQUIRE(value == 1.0f);
+            }
+        }
+
+        window.endFrame();
+    }
+}
+
+TEST_CASE("Tiles rendered in parallel match a single thread", "[SoftwareBackend]") {
+    std::vector<glm::vec2> pos;
+    std::vector<float> radius;
+    std::vector<glm::vec4> color;
+    for (int i = 0; i < 20'000; ++i) {
+        const float t = static_cast<float>(i);
+        pos.push_back({std::sin(t * 0.37f), std::cos(t * 0.11f)});
+        radius.push_back(1.0f + static_cast<float>(i % 13));
+        color.push_back({std::fmod(t * 0.013f, 1.0f), 0.5f, 1.0f, 0.25f});
+    }
+
+    // Several frames, so that the worker threads are reused
+    auto render = [&](size_t threads) {
+        rendering::Window window = headlessWindow(300, 200, threads);
+        std::vector<uint32_t> pixels;
+        for (int frame = 0; frame < 3; ++frame) {
+            window.beginFrame();
+            window.clear({0.1f, 0.1f, 0.1f, 1.0f});
+            window.drawPoints(pos, radius, color);
+            std::vector<uint32_t> current = window.readPixels().pixels;
+            if (frame > 0) REQUIRE(current == pixels);
+            pixels = std::move(current);
+            window.endFrame();
+        }
+        return pixels;
+    };
+
+    REQUIRE(render(1) == render(4));
+}
+
+TEST_CASE("Saving frames", "[SoftwareBackend]") {
+    rendering::Window window = headlessWindow(16, 8);
+    window.beginFrame();
+    window.clear({0.0f, 0.0f, 1.0f, 1.0f});
+
+    const std::string format = GENERATE("png", "ppm");
+    const std::string path = "rendering-test-frame." + format;
+    window.saveFrame(path);
+
+    std::ifstream file{path, std::ios::binary};
+    const std::vector<char> data{std::istreambuf_iterator<char>(file), {}};
+    file.close();
+    std::remove(path.c_str());
+
+    if (format == "png") {
+        REQUIRE(data.size() > 8);
+        REQUIRE(std::string(data.begin() + 1, data.begin() + 4) == "PNG");
+    } else {
+        const std::string header = "P6\n16 8\n255\n";
+        REQUIRE(data.size() == header.size() + 16 * 8 * 3);
+        REQUIRE(std::string(data.begin(), data.begin() + static_cast<long>(header.size())) ==
+                header);
+        REQUIRE(static_cast<unsigned char>(data.back()) == 255);
+    }
+}